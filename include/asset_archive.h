@@ -0,0 +1,137 @@
+#ifndef ASSET_ARCHIVE_H
+#define ASSET_ARCHIVE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#include "mapped_file.h"
+
+// ============================================================================
+// PACOTE DE RECURSOS
+// ============================================================================
+//
+// Modelos, texturas, shaders e caches são identificados por um nome relativo
+// à raiz do projeto (ex.: "data/models/bunny.obj", "src/shader_vertex.glsl").
+// Em vez de abrir cada arquivo separadamente, o jogo lê todos de um único
+// pacote, "data.pak", gerado pela ferramenta "pack_assets" (veja
+// "tools/pack_assets.cpp"). O pacote é mapeado em memória uma única vez e
+// cada recurso é uma faixa desse mapeamento, sem cópia.
+//
+// Recursos que não estão no pacote (ou todos, se não há pacote) são lidos
+// como arquivos avulsos. Quando um recurso está no pacote, a cópia do pacote
+// é sempre a usada: um arquivo avulso editado só é lido depois de gerar o
+// pacote de novo (ou de apagar "data.pak"). Os caches são a exceção: um
+// cache desatualizado do pacote é substituído pelo avulso (veja
+// OpenCacheAsset()).
+//
+// A raiz do projeto é procurada a partir do diretório atual e dos seus dois
+// diretórios pais, então o jogo pode ser executado da raiz, de "bin/Linux"
+// ou de um diretório de build.
+
+// ----------------------------------------------------------------------------
+// Formato do pacote (compartilhado com "tools/pack_assets.cpp")
+// ----------------------------------------------------------------------------
+//
+//   AssetArchiveHeader
+//   AssetArchiveEntry[num_entries]  ordenadas pelo nome (memcmp)
+//   nomes (sem terminador), em sequência
+//   conteúdo dos recursos, cada um alinhado a ASSET_ARCHIVE_ALIGNMENT bytes
+//
+// Todos os valores estão na ordem de bytes da máquina que gerou o pacote.
+
+const char     ASSET_ARCHIVE_MAGIC[8]   = { 'O', 'V', 'O', 'P', 'A', 'C', 'K', '\0' };
+const uint32_t ASSET_ARCHIVE_VERSION    = 1;
+const uint64_t ASSET_ARCHIVE_ALIGNMENT  = 16;
+const char     ASSET_ARCHIVE_FILENAME[] = "data.pak";
+
+struct AssetArchiveHeader
+{
+    char     magic[8];
+    uint32_t version;
+    uint32_t num_entries;
+    uint64_t names_offset;
+    uint64_t file_size;
+};
+
+struct AssetArchiveEntry
+{
+    uint64_t name_offset; // Relativo a names_offset
+    uint64_t name_length;
+    uint64_t data_offset; // Relativo ao início do pacote
+    uint64_t data_size;
+    uint64_t hash;        // HashBytes() do conteúdo
+};
+
+// ----------------------------------------------------------------------------
+// Leitura
+// ----------------------------------------------------------------------------
+
+// Conteúdo de um recurso aberto por OpenAsset()
+struct AssetView
+{
+    const unsigned char* data; // NULL se o recurso não está aberto
+    size_t size;
+    MappedFile loose;          // Arquivo avulso mapeado (vazio se o recurso está no pacote)
+};
+
+// Procura a raiz do projeto e mapeia o pacote, se existir. Deve ser chamada
+// uma vez, antes de qualquer outra função deste arquivo; depois disso a
+// leitura pode ser feita de qualquer thread.
+void InitializeAssets();
+
+// Desfaz o mapeamento do pacote. Nenhum AssetView pode estar aberto.
+void ShutdownAssets();
+
+// Abre o recurso "name", do pacote ou do arquivo avulso. Retorna false (e
+// deixa "view" vazio) se ele não existe ou está vazio.
+bool OpenAsset(const char* name, AssetView* view);
+
+// Abre somente o arquivo avulso de "name", ignorando o pacote. Usada pelos
+// caches: um cache do pacote desatualizado é substituído por um avulso.
+bool OpenLooseAsset(const char* name, AssetView* view);
+
+// Fecha um recurso aberto por OpenAsset() ou OpenLooseAsset() (não faz nada
+// se "view" está vazio)
+void ReleaseAsset(AssetView* view);
+
+// Hash (HashBytes()) e tamanho do conteúdo de um recurso, usados pelos
+// caches. Para recursos do pacote o hash já está no índice, sem leitura.
+bool GetAssetHash(const char* name, uint64_t* hash, uint64_t* size);
+
+// Caminho do arquivo avulso correspondente a "name", usado para gravar os
+// caches gerados durante a execução. Nomes absolutos ou começando com "./" ou
+// "../" são caminhos a partir do diretório atual, e não da raiz.
+std::string GetLooseAssetPath(const char* name);
+
+// ----------------------------------------------------------------------------
+// Caches
+// ----------------------------------------------------------------------------
+
+// Abre o cache "name" e o confere com "validate". Um cache do pacote
+// desatualizado pode já ter sido regravado como arquivo avulso, que é então
+// tentado. Retorna false (e deixa "view" vazio) se não há cache válido;
+// "stale" (pode ser NULL) indica se algum cache foi encontrado mas recusado.
+bool OpenCacheAsset(const char* name, const std::function<bool(const AssetView&)>& validate,
+                    AssetView* view, bool* stale = NULL);
+
+// Trecho de um arquivo gravado por WriteFileAtomically()
+struct FileChunk
+{
+    const void* data;
+    size_t      size;
+};
+
+// Grava os trechos, em ordem, em um arquivo temporário ("<path>.tmp") e o
+// renomeia para "path" no final, para que um arquivo incompleto nunca seja
+// lido. Retorna false (sem alterar "path") se a gravação falha.
+bool WriteFileAtomically(const std::string& path, const std::vector<FileChunk>& chunks);
+
+// WriteFileAtomically() no arquivo avulso de "name" (veja
+// GetLooseAssetPath()), usada para gravar os caches. O caminho gravado é
+// devolvido em "path" (pode ser NULL).
+bool WriteLooseAssetAtomically(const char* name, const std::vector<FileChunk>& chunks,
+                               std::string* path = NULL);
+
+#endif // ASSET_ARCHIVE_H
@@ -0,0 +1,42 @@
+#ifndef CAMERA_H
+#define CAMERA_H
+
+#include <glad/glad.h>
+#include <glm/vec4.hpp>
+#include <glm/mat4x4.hpp>
+
+// ============================================================================
+// DADOS DA CÂMERA POR QUADRO
+// ============================================================================
+//
+// Matrizes da câmera e suas inversas, calculadas uma vez por quadro em
+// UpdateCameras() e enviadas para a GPU em um único uniform buffer (bloco
+// "CameraBlock" dos shaders). A cópia na CPU é usada pelo picking do mouse.
+
+// Layout std140: quatro mat4 seguidas de um vec4, sem preenchimento extra.
+// Deve ser mantido igual ao bloco "CameraBlock" de "shader_vertex.glsl" e
+// "shader_fragment.glsl".
+struct CameraUniforms {
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::mat4 inverse_view;
+    glm::mat4 inverse_projection;
+    glm::vec4 camera_position; // Posição da câmera em coordenadas globais (w = 1)
+};
+
+// Ponto de ligação (binding point) do bloco "CameraBlock"
+const GLuint CAMERA_UNIFORM_BINDING = 0;
+
+// Valores do quadro atual
+extern CameraUniforms g_CameraUniforms;
+
+// Cria o uniform buffer da câmera e o liga ao ponto CAMERA_UNIFORM_BINDING
+void InitCameraUniformBuffer();
+
+// Liga o bloco "CameraBlock" de um programa de GPU ao ponto CAMERA_UNIFORM_BINDING
+void BindCameraUniformBlock(GLuint program_id);
+
+// Calcula as inversas e atualiza o uniform buffer
+void UpdateCameraUniforms(const glm::mat4& view, const glm::mat4& projection, const glm::vec4& camera_position);
+
+#endif // CAMERA_H
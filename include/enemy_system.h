@@ -4,6 +4,7 @@
 #include <glm/vec3.hpp>
 #include <vector>
 #include "game_attributes.h"
+#include "render_snapshot.h"
 
 extern std::vector<Enemy> g_Enemies;
 extern std::vector<glm::vec3> g_PathWaypoints;
@@ -22,7 +23,10 @@ void InitializeEnemySystem();
 void FindPathWaypoints();
 void SpawnEnemy(EnemyType type);
 void UpdateAllEnemies(float deltaTime);
-void DrawAllEnemies();
+void DrawAllEnemies(const RenderSnapshot& snapshot);
+
+// Copia os inimigos ativos para a cópia de renderização
+void CaptureEnemies(RenderSnapshot& snapshot);
 
 glm::vec3 CalculateBezierPoint(const glm::vec3& p0, const glm::vec3& p1, 
                                const glm::vec3& p2, const glm::vec3& p3, float t);
@@ -37,6 +41,11 @@ bool IsWaveActive();
 bool IsWaveComplete();
 int GetCurrentWaveNumber();
 
+// Tipos de inimigo (bits 1 << EnemyType) que aparecem nos próximos
+// "seconds" segundos: os da wave atual ou, entre waves, os do início da
+// próxima, que pode começar a qualquer momento
+unsigned int GetUpcomingEnemyTypes(float seconds);
+
 
 
 const EnemyRenderInfo& GetEnemyRenderInfo(EnemyType type); 
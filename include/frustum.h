@@ -0,0 +1,52 @@
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include <vector>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <glm/mat4x4.hpp>
+
+// ============================================================================
+// FRUSTUM CULLING
+// ============================================================================
+//
+// O frustum de visualização é extraído a cada quadro da matriz
+// projection * view (método de Gribb e Hartmann). Os objetos são testados
+// em lotes: as caixas envolventes (AABBs, em coordenadas globais) são
+// guardadas em estrutura de arrays, para que quatro caixas sejam testadas
+// por vez com instruções SSE.
+
+// Seis planos (esquerda, direita, baixo, cima, near, far) na forma
+// ax + by + cz + d; pontos dentro do frustum têm valor >= 0 em todos.
+struct Frustum {
+    glm::vec4 planes[6];
+};
+
+// Lote de AABBs em estrutura de arrays (centro e meia-extensão)
+struct AABBBatch {
+    std::vector<float> center_x, center_y, center_z;
+    std::vector<float> extent_x, extent_y, extent_z;
+};
+
+// Frustum da câmera no quadro atual (veja SetViewFrustum())
+extern Frustum g_ViewFrustum;
+
+// Extrai os planos do frustum de uma matriz projection * view
+void ExtractFrustum(const glm::mat4& view_projection, Frustum& frustum);
+
+// Atualiza g_ViewFrustum; chamada uma vez por quadro antes dos desenhos
+void SetViewFrustum(const glm::mat4& view, const glm::mat4& projection);
+
+// Esvazia um lote, mantendo a memória alocada
+void ClearAABBBatch(AABBBatch& batch);
+
+// Adiciona ao lote a AABB (em coordenadas do modelo) transformada pela
+// matriz "model" para coordenadas globais
+void AddToAABBBatch(AABBBatch& batch, const glm::vec3& bbox_min, const glm::vec3& bbox_max, const glm::mat4& model);
+
+// Testa todas as caixas do lote contra o frustum. "visible[i]" recebe 1 se a
+// caixa i pode estar visível. Retorna o número de caixas visíveis e
+// contabiliza o resultado em g_RenderStats.
+size_t CullAABBBatch(const Frustum& frustum, const AABBBatch& batch, std::vector<unsigned char>& visible);
+
+#endif // FRUSTUM_H
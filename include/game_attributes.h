@@ -59,7 +59,8 @@ enum CellType {
     CELL_PATH = 1,
     CELL_BLOCKED = 2,
     CELL_BASE = 3,
-    CELL_START = 4
+    CELL_START = 4,
+    CELL_TYPE_COUNT
 };
 
 // Grid do mapa
@@ -107,7 +108,8 @@ enum EnemyType {
     ENEMY_WOLF = 0,
     ENEMY_HAWK,
     ENEMY_FOX,
-    ENEMY_RAT
+    ENEMY_RAT,
+    ENEMY_TYPE_COUNT
 };
 
 struct Enemy {
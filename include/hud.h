@@ -24,8 +24,21 @@ void AddMoney(int amount);
 void AddConsoleMessage(const std::string& message);
 void ClearConsoleMessages();
 
+// Valores exibidos pelo HUD, copiados da simulação (veja "render_snapshot.h")
+struct HUDState {
+    int money;
+    int lives;
+    int wave;
+    bool waveActive;
+    unsigned int consoleRevision;   // Muda a cada alteração das mensagens
+    std::deque<std::string> consoleMessages;
+};
+
+// Copia os valores atuais para "state" (as mensagens só se mudaram)
+void CaptureHUDState(HUDState& state);
+
 // Funções de renderização
 void InitializeHUD();
-void RenderHUD(GLFWwindow* window, int screenWidth, int screenHeight);
+void RenderHUD(GLFWwindow* window, const HUDState& state, int screenWidth, int screenHeight);
 
 #endif // HUD_H
@@ -0,0 +1,30 @@
+#ifndef MAP_MESH_H
+#define MAP_MESH_H
+
+#include <glm/vec3.hpp>
+#include "game_attributes.h"
+
+// ============================================================================
+// MALHA ESTÁTICA DO MAPA
+// ============================================================================
+//
+// O grid do mapa é pré-processado ("baked") em blocos de
+// MAP_CHUNK_SIZE x MAP_CHUNK_SIZE células. Cada bloco tem um único VBO com
+// todas as suas células, e os índices são agrupados por tipo de célula, de
+// forma que um bloco é desenhado com no máximo uma chamada por tipo.
+// Quando uma célula muda (veja SetMapCell()), somente o bloco que a contém
+// é reconstruído.
+
+const int MAP_CHUNK_SIZE = 16;
+
+// Constrói a malha de todos os blocos a partir de g_MapGrid
+void BuildMapMesh();
+
+// Altera o tipo de uma célula e marca o seu bloco para reconstrução
+void SetMapCell(int gridX, int gridZ, CellType type);
+
+// Reconstrói os blocos marcados e enfileira os blocos visíveis do mapa
+// (veja "render_queue.h")
+void DrawMapMesh();
+
+#endif // MAP_MESH_H
@@ -0,0 +1,40 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+
+// ============================================================================
+// ARQUIVOS MAPEADOS EM MEMÓRIA
+// ============================================================================
+//
+// Mapeia um arquivo inteiro, somente para leitura, no espaço de endereços do
+// processo (mmap() no Linux/macOS, MapViewOfFile() no Windows). As páginas
+// são lidas do disco sob demanda, sem cópia para um buffer intermediário.
+
+struct MappedFile
+{
+    const unsigned char* data; // NULL se o arquivo não está mapeado
+    size_t size;
+#ifdef _WIN32
+    void* file_handle;
+    void* mapping_handle;
+#endif
+};
+
+// Mapeia "filename". Retorna false (e deixa "file" vazio) se o arquivo não
+// existe, está vazio ou não pode ser mapeado.
+bool MapFile(const char* filename, MappedFile* file);
+
+// Desfaz o mapeamento (não faz nada se "file" está vazio)
+void UnmapFile(MappedFile* file);
+
+// Hash FNV-1a de 64 bits, usado pelos caches para identificar o conteúdo
+// dos arquivos de origem
+uint64_t HashBytes(const unsigned char* data, size_t size);
+
+// Mapeia "filename" e calcula o hash e o tamanho do seu conteúdo. Retorna
+// false se o arquivo não pode ser lido.
+bool HashFile(const char* filename, uint64_t* hash, uint64_t* size);
+
+#endif // MAPPED_FILE_H
@@ -0,0 +1,69 @@
+#ifndef MATERIALS_H
+#define MATERIALS_H
+
+#include <glad/glad.h>
+#include <glm/vec3.hpp>
+
+// ============================================================================
+// MATERIAIS E PERMUTAÇÕES DE SHADER
+// ============================================================================
+//
+// Cada objeto desenhado (identificado pelos mesmos IDs de
+// "game_attributes.h": MODEL_*, CELL_*_PLANE, ...) tem um material na tabela
+// de materiais. O material define a classe de shader e os parâmetros de
+// iluminação (Kd, Ks, q).
+//
+// Cada classe de shader é um programa de GPU próprio, compilado a partir
+// dos mesmos arquivos "shader_vertex.glsl" e "shader_fragment.glsl" com
+// #defines diferentes. Assim, os shaders não precisam testar o tipo do
+// objeto. Os programas são compilados uma única vez e guardados em um cache.
+//
+// Somente SHADER_FLAT é compilada antes do primeiro quadro; as demais são
+// compiladas pelo driver em segundo plano (veja CreateGpuProgramAsync()) e,
+// até ficarem prontas, os seus objetos são desenhados com SHADER_FLAT em
+// cinza.
+
+enum MaterialShader {
+    SHADER_FLAT = 0,          // Cor difusa constante (Kd), Lambert
+    SHADER_TEXTURED,          // Kd lido da textura, Lambert
+    SHADER_TEXTURED_SPECULAR, // Kd lido da textura, Lambert + Blinn-Phong
+    SHADER_GOURAUD_TEXTURED,  // Kd lido da textura, iluminação por vértice (Gouraud)
+    SHADER_COUNT
+};
+
+struct Material {
+    MaterialShader shader;
+    GLint     texture_layer; // Camada da textura difusa em g_TextureArrayID (-1 se não há textura)
+    glm::vec3 kd;            // Refletância difusa (somente SHADER_FLAT)
+    glm::vec3 ks;            // Refletância especular
+    float     ks_from_kd;    // Fração de Kd somada a Ks (ex.: brilho do ovo)
+    float     q;             // Expoente especular de Blinn-Phong
+};
+
+// Maior ID de objeto aceito pela tabela de materiais
+const int MAX_MATERIAL_ID = 128;
+
+// Compila (ou recompila) todas as permutações de shader, sem esperar pelas
+// que não estão no cache de binários
+void LoadMaterialPrograms();
+
+// Deve ser chamada no início de cada quadro: outros programas de GPU (ex.:
+// texto) podem ter sido usados desde o último BindMaterial(). Também passa a
+// usar as permutações que terminaram de compilar.
+void BeginMaterialFrame();
+
+// Material de um objeto
+const Material& GetMaterial(int object_id);
+
+// true se os dois materiais usam o mesmo programa de GPU e os mesmos valores
+// de variáveis uniformes (podendo diferir somente na camada de textura)
+bool MaterialsShareUniforms(int a, int b);
+
+// Usa o programa de GPU do material de "object_id" (somente se for
+// diferente do atual) e envia os parâmetros do material. Atualiza
+// g_GpuProgramID, g_model_uniform, g_bbox_min_uniform, g_bbox_max_uniform e
+// g_instanced_uniform para o programa em uso; por isso a matriz "model" deve
+// ser enviada depois de BindMaterial().
+void BindMaterial(int object_id);
+
+#endif // MATERIALS_H
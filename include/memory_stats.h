@@ -0,0 +1,26 @@
+#ifndef MEMORY_STATS_H
+#define MEMORY_STATS_H
+
+#include <cstddef>
+
+// ============================================================================
+// USO DE MEMÓRIA DO PROCESSO
+// ============================================================================
+//
+// Memória residente (RSS) atual e de pico do processo, lidas do sistema
+// operacional (/proc/self/status no Linux, task_info()/getrusage() no macOS,
+// GetProcessMemoryInfo() no Windows).
+
+struct ProcessMemoryUsage
+{
+    size_t current_rss; // Bytes residentes agora
+    size_t peak_rss;    // Maior valor de current_rss desde o início do processo
+};
+
+// Retorna false se o sistema não oferece essas informações
+bool GetProcessMemoryUsage(ProcessMemoryUsage* usage);
+
+// Imprime o uso de memória com o prefixo "[MEMORIA] <label>"
+void PrintProcessMemoryUsage(const char* label);
+
+#endif // MEMORY_STATS_H
@@ -0,0 +1,35 @@
+#ifndef MESH_BUFFER_H
+#define MESH_BUFFER_H
+
+#include <cstddef>
+#include <glad/glad.h>
+#include "resource_loader.h"
+
+// ============================================================================
+// BUFFER COMPARTILHADO DE MALHAS ESTÁTICAS
+// ============================================================================
+//
+// Todos os modelos carregados ficam em um único VBO (PackedVertex) e um
+// único buffer de índices de 16 bits, servidos por um único VAO. Cada
+// arquivo ocupa uma faixa contígua dos dois buffers: seus índices são
+// relativos ao primeiro vértice da faixa ("base_vertex"), então são
+// desenhados com glDrawElementsBaseVertex() e variantes.
+//
+// Os buffers crescem conforme necessário (a cópia é feita na própria GPU);
+// o VAO continua o mesmo.
+
+// Maior número de vértices de uma faixa, limitado pelos índices de 16 bits
+const size_t MESH_BUFFER_MAX_VERTICES_PER_RANGE = 65536;
+
+// VAO que lê o buffer compartilhado (0 se nada foi anexado ainda)
+GLuint GetSharedMeshVAO();
+
+// Copia uma malha para o final do buffer compartilhado. "indices" são
+// relativos ao primeiro vértice de "vertices", que deve ter no máximo
+// MESH_BUFFER_MAX_VERTICES_PER_RANGE elementos. Retorna a posição do
+// primeiro vértice e do primeiro índice da faixa.
+void AppendToSharedMeshBuffer(const PackedVertex* vertices, size_t num_vertices,
+                              const GLushort* indices, size_t num_indices,
+                              GLint* base_vertex, size_t* first_index);
+
+#endif // MESH_BUFFER_H
@@ -0,0 +1,69 @@
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include <cstdint>
+#include <vector>
+#include "resource_loader.h"
+#include "asset_archive.h"
+
+// ============================================================================
+// CACHE BINÁRIO DE MALHAS
+// ============================================================================
+//
+// O resultado do processamento de um arquivo OBJ (vértices PackedVertex,
+// índices no formato final da GPU, caixas envolventes, LODs e nomes dos
+// objetos) é gravado em "<arquivo>.obj.meshcache", ao lado do original. Nas
+// próximas execuções o cache é mapeado em memória e enviado diretamente para
+// a GPU, sem ler nem processar o OBJ.
+//
+// O cache é identificado pelo hash (FNV-1a de 64 bits) e tamanho do OBJ, e
+// por MESH_CACHE_VERSION: se o OBJ muda, ou se o formato/processamento muda,
+// o cache é ignorado e regravado. Caches incluídos no pacote de recursos
+// são lidos de lá (veja "asset_archive.h"); caches novos são sempre gravados
+// como arquivos avulsos.
+
+// Incrementar sempre que PackedVertex, BuildMeshData() ou os parâmetros dos
+// LODs mudarem (2: índices e vértices reordenados por "mesh_optimize.h")
+const uint32_t MESH_CACHE_VERSION = 2;
+
+// Identifica o conteúdo do OBJ que gerou um cache
+struct MeshCacheKey
+{
+    uint64_t source_hash;
+    uint64_t source_size;
+    bool     valid; // false se o OBJ não pôde ser lido
+};
+
+// Cache validado e ainda mapeado, pronto para AddMeshToVirtualScene()
+struct MeshCacheView
+{
+    AssetView                file;
+    std::vector<SceneObject> objects;
+    const PackedVertex*      vertices;   // Aponta para dentro de "file"
+    size_t                   num_vertices;
+    const void*              indices;    // Idem
+    size_t                   num_indices;
+    GLenum                   index_type;
+};
+
+// Calcula a chave do OBJ e, se existe um cache válido para ela, o mapeia em
+// "view" e retorna true. Não usa OpenGL, e pode ser chamada de qualquer
+// thread. A chave é devolvida em "key" para ser usada por WriteMeshCache().
+bool ReadMeshCache(const char* obj_filename, MeshCacheKey* key, MeshCacheView* view);
+
+// Copia os objetos (nomes, caixas envolventes e LODs) de um cache válido,
+// sem manter o mapeamento. Retorna false se não existe cache válido para o
+// OBJ atual.
+bool ReadMeshCacheObjects(const char* obj_filename, std::vector<SceneObject>* objects);
+
+// Desfaz o mapeamento de um cache lido por ReadMeshCache()
+void ReleaseMeshCache(MeshCacheView* view);
+
+// ReadMeshCache() seguida do envio da malha para g_VirtualScene
+bool LoadMeshCache(const char* obj_filename, MeshCacheKey* key);
+
+// Grava o cache de "mesh", construída a partir do OBJ identificado por
+// "key". Falhas de escrita só geram um aviso.
+void WriteMeshCache(const char* obj_filename, const MeshCacheKey& key, const MeshData& mesh);
+
+#endif // MESH_CACHE_H
@@ -0,0 +1,55 @@
+#ifndef MESH_OPTIMIZE_H
+#define MESH_OPTIMIZE_H
+
+#include <cstddef>
+#include <vector>
+#include <glad/glad.h>
+#include "resource_loader.h"
+
+// ============================================================================
+// REORDENAÇÃO DE ÍNDICES E VÉRTICES
+// ============================================================================
+//
+// A ordem dos triângulos nos arquivos OBJ é arbitrária, então a GPU
+// reaproveita pouco o cache de vértices já transformados: um mesmo vértice é
+// processado pelo Vertex Shader várias vezes. A malha é reordenada em três
+// etapas:
+//
+//   1. OptimizeVertexCache(): algoritmo Tipsify (Sander, Nehab & Barczak,
+//      "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw"),
+//      que emite os triângulos em leques ao redor de vértices que ainda estão
+//      no cache;
+//   2. OptimizeOverdraw(): a sequência é cortada em grupos cuja taxa de
+//      acertos no cache quase não piora, e os grupos voltados para fora da
+//      malha são desenhados primeiro, reduzindo fragmentos descartados pelo
+//      teste de profundidade;
+//   3. OptimizeVertexFetch(): os vértices são renumerados na ordem do
+//      primeiro uso, para que a leitura do vertex buffer seja sequencial.
+//
+// A qualidade é medida pelo ACMR ("average cache miss ratio"): vértices
+// transformados por triângulo, de 0.5 (ideal) a 3 (nenhum reaproveitamento).
+
+// Tamanho do cache de vértices simulado (FIFO), próximo ao das GPUs atuais
+const int VERTEX_CACHE_SIZE = 16;
+
+// Vértices transformados por triângulo ao desenhar "indices[0..index_count)",
+// simulando um cache FIFO de VERTEX_CACHE_SIZE entradas
+float ComputeACMR(const GLuint* indices, size_t index_count, size_t vertex_count);
+
+// Reordena os triângulos de "indices[0..index_count)" para aproveitar o cache
+// de vértices. Se "clusters" não é nulo, recebe a posição (em índices) do
+// início de cada trecho contíguo da nova ordem, para OptimizeOverdraw().
+void OptimizeVertexCache(GLuint* indices, size_t index_count, size_t vertex_count,
+                         std::vector<size_t>* clusters);
+
+// Reordena os trechos produzidos por OptimizeVertexCache() para reduzir o
+// overdraw, permitindo que o ACMR piore aproximadamente pelo fator
+// "threshold" (ex.: 1.05)
+void OptimizeOverdraw(const std::vector<PackedVertex>& vertices, GLuint* indices, size_t index_count,
+                      const std::vector<size_t>& clusters, float threshold);
+
+// Renumera os vértices na ordem do primeiro uso em "indices" (todos os
+// objetos e LODs da malha). Vértices não usados vão para o final.
+void OptimizeVertexFetch(std::vector<PackedVertex>& vertices, std::vector<GLuint>& indices);
+
+#endif // MESH_OPTIMIZE_H
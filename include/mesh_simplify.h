@@ -0,0 +1,33 @@
+#ifndef MESH_SIMPLIFY_H
+#define MESH_SIMPLIFY_H
+
+#include <vector>
+#include <glad/glad.h>
+#include "resource_loader.h"
+
+// ============================================================================
+// SIMPLIFICAÇÃO DE MALHAS (LOD)
+// ============================================================================
+//
+// Simplificação por colapso de arestas guiado por quádricas de erro
+// (Garland & Heckbert, "Surface Simplification Using Quadric Error
+// Metrics"). Cada colapso move um vértice sobre um vizinho já existente
+// ("half-edge collapse"), então a malha simplificada reaproveita os mesmos
+// vértices da original e só precisa de um novo buffer de índices.
+//
+// Cópias de um vértice que diferem somente na normal são simplificadas
+// juntas. Vértices na borda da malha e em costuras de textura (mesma posição
+// com coordenadas de textura diferentes) nunca são movidos, para que a
+// silhueta e o mapeamento de textura sejam preservados.
+
+// Simplifica os triângulos "indices[0..index_count)" até no máximo
+// "target_index_count" índices, sem ultrapassar o erro "max_error" (em
+// unidades do modelo). O resultado é escrito em "out_indices".
+//
+// Retorna o erro geométrico estimado da malha simplificada.
+float SimplifyMesh(const std::vector<PackedVertex>& vertices,
+                   const GLuint* indices, size_t index_count,
+                   size_t target_index_count, float max_error,
+                   std::vector<GLuint>& out_indices);
+
+#endif // MESH_SIMPLIFY_H
@@ -0,0 +1,40 @@
+#ifndef OBJ_PARSER_H
+#define OBJ_PARSER_H
+
+#include <string>
+#include <vector>
+#include <tiny_obj_loader.h>
+
+// ============================================================================
+// LEITOR RÁPIDO DE ARQUIVOS OBJ
+// ============================================================================
+//
+// Alternativa a tinyobj::LoadObj() usada pelo construtor de ObjModel. O
+// arquivo é lido diretamente do mapeamento em memória (veja OpenAsset(), em
+// "asset_archive.h"), sem cópia para std::istream e sem std::getline(), e
+// arquivos grandes são divididos em trechos (em fins de linha) lidos em
+// paralelo pelas threads de trabalho livres (veja ParallelFor(), em
+// "worker_pool.h") e depois juntados.
+//
+// O resultado é o mesmo da tinyobjloader com triangulate = true para tudo o
+// que BuildMeshData() consome: attrib.vertices/normals/texcoords e, para
+// cada shape, nome, índices, num_face_vertices, material_ids e
+// smoothing_group_ids (quads e polígonos são triangulados pelas mesmas
+// regras). Cores por vértice, pesos, tags, linhas ("l") e pontos ("p") não
+// são lidos: arquivos com "l", "p", "t" ou "vw" retornam
+// OBJ_PARSE_UNSUPPORTED, e devem ser lidos pela tinyobjloader.
+
+enum ObjParseResult {
+    OBJ_PARSE_OK,
+    OBJ_PARSE_FAILED,      // Arquivo inválido; mensagem em "err"
+    OBJ_PARSE_UNSUPPORTED  // Usa elementos que este leitor não trata
+};
+
+// Lê o conteúdo de um arquivo OBJ, "data[0..size)" (não precisa terminar em
+// '\0'). Os arquivos MTL citados são lidos por "material_reader" (pode ser
+// NULL), como em tinyobj::LoadObj().
+ObjParseResult ParseObjData(const char* data, size_t size, tinyobj::MaterialReader* material_reader,
+                            tinyobj::attrib_t* attrib, std::vector<tinyobj::shape_t>* shapes,
+                            std::vector<tinyobj::material_t>* materials, std::string* err);
+
+#endif // OBJ_PARSER_H
@@ -0,0 +1,52 @@
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+#include <cstdint>
+#include <string>
+#include <glad/glad.h>
+
+// ============================================================================
+// CACHE DE PROGRAMAS DE GPU
+// ============================================================================
+//
+// Compilar e linkar as permutações de shader (veja "materials.h") e o
+// programa do texto é a parte mais lenta da inicialização depois que malhas
+// e texturas têm cache. Depois da linkagem, o binário do programa é lido com
+// glGetProgramBinary() e gravado em "data/<nome>.programcache"; nas próximas
+// execuções ele é entregue ao driver com glProgramBinary(), sem compilar.
+//
+// O binário só vale para o mesmo driver, então a chave do cache é o hash dos
+// códigos-fonte (já com os #defines) e das strings GL_VENDOR, GL_RENDERER e
+// GL_VERSION. O driver também pode recusar um binário (ex.: após uma
+// atualização com a mesma versão); nesse caso o programa é compilado de
+// novo e o cache regravado.
+//
+// glGetProgramBinary() faz parte da OpenGL 4.1 e da extensão
+// GL_ARB_get_program_binary. Sem elas, ou com -DDISABLE_PROGRAM_CACHE, os
+// programas são sempre compilados.
+
+// Incrementar sempre que o formato do arquivo mudar
+const uint32_t PROGRAM_CACHE_VERSION = 1;
+
+// Identifica os códigos-fonte e o driver de um programa
+struct ProgramCacheKey
+{
+    uint64_t hash;
+    bool     valid; // false se a OpenGL não oferece binários de programas
+};
+
+// Calcula a chave do programa "name" e, se existe um cache válido para ela,
+// cria o programa a partir do binário e retorna o seu ID. Retorna 0 se o
+// programa precisa ser compilado. Somente na thread principal.
+GLuint LoadProgramCache(const char* name, const std::string& vertex_source,
+                        const std::string& fragment_source, ProgramCacheKey* key);
+
+// Deve ser chamada antes de glLinkProgram(): pede ao driver que mantenha o
+// binário disponível para WriteProgramCache()
+void PrepareProgramForCache(GLuint program_id);
+
+// Grava o binário de um programa linkado com sucesso. Falhas de escrita só
+// geram um aviso.
+void WriteProgramCache(const char* name, const ProgramCacheKey& key, GLuint program_id);
+
+#endif // PROGRAM_CACHE_H
@@ -18,7 +18,10 @@ struct Projectile {
 void InitializeProjectiles();
 void SpawnProjectile(glm::vec3 startPos, glm::vec3 direction, float damage);
 void UpdateProjectiles(float deltaTime);
-void DrawAllProjectils();
+void DrawAllProjectils(const RenderSnapshot& snapshot);
+
+// Copia as posições dos projéteis ativos para a cópia de renderização
+void CaptureProjectiles(RenderSnapshot& snapshot);
 
 void CheckProjectileCollisions();
 
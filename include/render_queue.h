@@ -0,0 +1,52 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <cstddef>
+#include <glad/glad.h>
+#include <glm/vec3.hpp>
+#include <glm/mat4x4.hpp>
+#include "resource_loader.h"
+
+// ============================================================================
+// FILA DE RENDERIZAÇÃO
+// ============================================================================
+//
+// Os sistemas do jogo não desenham diretamente: cada desenho vira um pacote
+// na fila, com uma chave de ordenação de 64 bits. No fim do quadro,
+// FlushRenderQueue() ordena os pacotes pela chave (radix sort) e os envia
+// para a GPU alterando o estado da OpenGL (programa, VAO, variáveis
+// uniformes) somente quando o valor muda em relação ao pacote anterior.
+//
+// Layout da chave, do bit mais significativo para o menos significativo:
+//
+//   63..60  classe de shader do material (programa de GPU)
+//   59..44  VAO
+//   43..36  material (ID do objeto, veja "materials.h")
+//   35..12  profundidade na câmera, da mais próxima para a mais distante
+//   11..0   reservado (zero)
+//
+// Todos os objetos do jogo são opacos; a profundidade só ordena os pacotes
+// que compartilham todo o estado, para aproveitar o teste de profundidade.
+
+// Descarta os pacotes e instâncias do quadro anterior. Deve ser chamada uma
+// vez por quadro, antes de qualquer Queue*().
+void BeginRenderQueue();
+
+// Enfileira um objeto de g_VirtualScene com a matriz "model" dada
+void QueueVirtualObject(MeshHandle mesh, int lod, int material_id, const glm::mat4& model);
+
+// Enfileira "count" cópias de um objeto. Cópias fora do frustum de
+// visualização são descartadas e as demais são agrupadas por LOD, com um
+// pacote instanciado por LOD.
+void QueueVirtualObjectInstanced(MeshHandle mesh, int material_id, const InstanceData* instances, size_t count);
+
+// Enfileira uma faixa de índices de um VAO qualquer (ex.: blocos do mapa).
+// "center" é usado somente na ordenação por profundidade.
+void QueueElements(GLuint vertex_array_object_id, GLenum rendering_mode, GLenum index_type,
+                   size_t first_index, GLsizei num_indices, int material_id,
+                   const glm::mat4& model, const glm::vec3& center);
+
+// Ordena e desenha todos os pacotes enfileirados
+void FlushRenderQueue();
+
+#endif // RENDER_QUEUE_H
@@ -0,0 +1,51 @@
+#ifndef RENDER_SNAPSHOT_H
+#define RENDER_SNAPSHOT_H
+
+#include <vector>
+#include <glm/vec3.hpp>
+#include "game_attributes.h"
+#include "hud.h"
+
+// ============================================================================
+// ESTADO DO JOGO VISTO PELA RENDERIZAÇÃO
+// ============================================================================
+//
+// A simulação roda em outra thread (veja "simulation.h"). Ao fim de cada
+// passo ela copia para um RenderSnapshot tudo que é necessário para desenhar
+// um quadro, e a thread de renderização lê somente esta cópia, nunca as
+// variáveis dos sistemas (g_Towers, g_Enemies, ...).
+//
+// Os galinheiros e o grid do mapa não mudam depois da inicialização e
+// continuam sendo lidos diretamente.
+
+struct TowerRenderState {
+    glm::vec3 position;
+    glm::vec3 direction;
+    TowerType type;
+};
+
+struct EnemyRenderState {
+    glm::vec3 position;
+    glm::vec3 direction;
+    EnemyType type;
+};
+
+struct RenderSnapshot {
+    // Somente objetos ativos
+    std::vector<TowerRenderState> towers;
+    std::vector<EnemyRenderState> enemies;
+    unsigned int upcoming_enemy_types; // Bits (1 << EnemyType) dos inimigos que aparecem em breve
+    std::vector<glm::vec3> projectiles;
+
+    // Torre selecionada, cujo alcance é desenhado
+    bool has_selected_tower;
+    glm::vec3 selected_tower_position;
+    float selected_tower_range;
+
+    HUDState hud;
+
+    // Número de passos de simulação executados até esta cópia
+    unsigned int simulation_step;
+};
+
+#endif // RENDER_SNAPSHOT_H
@@ -0,0 +1,20 @@
+#ifndef RENDER_STATS_H
+#define RENDER_STATS_H
+
+// ============================================================================
+// ESTATÍSTICAS DE RENDERIZAÇÃO
+// ============================================================================
+//
+// Contadores do quadro atual, zerados no início de RenderScene() e exibidos
+// junto com o FPS (veja TextRendering_ShowRenderStats() em main.cpp).
+
+struct RenderStats {
+    int objects_visible; // Objetos que passaram no frustum culling
+    int objects_culled;  // Objetos descartados pelo frustum culling
+    int draw_calls;      // Chamadas de desenho feitas por FlushRenderQueue()
+    int state_changes;   // Trocas de programa de GPU e de VAO
+};
+
+extern RenderStats g_RenderStats;
+
+#endif // RENDER_STATS_H
@@ -6,7 +6,9 @@
 #include <vector>
 #include <glad/glad.h>
 #include <glm/vec3.hpp>
+#include <glm/mat4x4.hpp>
 #include <tiny_obj_loader.h>
+#include "game_attributes.h"
 
 // Estrutura que representa um modelo geométrico carregado a partir de um
 // arquivo ".obj". Veja https://en.wikipedia.org/wiki/Wavefront_.obj_file .
@@ -16,11 +18,42 @@ struct ObjModel
     std::vector<tinyobj::shape_t>     shapes;
     std::vector<tinyobj::material_t>  materials;
 
-    // Este construtor lê o modelo de um arquivo utilizando a biblioteca tinyobjloader.
+    // Este construtor lê o modelo "filename" (nome de recurso, veja
+    // "asset_archive.h") utilizando a biblioteca tinyobjloader.
     // Veja: https://github.com/syoyo/tinyobjloader
     ObjModel(const char* filename, const char* basepath = NULL, bool triangulate = true);
 };
 
+// Formato de vértice compacto e intercalado usado por todos os modelos
+// (24 bytes). Veja BuildTrianglesAndAddToVirtualScene() e os atributos de
+// entrada em "shader_vertex.glsl".
+struct PackedVertex
+{
+    float   position[3];  // location 0; W = 1 implícito
+    GLshort normal[2];    // location 1; normal em codificação octaédrica (snorm16)
+    float   texcoords[2]; // location 2
+};
+
+// Dados de cada cópia desenhada por QueueVirtualObjectInstanced(), lidos
+// pelo Vertex Shader como atributos por instância (locations 3 a 7)
+struct InstanceData
+{
+    glm::mat4 model;         // locations 3 a 6, uma por coluna
+    GLfloat   texture_layer; // location 7; camada de g_TextureArrayID
+    GLfloat   padding[3];    // Mantém o alinhamento de 16 bytes
+};
+
+// Nível de detalhe (LOD) de um objeto: uma faixa do buffer de índices que
+// reaproveita os mesmos vértices da malha original. Veja BuildMeshLODs().
+struct MeshLOD
+{
+    size_t first_index;
+    size_t num_indices;
+    float  error; // Erro geométrico máximo em relação ao LOD 0, em unidades do modelo
+};
+
+const int MAX_MESH_LODS = 4;
+
 // Definimos uma estrutura que armazenará dados necessários para renderizar
 // cada objeto da cena virtual.
 struct SceneObject
@@ -29,33 +62,144 @@ struct SceneObject
     size_t       first_index; // Índice do primeiro vértice dentro do vetor indices[] definido em BuildTrianglesAndAddToVirtualScene()
     size_t       num_indices; // Número de índices do objeto dentro do vetor indices[] definido em BuildTrianglesAndAddToVirtualScene()
     GLenum       rendering_mode; // Modo de rasterização (GL_TRIANGLES, GL_TRIANGLE_STRIP, etc.)
+    GLenum       index_type;  // Tipo dos índices (GL_UNSIGNED_SHORT ou GL_UNSIGNED_INT)
     GLuint       vertex_array_object_id; // ID do VAO onde estão armazenados os atributos do modelo
+    GLint        base_vertex; // Somado aos índices (posição do modelo no buffer compartilhado)
     glm::vec3    bbox_min; // Axis-Aligned Bounding Box do objeto
     glm::vec3    bbox_max;
+    MeshLOD      lods[MAX_MESH_LODS]; // lods[0] é a malha original (first_index, num_indices)
+    int          num_lods;
+};
+
+// Malha processada de um arquivo OBJ, ainda na CPU (veja BuildMeshData()).
+// As faixas de índices dos objetos e dos seus LODs são relativas ao início
+// de "indices".
+struct MeshData
+{
+    std::vector<PackedVertex> vertices;
+    std::vector<GLuint>       indices;
+    std::vector<SceneObject>  objects;
+};
+
+// Identificador compacto de um objeto de g_VirtualScene: é o índice do objeto
+// no vetor. Os nomes são resolvidos para handles uma única vez, após o
+// carregamento dos modelos (veja ResolveGameMeshHandles()).
+typedef int MeshHandle;
+const MeshHandle INVALID_MESH_HANDLE = -1;
+
+// Handles de todos os objetos desenhados pelo jogo
+struct GameMeshHandles
+{
+    MeshHandle plane;
+    MeshHandle chicken_tower;
+    MeshHandle thompson_gun;
+    MeshHandle beagle_tower;
+    MeshHandle ak47;
+    MeshHandle chicken_coop;
+    MeshHandle egg;
+    MeshHandle enemies[ENEMY_TYPE_COUNT]; // Indexado por EnemyType
 };
 
 // Declaração de variáveis globais
-extern std::map<std::string, SceneObject> g_VirtualScene;
+extern std::vector<SceneObject> g_VirtualScene;
+extern GameMeshHandles g_Meshes;
+// Programa de GPU em uso e posições das suas variáveis (veja BindMaterial())
 extern GLuint g_GpuProgramID;
 extern GLint g_model_uniform;
-extern GLint g_view_uniform;
-extern GLint g_projection_uniform;
-extern GLint g_object_id_uniform;
 extern GLint g_bbox_min_uniform;
 extern GLint g_bbox_max_uniform;
-extern GLuint g_NumLoadedTextures;
+extern GLint g_instanced_uniform;
+extern GLuint g_NumLoadedTextures; // Número de camadas de g_TextureArrayID
+extern GLuint g_TextureArrayID;
+
+// Todas as texturas difusas são camadas de uma única GL_TEXTURE_2D_ARRAY
+// (g_TextureArrayID), redimensionadas para o mesmo tamanho e ligada à
+// unidade DIFFUSE_TEXTURE_UNIT. Veja LoadTextureImage().
+const int TEXTURE_LAYER_SIZE = 1024;
+const GLuint DIFFUSE_TEXTURE_UNIT = 0;
 
 // Declaração de funções de carregamento de recursos
 void BuildTrianglesAndAddToVirtualScene(ObjModel*); // Constrói representação de um ObjModel como malha de triângulos para renderização
+void BuildMeshData(ObjModel* model, MeshData* mesh); // Converte um ObjModel em vértices, índices e LODs
+GLenum MeshIndexType(size_t num_vertices); // Tipo dos índices na GPU para uma malha com "num_vertices" vértices
+void AddMeshToVirtualScene(const std::vector<SceneObject>& objects, const PackedVertex* vertices, size_t num_vertices,
+                           const void* indices, size_t num_indices, GLenum index_type); // Envia uma malha para a GPU
+void AddMeshDataToVirtualScene(const MeshData& mesh); // Idem, a partir de BuildMeshData()
+void LoadObjModelCached(const char* filename); // Carrega um OBJ, usando o cache binário de malhas
 void ComputeNormals(ObjModel* model); // Computa normais de um ObjModel, caso não existam.
-void LoadShadersFromFiles(); // Carrega os shaders de vértice e fragmento, criando um programa de GPU
-void LoadTextureImage(const char* filename); // Função que carrega imagens de textura
-void DrawVirtualObject(const char* object_name); // Desenha um objeto armazenado em g_VirtualScene
-GLuint LoadShader_Vertex(const char* filename);   // Carrega um vertex shader
-GLuint LoadShader_Fragment(const char* filename); // Carrega um fragment shader
-void LoadShader(const char* filename, GLuint shader_id); // Função utilizada pelas duas acima
+void EncodeOctahedralNormal(float nx, float ny, float nz, GLshort out[2]); // Codifica uma normal em dois snorm16
+void SetupPackedVertexAttributes(); // Define os atributos de PackedVertex no VAO ligado
+GLint LoadTextureImage(const char* filename); // Registra uma imagem como camada da textura difusa
+void CreateTextureArray(); // Cria a textura com todas as camadas registradas (ainda cinzas)
+void RequestTextureLayer(GLint layer); // Pede a leitura de uma camada (carregamento sob demanda)
+MeshHandle FindMeshHandle(const char* object_name); // Busca o handle de um objeto pelo nome (somente no carregamento)
+void ResolveGameMeshHandles(); // Preenche g_Meshes a partir dos nomes dos objetos
+void SetLODCamera(const glm::mat4& view, const glm::mat4& projection, float viewport_height); // Câmera usada na escolha de LODs
+int SelectMeshLOD(MeshHandle mesh, const glm::mat4& model); // Escolhe o LOD de um objeto pelo seu tamanho na tela
+void DrawVirtualObject(MeshHandle mesh, int lod = 0); // Desenha um objeto armazenado em g_VirtualScene
+#ifndef NDEBUG
+void DrawVirtualObject(const char* object_name); // Versão por nome, somente para depuração
+#endif
+GLuint LoadShader_Vertex(const char* filename, const char* defines = NULL);   // Carrega um vertex shader
+GLuint LoadShader_Fragment(const char* filename, const char* defines = NULL); // Carrega um fragment shader
+void LoadShader(const char* filename, GLuint shader_id, const char* defines = NULL); // Função utilizada pelas duas acima
+std::string ReadShaderSource(const char* filename, const char* defines = NULL); // Lê o código de um shader
+void CompileShaderSource(const char* label, const std::string& source, GLuint shader_id); // Compila o código de um shader
 GLuint CreateGpuProgram(GLuint vertex_shader_id, GLuint fragment_shader_id); // Cria um programa de GPU
-void LoadSingleModel(const char* filepath, const char* name);
-void LoadAllGameModels(std::map<std::string, SceneObject>& scene);
+GLuint CreateGpuProgramFromSource(const char* name, const std::string& vertex_source,
+                                  const std::string& fragment_source); // Idem, usando o cache de binários "name"
+
+// Criação de programas sem bloquear a thread principal: CreateGpuProgramAsync()
+// envia a compilação e a linkagem ao driver e retorna o ID do programa sem
+// consultar o seu estado. UpdatePendingGpuPrograms(), chamada uma vez por
+// quadro, verifica os programas que terminaram (com
+// GL_KHR_parallel_shader_compile, sem esperar por nenhum; sem a extensão, um
+// programa por quadro). Um programa só pode ser usado quando
+// GetGpuProgramStatus() retorna GPU_PROGRAM_READY; até lá (ou para sempre,
+// se a compilação falhou), use um programa mais simples. Programas lidos do
+// cache de binários já estão prontos.
+enum GpuProgramStatus {
+    GPU_PROGRAM_PENDING, // Ainda não verificado
+    GPU_PROGRAM_READY,
+    GPU_PROGRAM_FAILED   // Compilação ou linkagem falhou (erros já impressos)
+};
+
+GLuint CreateGpuProgramAsync(const char* name, const std::string& vertex_source,
+                             const std::string& fragment_source);
+void UpdatePendingGpuPrograms();
+GpuProgramStatus GetGpuProgramStatus(GLuint program_id);
+void DeleteGpuProgram(GLuint program_id); // Também cancela a verificação de um programa pendente
+
+// Opções de LoadSingleModel(). Por padrão a malha na CPU é liberada logo
+// depois do envio para a GPU; MODEL_KEEP_CPU_MESH a mantém (para colisões ou
+// seleção por raio), acessível por FindResidentMesh().
+enum ModelLoadFlags {
+    MODEL_LOAD_DEFAULT  = 0,
+    MODEL_KEEP_CPU_MESH = 1 << 0
+};
+
+void LoadSingleModel(const char* filepath, const char* name, int flags = MODEL_LOAD_DEFAULT);
+const MeshData* FindResidentMesh(const char* name); // NULL se o modelo não foi mantido na CPU
+
+// Carregamento sob demanda: LoadAllGameModels() lê somente a esfera usada
+// como placeholder. Os demais modelos são registrados com os nomes dos seus
+// objetos, que recebem desde já handles definitivos apontando para cópias da
+// esfera. Se o modelo tem um cache de malha válido (veja "mesh_cache.h"),
+// cada cópia é esticada até a caixa envolvente do objeto gravada no cache
+// (assim o placeholder tem o tamanho do modelo, qualquer que seja a escala
+// usada ao desenhá-lo); sem cache, a esfera é usada sem escala. Na primeira
+// vez que um objeto é desenhado (a fila de renderização chama
+// RequestMesh()), o modelo é lido por uma thread de trabalho e substitui a
+// esfera quando fica pronto, mantendo os handles. As camadas de textura
+// seguem o mesmo esquema com RequestTextureLayer(). Os inimigos das
+// próximas waves são pedidos alguns segundos antes (veja DrawAllEnemies()).
+//
+// Compile com -DDISABLE_ASSET_STREAMING para carregar tudo antes do
+// primeiro quadro.
+void RegisterStreamedModel(const char* filepath, const char* name,
+                           const std::vector<std::string>& object_names, int flags = MODEL_LOAD_DEFAULT);
+void RequestMesh(MeshHandle mesh); // Pede a leitura do modelo de um placeholder (não faz nada para os demais)
+void UploadStreamedAssets(); // Envia para a GPU o que já foi lido (uma vez por quadro)
+void LoadAllGameModels();
 
 #endif // RESOURCE_LOADER_H
\ No newline at end of file
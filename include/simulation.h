@@ -0,0 +1,60 @@
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#include <glm/vec3.hpp>
+#include "game_attributes.h"
+#include "render_snapshot.h"
+
+// ============================================================================
+// THREAD DE SIMULAÇÃO
+// ============================================================================
+//
+// Os sistemas do jogo (torres, inimigos, waves, projéteis e economia) são
+// atualizados em uma thread própria, com passo de tempo fixo, independente
+// da taxa de quadros e do vsync. Depois de cada passo a simulação publica um
+// RenderSnapshot em um buffer triplo: a thread de renderização sempre pega a
+// cópia mais recente sem bloquear, e a simulação sempre tem uma cópia livre
+// para escrever.
+//
+// A thread de renderização não altera o estado do jogo: os callbacks de
+// entrada da GLFW enviam comandos, executados pela simulação no início do
+// próximo passo.
+
+// Passos de simulação por segundo
+const float SIMULATION_STEPS_PER_SECOND = 120.0f;
+
+// Maior número de passos executados de uma vez para alcançar o relógio
+// (se a simulação atrasar mais do que isso, o jogo fica mais lento)
+const int SIMULATION_MAX_CATCHUP_STEPS = 8;
+
+enum GameCommandType {
+    GAME_COMMAND_SELECT_CELL,      // Seleciona a torre em (x, z), se existir
+    GAME_COMMAND_OPEN_TOWER_MENU,  // Abre o menu de compra em (x, z)
+    GAME_COMMAND_CANCEL,           // Fecha o menu ou desfaz a seleção
+    GAME_COMMAND_BUY_TOWER,        // Compra a torre "tower_type", se o menu está aberto
+    GAME_COMMAND_SPAWN_ENEMY,      // Cria um inimigo "enemy_type" (teste)
+    GAME_COMMAND_START_NEXT_WAVE   // Inicia a próxima wave, se nenhuma está ativa
+};
+
+struct GameCommand {
+    GameCommandType type;
+    int gridX, gridZ;
+    TowerType tower_type;
+    EnemyType enemy_type;
+};
+
+// Publica o estado inicial e inicia a thread de simulação. Deve ser chamada
+// depois de inicializados todos os sistemas do jogo.
+void StartSimulationThread();
+
+// Pede o fim da simulação e espera a thread terminar
+void StopSimulationThread();
+
+// Enfileira um comando para a simulação (chamada pela thread de renderização)
+void PushGameCommand(const GameCommand& command);
+
+// Cópia mais recente do estado do jogo. A referência é válida até a próxima
+// chamada (somente a thread de renderização deve chamá-la).
+const RenderSnapshot& AcquireRenderSnapshot();
+
+#endif // SIMULATION_H
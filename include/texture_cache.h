@@ -0,0 +1,79 @@
+#ifndef TEXTURE_CACHE_H
+#define TEXTURE_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "asset_archive.h"
+
+// ============================================================================
+// CACHE DE TEXTURAS
+// ============================================================================
+//
+// Cada imagem carregada por LoadTextureImage() vira uma camada de
+// TEXTURE_LAYER_SIZE x TEXTURE_LAYER_SIZE com a cadeia completa de mipmaps,
+// calculada na CPU. O resultado é gravado em "<imagem>.texcache", ao lado do
+// original; nas próximas execuções o cache é mapeado em memória e enviado
+// diretamente para a GPU, sem cópia e sem decodificar o PNG/JPG, redimensionar nem chamar glGenerateMipmap().
+//
+// Os níveis podem ser gravados sem compressão (RGB de 8 bits) ou comprimidos
+// em BC1 (DXT1, blocos de 4x4 pixels em 8 bytes), quando a OpenGL oferece
+// GL_EXT_texture_compression_s3tc. Como as imagens são lidas sem canal alfa,
+// BC1 basta; BC3 só acrescentaria um bloco de alfa.
+//
+// O cache é identificado pelo hash e tamanho da imagem, pelo formato, pelo
+// tamanho da camada e por TEXTURE_CACHE_VERSION. Como o cache de malhas, é
+// lido do pacote de recursos quando incluído nele (veja "asset_archive.h").
+
+// Incrementar sempre que o redimensionamento, os mipmaps ou o codificador
+// BC1 mudarem
+const uint32_t TEXTURE_CACHE_VERSION = 1;
+
+enum TextureFormat {
+    TEXTURE_FORMAT_RGB8 = 0, // 3 bytes por pixel (GL_SRGB8)
+    TEXTURE_FORMAT_BC1  = 1  // 8 bytes por bloco de 4x4 (GL_COMPRESSED_SRGB_S3TC_DXT1_EXT)
+};
+
+// Número de níveis de mipmap de uma imagem size x size (size potência de 2)
+int TextureMipLevels(int size);
+
+// Bytes de um nível de size x size pixels
+size_t TextureLevelBytes(TextureFormat format, int size);
+
+// Bytes da cadeia completa de níveis, do maior para o menor, em sequência
+size_t TextureMipChainBytes(TextureFormat format, int size);
+
+// Comprime uma imagem RGB de width x height pixels em blocos BC1, linha de
+// blocos por linha de blocos. Imagens menores que 4x4 repetem a borda.
+void EncodeBC1(const unsigned char* rgb, int width, int height, unsigned char* blocks);
+
+// Identifica o conteúdo da imagem que gerou um cache
+struct TextureCacheKey
+{
+    uint64_t source_hash;
+    uint64_t source_size;
+    bool     valid; // false se a imagem não pôde ser lida
+};
+
+// Cache validado e ainda mapeado, pronto para o envio para a GPU
+struct TextureCacheView
+{
+    AssetView            file;
+    const unsigned char* mips;      // Cadeia de níveis; aponta para dentro de "file"
+    size_t               mips_size;
+};
+
+// Calcula a chave da imagem e, se existe um cache válido para ela no
+// formato pedido, o mapeia em "view" e retorna true. Não usa OpenGL, e pode
+// ser chamada de qualquer thread.
+bool ReadTextureCache(const char* image_filename, TextureFormat format, int size,
+                      TextureCacheKey* key, TextureCacheView* view);
+
+// Desfaz o mapeamento de um cache lido por ReadTextureCache()
+void ReleaseTextureCache(TextureCacheView* view);
+
+// Grava o cache de uma cadeia de níveis. Falhas de escrita só geram um aviso.
+void WriteTextureCache(const char* image_filename, const TextureCacheKey& key, TextureFormat format,
+                       int size, const std::vector<unsigned char>& mips);
+
+#endif // TEXTURE_CACHE_H
@@ -3,6 +3,7 @@
 
 #include <glm/glm.hpp>
 #include "game_attributes.h"
+#include "render_snapshot.h"
 
 // ============================================================================
 // ESTRUTURAS DE FÍSICA E OBJETOS
@@ -62,13 +63,16 @@ void DrawChickenTower(glm::vec3 position, glm::vec3 direction);
 
 void DrawBeagleTower(glm::vec3 position, glm::vec3 direction);
 
-void DrawAllTowers();
+void DrawAllTowers(const RenderSnapshot& snapshot);
 
 bool CanPlaceTower(int gridX, int gridZ);
 
 int SelectTowerAtPosition(int gridX, int gridZ);
 
-void DrawTowerRangeCircle();
+void DrawTowerRangeCircle(const RenderSnapshot& snapshot);
+
+// Copia as torres ativas e a seleção para a cópia de renderização
+void CaptureTowers(RenderSnapshot& snapshot);
 
 void ShowTowerInfo(int towerIndex);
 
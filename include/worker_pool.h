@@ -0,0 +1,49 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <functional>
+
+// ============================================================================
+// POOL DE THREADS DE TRABALHO
+// ============================================================================
+//
+// Tarefas de CPU pura (decodificação de imagens, leitura e processamento de
+// OBJs) são executadas por um conjunto fixo de threads, uma por núcleo. Como
+// somente a thread principal tem o contexto OpenGL, uma tarefa que precisa
+// enviar algo para a GPU entrega o resultado com PostMainThreadTask(): a
+// thread principal executa essas continuações dentro de WaitForWorkerJobs()
+// ou RunMainThreadTasks(), na ordem em que ficam prontas.
+
+// Cria as threads de trabalho (hardware_concurrency() - 1, no mínimo uma:
+// a thread principal fica com os envios para a GPU)
+void StartWorkerPool();
+
+// Espera as tarefas pendentes e encerra as threads
+void StopWorkerPool();
+
+// Número de threads de trabalho (0 se o pool não foi iniciado)
+int GetWorkerCount();
+
+// Enfileira uma tarefa para uma thread de trabalho. Sem pool, a tarefa é
+// executada imediatamente na thread que chamou.
+void SubmitWorkerJob(const std::function<void()>& job);
+
+// Executa "function(i)" para i em [0, count), dividindo os índices entre a
+// thread que chamou e as threads de trabalho livres, e retorna quando todos
+// terminam. A thread que chamou também executa índices, então pode ser
+// chamada de dentro de uma tarefa: se as demais threads estão ocupadas, os
+// índices são executados por ela mesma, sem esperar.
+void ParallelFor(int count, const std::function<void(int)>& function);
+
+// Enfileira uma continuação para a thread principal (chamada pelas tarefas)
+void PostMainThreadTask(const std::function<void()>& task);
+
+// Executa, na thread principal, as continuações à medida que chegam, até
+// que todas as tarefas enviadas tenham terminado
+void WaitForWorkerJobs();
+
+// Executa, na thread principal, as continuações que já estão prontas, sem
+// esperar pelas tarefas em andamento (chamada uma vez por quadro)
+void RunMainThreadTasks();
+
+#endif // WORKER_POOL_H
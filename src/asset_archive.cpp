@@ -0,0 +1,249 @@
+#include "asset_archive.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <sys/stat.h>
+
+// ============================================================================
+// ARMAZENAMENTO LOCAL
+// ============================================================================
+
+// Raiz do projeto, com a barra final ("" se é o diretório atual)
+static std::string g_AssetRoot;
+
+static MappedFile               g_Archive;
+static const AssetArchiveEntry* g_ArchiveEntries = NULL;
+static size_t                   g_ArchiveNumEntries = 0;
+static const char*              g_ArchiveNames = NULL;
+
+// ============================================================================
+// IMPLEMENTAÇÃO
+// ============================================================================
+
+static bool PathExists(const std::string& path)
+{
+    struct stat info;
+    return stat(path.c_str(), &info) == 0;
+}
+
+// Compara o nome de uma entrada (em "names") com "name" (mesma ordem usada
+// pelo pacote)
+static int CompareEntryName(const char* names, const AssetArchiveEntry& entry, const char* name, size_t length)
+{
+    int result = memcmp(names + entry.name_offset, name, std::min((size_t)entry.name_length, length));
+    if (result != 0)
+        return result;
+    if (entry.name_length == length)
+        return 0;
+    return entry.name_length < length ? -1 : 1;
+}
+
+// Confere se o índice e as faixas de todos os recursos cabem no pacote, e
+// se os nomes estão em ordem estritamente crescente: fora de ordem, a busca
+// binária de FindArchiveEntry() não encontraria alguns recursos
+static bool ValidateArchive(const MappedFile& file)
+{
+    if (file.size < sizeof(AssetArchiveHeader))
+        return false;
+
+    const AssetArchiveHeader* header = reinterpret_cast<const AssetArchiveHeader*>(file.data);
+    if (memcmp(header->magic, ASSET_ARCHIVE_MAGIC, sizeof(ASSET_ARCHIVE_MAGIC)) != 0
+        || header->version != ASSET_ARCHIVE_VERSION
+        || header->file_size != file.size)
+        return false;
+
+    uint64_t entries_end = sizeof(AssetArchiveHeader) + (uint64_t)header->num_entries * sizeof(AssetArchiveEntry);
+    if (entries_end > file.size || header->names_offset < entries_end || header->names_offset > file.size)
+        return false;
+
+    const AssetArchiveEntry* entries = reinterpret_cast<const AssetArchiveEntry*>(file.data + sizeof(AssetArchiveHeader));
+    const char* names = reinterpret_cast<const char*>(file.data + header->names_offset);
+    uint64_t names_size = file.size - header->names_offset;
+    for (uint32_t i = 0; i < header->num_entries; ++i)
+    {
+        const AssetArchiveEntry& entry = entries[i];
+        if (entry.name_offset > names_size || entry.name_length > names_size - entry.name_offset)
+            return false;
+        if (entry.data_offset > file.size || entry.data_size > file.size - entry.data_offset)
+            return false;
+
+        const AssetArchiveEntry* previous = i > 0 ? &entries[i - 1] : NULL;
+        if (previous != NULL
+            && CompareEntryName(names, entry, names + previous->name_offset, (size_t)previous->name_length) <= 0)
+            return false;
+    }
+    return true;
+}
+
+// Procura "name" no índice do pacote (busca binária)
+static const AssetArchiveEntry* FindArchiveEntry(const char* name)
+{
+    if (g_ArchiveEntries == NULL)
+        return NULL;
+
+    size_t length = strlen(name);
+    const AssetArchiveEntry* begin = g_ArchiveEntries;
+    const AssetArchiveEntry* end = g_ArchiveEntries + g_ArchiveNumEntries;
+    const AssetArchiveEntry* entry = std::lower_bound(begin, end, name,
+        [length](const AssetArchiveEntry& e, const char* n) { return CompareEntryName(g_ArchiveNames, e, n, length) < 0; });
+
+    if (entry == end || CompareEntryName(g_ArchiveNames, *entry, name, length) != 0)
+        return NULL;
+    return entry;
+}
+
+void InitializeAssets()
+{
+    // A raiz é o primeiro diretório que tem o pacote ou o diretório "data"
+    static const char* const kCandidates[] = { "", "../", "../../" };
+    g_AssetRoot.clear();
+    for (size_t i = 0; i < sizeof(kCandidates) / sizeof(kCandidates[0]); ++i)
+    {
+        std::string root = kCandidates[i];
+        if (PathExists(root + ASSET_ARCHIVE_FILENAME) || PathExists(root + "data"))
+        {
+            g_AssetRoot = root;
+            break;
+        }
+    }
+
+    std::string archive_path = g_AssetRoot + ASSET_ARCHIVE_FILENAME;
+    if (!MapFile(archive_path.c_str(), &g_Archive))
+    {
+        printf("[ASSETS] Sem pacote; lendo arquivos avulsos de \"%s\"\n", g_AssetRoot.empty() ? "./" : g_AssetRoot.c_str());
+        return;
+    }
+
+    if (!ValidateArchive(g_Archive))
+    {
+        fprintf(stderr, "[ASSETS] Pacote \"%s\" invalido; lendo arquivos avulsos\n", archive_path.c_str());
+        UnmapFile(&g_Archive);
+        return;
+    }
+
+    const AssetArchiveHeader* header = reinterpret_cast<const AssetArchiveHeader*>(g_Archive.data);
+    g_ArchiveEntries    = reinterpret_cast<const AssetArchiveEntry*>(g_Archive.data + sizeof(AssetArchiveHeader));
+    g_ArchiveNumEntries = header->num_entries;
+    g_ArchiveNames      = reinterpret_cast<const char*>(g_Archive.data + header->names_offset);
+
+    printf("[ASSETS] Pacote \"%s\": %zu recursos, %.1f MB\n", archive_path.c_str(),
+           g_ArchiveNumEntries, g_Archive.size / (1024.0 * 1024.0));
+}
+
+void ShutdownAssets()
+{
+    g_ArchiveEntries = NULL;
+    g_ArchiveNumEntries = 0;
+    g_ArchiveNames = NULL;
+    UnmapFile(&g_Archive);
+}
+
+bool OpenAsset(const char* name, AssetView* view)
+{
+    const AssetArchiveEntry* entry = FindArchiveEntry(name);
+    if (entry != NULL && entry->data_size > 0)
+    {
+        view->data = g_Archive.data + entry->data_offset;
+        view->size = (size_t)entry->data_size;
+        view->loose.data = NULL;
+        view->loose.size = 0;
+        return true;
+    }
+
+    return OpenLooseAsset(name, view);
+}
+
+bool OpenLooseAsset(const char* name, AssetView* view)
+{
+    view->data = NULL;
+    view->size = 0;
+
+    std::string path = GetLooseAssetPath(name);
+    if (!MapFile(path.c_str(), &view->loose))
+        return false;
+
+    view->data = view->loose.data;
+    view->size = view->loose.size;
+    return true;
+}
+
+void ReleaseAsset(AssetView* view)
+{
+    UnmapFile(&view->loose);
+    view->data = NULL;
+    view->size = 0;
+}
+
+bool GetAssetHash(const char* name, uint64_t* hash, uint64_t* size)
+{
+    const AssetArchiveEntry* entry = FindArchiveEntry(name);
+    if (entry != NULL && entry->data_size > 0)
+    {
+        *hash = entry->hash;
+        *size = entry->data_size;
+        return true;
+    }
+
+    std::string path = GetLooseAssetPath(name);
+    return HashFile(path.c_str(), hash, size);
+}
+
+std::string GetLooseAssetPath(const char* name)
+{
+    // Caminhos absolutos ou explicitamente relativos ao diretório atual (como
+    // o modelo passado na linha de comando) não são relativos à raiz
+    bool absolute = name[0] == '/' || name[0] == '\\' || (name[0] != '\0' && name[1] == ':');
+    bool explicit_relative = strncmp(name, "./", 2) == 0 || strncmp(name, "../", 3) == 0;
+    if (absolute || explicit_relative)
+        return name;
+
+    return g_AssetRoot + name;
+}
+
+bool OpenCacheAsset(const char* name, const std::function<bool(const AssetView&)>& validate,
+                    AssetView* view, bool* stale)
+{
+    bool valid = OpenAsset(name, view) && validate(*view);
+    if (!valid && view->data != NULL && view->loose.data == NULL)
+    {
+        ReleaseAsset(view);
+        valid = OpenLooseAsset(name, view) && validate(*view);
+    }
+
+    if (stale != NULL)
+        *stale = !valid && view->data != NULL;
+    if (!valid)
+        ReleaseAsset(view);
+    return valid;
+}
+
+bool WriteFileAtomically(const std::string& path, const std::vector<FileChunk>& chunks)
+{
+    std::string temp_path = path + ".tmp";
+    FILE* file = fopen(temp_path.c_str(), "wb");
+    if (file == NULL)
+        return false;
+
+    bool ok = true;
+    for (size_t i = 0; i < chunks.size() && ok; ++i)
+        ok = chunks[i].size == 0 || fwrite(chunks[i].data, 1, chunks[i].size, file) == chunks[i].size;
+    ok = (fclose(file) == 0) && ok;
+
+    // No Windows, rename() falha se o destino existe
+    if (ok)
+        remove(path.c_str());
+    if (!ok || rename(temp_path.c_str(), path.c_str()) != 0)
+    {
+        remove(temp_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool WriteLooseAssetAtomically(const char* name, const std::vector<FileChunk>& chunks, std::string* path)
+{
+    std::string loose_path = GetLooseAssetPath(name);
+    if (path != NULL)
+        *path = loose_path;
+    return WriteFileAtomically(loose_path, chunks);
+}
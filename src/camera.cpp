@@ -0,0 +1,56 @@
+#include "camera.h"
+#include <glm/matrix.hpp>
+#include <cstddef>
+#include <cstdio>
+
+// ============================================================================
+// VARIÁVEIS GLOBAIS
+// ============================================================================
+
+CameraUniforms g_CameraUniforms;
+
+static GLuint g_CameraUniformBufferID = 0;
+
+// O layout da estrutura precisa coincidir com as regras std140
+static_assert(offsetof(CameraUniforms, camera_position) == 4 * sizeof(glm::mat4),
+              "CameraUniforms nao segue o layout std140 de CameraBlock");
+
+// ============================================================================
+// IMPLEMENTAÇÃO
+// ============================================================================
+
+void InitCameraUniformBuffer() {
+    if (g_CameraUniformBufferID != 0)
+        return;
+
+    glGenBuffers(1, &g_CameraUniformBufferID);
+    glBindBuffer(GL_UNIFORM_BUFFER, g_CameraUniformBufferID);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(CameraUniforms), NULL, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    glBindBufferBase(GL_UNIFORM_BUFFER, CAMERA_UNIFORM_BINDING, g_CameraUniformBufferID);
+}
+
+void BindCameraUniformBlock(GLuint program_id) {
+    GLuint block_index = glGetUniformBlockIndex(program_id, "CameraBlock");
+    if (block_index == GL_INVALID_INDEX) {
+        fprintf(stderr, "[CAMERA] Programa %u nao declara o bloco CameraBlock\n", program_id);
+        return;
+    }
+    glUniformBlockBinding(program_id, block_index, CAMERA_UNIFORM_BINDING);
+}
+
+void UpdateCameraUniforms(const glm::mat4& view, const glm::mat4& projection, const glm::vec4& camera_position) {
+    g_CameraUniforms.view = view;
+    g_CameraUniforms.projection = projection;
+    g_CameraUniforms.inverse_view = glm::inverse(view);
+    g_CameraUniforms.inverse_projection = glm::inverse(projection);
+    g_CameraUniforms.camera_position = camera_position;
+
+    if (g_CameraUniformBufferID == 0)
+        InitCameraUniformBuffer();
+
+    glBindBuffer(GL_UNIFORM_BUFFER, g_CameraUniformBufferID);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(CameraUniforms), &g_CameraUniforms);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
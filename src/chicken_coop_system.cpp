@@ -1,6 +1,8 @@
 #include "chicken_coop_system.h"
 #include "resource_loader.h"
 #include "game_attributes.h"
+#include "frustum.h"
+#include "render_queue.h"
 #include <glad/glad.h>
 #include <glm/mat4x4.hpp>
 #include <glm/gtc/type_ptr.hpp>
@@ -13,15 +15,11 @@
 
 extern glm::vec3 GridToWorld(int gridX, int gridZ);
 extern float GetGroundHeight(int gridX, int gridZ);
-extern void DrawVirtualObject(const char* object_name);
 
 extern glm::mat4 Matrix_Translate(float tx, float ty, float tz);
 extern glm::mat4 Matrix_Scale(float sx, float sy, float sz);
 extern glm::mat4 Matrix_Rotate_Y(float angle);
 
-extern GLint g_model_uniform;
-extern GLint g_object_id_uniform;
-
 // ============================================================================
 // CONSTANTES
 // ============================================================================
@@ -63,19 +61,41 @@ void DrawChickenCoops() {
         return;
     }
 
+    MeshHandle mesh = g_Meshes.chicken_coop;
+    if (mesh < 0 || mesh >= (MeshHandle)g_VirtualScene.size()) {
+        return;
+    }
+
+    // Matrizes de todos os galinheiros ativos, testadas em lote contra o
+    // frustum antes do desenho
+    static std::vector<glm::mat4> models;
+    static AABBBatch batch;
+    static std::vector<unsigned char> visible;
+    models.clear();
+    ClearAABBBatch(batch);
+
     for (const ChickenCoop& coop : g_ChickenCoops) {
         if (!coop.active) {
             continue;
         }
 
-    glm::mat4 model = Matrix_Translate(coop.worldPos.x, coop.worldPos.y, coop.worldPos.z)
+        glm::mat4 model = Matrix_Translate(coop.worldPos.x, coop.worldPos.y, coop.worldPos.z)
             * Matrix_Rotate_Y(coop.rotation)
             * Matrix_Scale(kChickenCoopScale, kChickenCoopScale, kChickenCoopScale)
             * Matrix_Translate(-kChickenCoopPivot.x, -kChickenCoopPivot.y, -kChickenCoopPivot.z);
 
-        glUniformMatrix4fv(g_model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-        glUniform1i(g_object_id_uniform, MODEL_CHICKEN_COOP);
+        models.push_back(model);
+        AddToAABBBatch(batch, g_VirtualScene[mesh].bbox_min, g_VirtualScene[mesh].bbox_max, model);
+    }
+
+    CullAABBBatch(g_ViewFrustum, batch, visible);
+
+    for (size_t i = 0; i < models.size(); i++) {
+        if (!visible[i]) {
+            continue;
+        }
 
-        DrawVirtualObject("ChickenCoop");
+        const glm::mat4& model = models[i];
+        QueueVirtualObject(mesh, SelectMeshLOD(mesh, model), MODEL_CHICKEN_COOP, model);
     }
 }
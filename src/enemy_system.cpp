@@ -2,6 +2,8 @@
 #include "game_attributes.h"
 #include "matrices.h"
 #include "resource_loader.h"
+#include "materials.h"
+#include "render_queue.h"
 #include "hud.h"
 #include <glad/glad.h>
 #include <glm/vec3.hpp>
@@ -15,6 +17,10 @@ std::vector<glm::vec3> g_PathWaypoints;
 
 extern int g_PlayerLives;
 
+// Antecedência com que os modelos e texturas dos próximos inimigos são
+// pedidos ao carregamento sob demanda (veja "resource_loader.h")
+static const float kEnemyPrewarmSeconds = 5.0f;
+
 static std::vector<Wave> g_Waves;
 static int g_CurrentWave;
 static float g_WaveTimer;
@@ -319,22 +325,60 @@ void UpdateAllEnemies(float deltaTime) {
     }
 }
 
-void DrawAllEnemies() {
+void CaptureEnemies(RenderSnapshot& snapshot) {
+    snapshot.enemies.clear();
+    snapshot.upcoming_enemy_types = GetUpcomingEnemyTypes(kEnemyPrewarmSeconds);
     for (const Enemy& enemy : g_Enemies) {
         if (!enemy.active) continue;
-        
+
+        EnemyRenderState state;
+        state.position = enemy.position;
+        state.direction = enemy.direction;
+        state.type = enemy.type;
+        snapshot.enemies.push_back(state);
+    }
+}
+
+void DrawAllEnemies(const RenderSnapshot& snapshot) {
+    // Instâncias agrupadas por tipo de inimigo (modelo), para que cada tipo
+    // seja desenhado com uma única chamada instanciada. A textura vai em cada
+    // instância. Os vetores são estáticos para reaproveitar a memória entre
+    // quadros.
+    static std::vector<InstanceData> instances[ENEMY_TYPE_COUNT];
+
+    for (int type = 0; type < ENEMY_TYPE_COUNT; type++) {
+        instances[type].clear();
+    }
+
+    // Inimigos que ainda não apareceram, mas vão aparecer em breve, são
+    // carregados antes do primeiro desenho
+    for (int type = 0; type < ENEMY_TYPE_COUNT; type++) {
+        if (snapshot.upcoming_enemy_types & (1u << type)) {
+            RequestMesh(g_Meshes.enemies[type]);
+            RequestTextureLayer(GetMaterial(GetEnemyModelID((EnemyType)type)).texture_layer);
+        }
+    }
+
+    for (const EnemyRenderState& enemy : snapshot.enemies) {
         const EnemyRenderInfo& renderInfo = GetEnemyRenderInfo(enemy.type);
-        int modelID = GetEnemyModelID(enemy.type);
         
         float angle = atan2f(enemy.direction.x, enemy.direction.z);
         
         glm::mat4 model = Matrix_Translate(enemy.position.x, enemy.position.y + renderInfo.yOffset, enemy.position.z)
                         * Matrix_Rotate_Y(angle)
                         * Matrix_Scale(renderInfo.scaleX, renderInfo.scaleY, renderInfo.scaleZ);
-       
-        glUniformMatrix4fv(g_model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-        glUniform1i(g_object_id_uniform, modelID);
-        DrawVirtualObject(renderInfo.meshName);
+
+        InstanceData instance;
+        instance.model = model;
+        instance.texture_layer = (GLfloat)GetMaterial(GetEnemyModelID(enemy.type)).texture_layer;
+        instances[enemy.type].push_back(instance);
+    }
+
+    for (int type = 0; type < ENEMY_TYPE_COUNT; type++) {
+        if (instances[type].empty()) continue;
+
+        QueueVirtualObjectInstanced(g_Meshes.enemies[type], GetEnemyModelID((EnemyType)type),
+                                    instances[type].data(), instances[type].size());
     }
 }
 
@@ -432,3 +476,20 @@ bool IsWaveComplete() {
 int GetCurrentWaveNumber() {
     return g_CurrentWave;
 }
+
+unsigned int GetUpcomingEnemyTypes(float seconds) {
+    int wave = g_WaveActive ? g_CurrentWave : g_CurrentWave + 1;
+    if (wave < 0 || wave >= (int)g_Waves.size()) return 0;
+
+    int first = g_WaveActive ? g_NextSpawnIndex : 0;
+    float until = (g_WaveActive ? g_WaveTimer : 0.0f) + seconds;
+
+    unsigned int types = 0;
+    const Wave& upcoming = g_Waves[wave];
+    for (int i = first; i < (int)upcoming.spawns.size(); i++) {
+        if (upcoming.spawns[i].spawnTime <= until) {
+            types |= 1u << upcoming.spawns[i].type;
+        }
+    }
+    return types;
+}
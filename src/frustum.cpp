@@ -0,0 +1,144 @@
+#include "frustum.h"
+#include "render_stats.h"
+#include <glm/geometric.hpp>
+#include <cmath>
+
+// SSE faz parte de todas as CPUs x86-64; nas demais arquiteturas usamos
+// somente o teste escalar.
+#if defined(__SSE__) || defined(_M_X64) || defined(_M_AMD64)
+#include <xmmintrin.h>
+#define FRUSTUM_USE_SSE 1
+#endif
+
+// ============================================================================
+// VARIÁVEIS GLOBAIS
+// ============================================================================
+
+Frustum g_ViewFrustum;
+
+// ============================================================================
+// IMPLEMENTAÇÃO
+// ============================================================================
+
+void ExtractFrustum(const glm::mat4& view_projection, Frustum& frustum) {
+    // Linhas da matriz (a glm armazena por colunas: m[coluna][linha])
+    const glm::mat4& m = view_projection;
+    glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+    glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+    glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+    glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+    // Um ponto está dentro do volume de visualização se -w <= x,y,z <= w
+    frustum.planes[0] = row3 + row0; // Esquerda
+    frustum.planes[1] = row3 - row0; // Direita
+    frustum.planes[2] = row3 + row1; // Baixo
+    frustum.planes[3] = row3 - row1; // Cima
+    frustum.planes[4] = row3 + row2; // Near
+    frustum.planes[5] = row3 - row2; // Far
+
+    for (int i = 0; i < 6; i++) {
+        float length = glm::length(glm::vec3(frustum.planes[i]));
+        if (length > 0.0f)
+            frustum.planes[i] /= length;
+    }
+}
+
+void SetViewFrustum(const glm::mat4& view, const glm::mat4& projection) {
+    ExtractFrustum(projection * view, g_ViewFrustum);
+}
+
+void ClearAABBBatch(AABBBatch& batch) {
+    batch.center_x.clear();
+    batch.center_y.clear();
+    batch.center_z.clear();
+    batch.extent_x.clear();
+    batch.extent_y.clear();
+    batch.extent_z.clear();
+}
+
+void AddToAABBBatch(AABBBatch& batch, const glm::vec3& bbox_min, const glm::vec3& bbox_max, const glm::mat4& model) {
+    glm::vec3 center = 0.5f * (bbox_min + bbox_max);
+    glm::vec3 extent = 0.5f * (bbox_max - bbox_min);
+
+    // Centro transformado, e a meia-extensão da AABB que envolve a caixa
+    // transformada (soma dos módulos das colunas da parte linear)
+    glm::vec4 world_center = model * glm::vec4(center, 1.0f);
+    glm::vec3 world_extent;
+    for (int axis = 0; axis < 3; axis++) {
+        world_extent[axis] = std::fabs(model[0][axis]) * extent.x
+                           + std::fabs(model[1][axis]) * extent.y
+                           + std::fabs(model[2][axis]) * extent.z;
+    }
+
+    batch.center_x.push_back(world_center.x);
+    batch.center_y.push_back(world_center.y);
+    batch.center_z.push_back(world_center.z);
+    batch.extent_x.push_back(world_extent.x);
+    batch.extent_y.push_back(world_extent.y);
+    batch.extent_z.push_back(world_extent.z);
+}
+
+size_t CullAABBBatch(const Frustum& frustum, const AABBBatch& batch, std::vector<unsigned char>& visible) {
+    size_t count = batch.center_x.size();
+    visible.resize(count);
+
+    size_t num_visible = 0;
+    size_t i = 0;
+
+#ifdef FRUSTUM_USE_SSE
+    // Quatro caixas por iteração. Uma caixa está fora do frustum se está
+    // inteiramente atrás de algum plano: d(centro) + r < 0, onde r é a
+    // projeção da meia-extensão sobre a normal do plano.
+    for (; i + 4 <= count; i += 4) {
+        __m128 cx = _mm_loadu_ps(&batch.center_x[i]);
+        __m128 cy = _mm_loadu_ps(&batch.center_y[i]);
+        __m128 cz = _mm_loadu_ps(&batch.center_z[i]);
+        __m128 ex = _mm_loadu_ps(&batch.extent_x[i]);
+        __m128 ey = _mm_loadu_ps(&batch.extent_y[i]);
+        __m128 ez = _mm_loadu_ps(&batch.extent_z[i]);
+
+        __m128 zero = _mm_setzero_ps();
+        __m128 inside = _mm_cmpeq_ps(zero, zero); // Todos os bits em 1
+
+        for (int p = 0; p < 6; p++) {
+            const glm::vec4& plane = frustum.planes[p];
+
+            __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(cx, _mm_set1_ps(plane.x)),
+                                             _mm_mul_ps(cy, _mm_set1_ps(plane.y))),
+                                  _mm_add_ps(_mm_mul_ps(cz, _mm_set1_ps(plane.z)),
+                                             _mm_set1_ps(plane.w)));
+            __m128 r = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ex, _mm_set1_ps(std::fabs(plane.x))),
+                                             _mm_mul_ps(ey, _mm_set1_ps(std::fabs(plane.y)))),
+                                  _mm_mul_ps(ez, _mm_set1_ps(std::fabs(plane.z))));
+
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(d, r), zero));
+        }
+
+        int mask = _mm_movemask_ps(inside);
+        for (int k = 0; k < 4; k++) {
+            visible[i + k] = (unsigned char)((mask >> k) & 1);
+            num_visible += visible[i + k];
+        }
+    }
+#endif
+
+    // Caixas restantes (ou todas, sem SSE)
+    for (; i < count; i++) {
+        bool inside = true;
+        for (int p = 0; p < 6 && inside; p++) {
+            const glm::vec4& plane = frustum.planes[p];
+            float d = batch.center_x[i] * plane.x + batch.center_y[i] * plane.y
+                    + batch.center_z[i] * plane.z + plane.w;
+            float r = batch.extent_x[i] * std::fabs(plane.x) + batch.extent_y[i] * std::fabs(plane.y)
+                    + batch.extent_z[i] * std::fabs(plane.z);
+            inside = (d + r >= 0.0f);
+        }
+        visible[i] = inside ? 1 : 0;
+        num_visible += visible[i];
+    }
+
+    g_RenderStats.objects_visible += (int)num_visible;
+    g_RenderStats.objects_culled  += (int)(count - num_visible);
+
+    return num_visible;
+}
@@ -2,11 +2,16 @@
 #include "game_attributes.h"
 #include "enemy_system.h"
 #include <GLFW/glfw3.h>
-#include <sstream>
-#include <iomanip>
-
-// Declaração externa da função de text rendering (definida em main.cpp)
-extern void TextRendering_PrintString(GLFWwindow* window, const std::string &str, float x, float y, float scale);
+#include <cstdio>
+#include <climits>
+
+// Declaração externa das funções de texto retido (definidas em textrendering.cpp)
+struct TextBlock;
+extern TextBlock* TextRendering_CreateBlock();
+extern void TextRendering_ClearBlock(TextBlock* block);
+extern void TextRendering_PrintStringToBlock(TextBlock* block, GLFWwindow* window, const char* str,
+                                             float x, float y, float scale);
+extern void TextRendering_DrawBlock(TextBlock* block);
 extern int g_PlayerLives;
 
 int g_PlayerMoney;
@@ -14,6 +19,10 @@ int g_PlayerMoney;
 // Variáveis globais de mensagens
 std::deque<std::string> g_ConsoleMessages;
 
+// Incrementado a cada alteração de g_ConsoleMessages, para o HUD saber
+// quando redesenhar o console (começa em 1 para diferir de um HUDState novo)
+static unsigned int g_ConsoleRevision = 1;
+
 // ==================== ECONOMIA ====================
 
 void InitializeEconomy() {
@@ -41,84 +50,158 @@ void AddConsoleMessage(const std::string& message) {
     while (g_ConsoleMessages.size() > MAX_CONSOLE_MESSAGES) {
         g_ConsoleMessages.pop_front();
     }
+    ++g_ConsoleRevision;
 }
 
 void ClearConsoleMessages() {
     g_ConsoleMessages.clear();
+    ++g_ConsoleRevision;
 }
 
 // ==================== HUD ====================
 
+void CaptureHUDState(HUDState& state) {
+    state.money = g_PlayerMoney;
+    state.lives = g_PlayerLives;
+    state.wave = GetCurrentWaveNumber();
+    state.waveActive = IsWaveActive();
+
+    // Cada cópia guarda suas mensagens; só as copiamos quando mudaram
+    if (state.consoleRevision != g_ConsoleRevision) {
+        state.consoleMessages = g_ConsoleMessages;
+        state.consoleRevision = g_ConsoleRevision;
+    }
+}
+
 void InitializeHUD() {
     InitializeEconomy();
     ClearConsoleMessages();
     AddConsoleMessage("Bem-vindo ao Ovocidio!");
 }
 
-void RenderHUD(GLFWwindow* window, int screenWidth, int screenHeight) {
-    std::stringstream moneyText;
-    moneyText << "Dinheiro: $" << g_PlayerMoney;
-    
-    float moneyX = -0.95f;
-    float moneyY = 0.9f;
-    float moneyScale = 1.5f;
-    
-    TextRendering_PrintString(window, moneyText.str(), moneyX, moneyY, moneyScale);
+// O HUD é "retido": cada elemento guarda o valor que está exibindo, e o
+// texto só é formatado (em buffers fixos, sem alocação) e a geometria só é
+// regerada quando algum valor muda. Nos demais quadros, RenderHUD() apenas
+// redesenha o bloco de texto que já está na GPU.
+
+struct HUDTextWidget {
+    char text[64];
+    float x, y, scale;
+};
+
+static TextBlock* g_HUDTextBlock = NULL;
+static bool g_HUDDirty = true;
+
+static HUDTextWidget g_MoneyWidget    = { "", -0.95f,  0.9f, 1.5f };
+static HUDTextWidget g_LivesWidget    = { "", -0.95f,  0.8f, 1.3f };
+static HUDTextWidget g_WaveWidget     = { "", -0.95f,  0.7f, 1.2f };
+static HUDTextWidget g_GameOverWidget = { "=== GAME OVER ===", -0.3f, 0.0f, 2.0f };
+
+// Valores exibidos atualmente (INT_MIN: ainda não formatado)
+static int g_ShownMoney = INT_MIN;
+static int g_ShownLives = INT_MIN;
+static int g_ShownWave = INT_MIN;
+static bool g_ShownWaveActive = false;
+static unsigned int g_ShownConsoleRevision = 0;
+static int g_ShownScreenWidth = 0;
+static int g_ShownScreenHeight = 0;
+
+static const HUDTextWidget g_InstructionWidgets[] = {
+    { "Duplo-clique: Abrir menu",    0.4f, 0.9f,  0.8f },
+    { "ENTER: Iniciar proxima wave", 0.4f, 0.81f, 0.8f },
+    { "1/2: Comprar torre",          0.4f, 0.78f, 0.8f },
+    { "1: Torre Galinha ($100)",     0.4f, 0.75f, 0.8f },
+    { "2: Torre Beagle ($200)",      0.4f, 0.72f, 0.8f },
+};
+
+// Console (canto inferior esquerdo)
+static const float CONSOLE_X = -0.95f;
+static const float CONSOLE_Y = -0.7f;
+static const float CONSOLE_SCALE = 1.0f;
+static const float CONSOLE_LINE_SPACING = 0.08f;
+
+// Reformata os elementos cujos valores mudaram desde o último quadro
+static void UpdateHUDWidgets(const HUDState& state, int screenWidth, int screenHeight) {
+    if (state.money != g_ShownMoney) {
+        g_ShownMoney = state.money;
+        snprintf(g_MoneyWidget.text, sizeof(g_MoneyWidget.text), "Dinheiro: $%d", state.money);
+        g_HUDDirty = true;
+    }
 
-   std::stringstream livesText;
-    livesText << "Vidas: " << g_PlayerLives << "/" << PLAYER_STARTING_LIVES;
-    
+    if (state.lives != g_ShownLives) {
+        // O texto de GAME OVER depende das vidas, e é regerado junto
+        g_ShownLives = state.lives;
+        snprintf(g_LivesWidget.text, sizeof(g_LivesWidget.text), "Vidas: %d/%d", state.lives, PLAYER_STARTING_LIVES);
+        g_HUDDirty = true;
+    }
 
-    TextRendering_PrintString(window, livesText.str(), -0.95f, 0.8f, 1.3f);
-    
-    // ===== WAVE INFO =====
-    int currentWave = GetCurrentWaveNumber();
-    bool waveActive = IsWaveActive();
-    
-    std::stringstream waveText;
-    if (currentWave >= 0) {
-        if (waveActive) {
-            waveText << "Wave " << (currentWave + 1) << " - EM ANDAMENTO";
+    int currentWave = state.wave;
+    bool waveActive = state.waveActive;
+    if (currentWave != g_ShownWave || waveActive != g_ShownWaveActive) {
+        g_ShownWave = currentWave;
+        g_ShownWaveActive = waveActive;
+        if (currentWave < 0) {
+            snprintf(g_WaveWidget.text, sizeof(g_WaveWidget.text), "Pressione ENTER para iniciar Wave 1");
+        } else if (waveActive) {
+            snprintf(g_WaveWidget.text, sizeof(g_WaveWidget.text), "Wave %d - EM ANDAMENTO", currentWave + 1);
         } else {
-            waveText << "Wave " << (currentWave + 1) << " COMPLETA!";
+            snprintf(g_WaveWidget.text, sizeof(g_WaveWidget.text), "Wave %d COMPLETA!", currentWave + 1);
         }
-    } else {
-        waveText << "Pressione ENTER para iniciar Wave 1";
+        g_HUDDirty = true;
     }
-    TextRendering_PrintString(window, waveText.str(), -0.95f, 0.7f, 1.2f);
-    
-    // ===== GAME OVER =====
-    if (g_PlayerLives <= 0) {
-        std::stringstream gameOverText;
-        gameOverText << "=== GAME OVER ===";
-        TextRendering_PrintString(window, gameOverText.str(), -0.3f, 0.0f, 2.0f);
-                
+
+    if (state.consoleRevision != g_ShownConsoleRevision) {
+        g_ShownConsoleRevision = state.consoleRevision;
+        g_HUDDirty = true;
     }
 
-    // ===== RENDERIZAR MENSAGENS DO CONSOLE (CANTO INFERIOR ESQUERDO) =====
-    float messageX = -0.95f;
-    float messageY = -0.7f;
-    float messageScale = 1.0f;
-    float lineSpacing = 0.08f;
-    
-    // Título do console
-    TextRendering_PrintString(window, "Console:", messageX, messageY, messageScale);
-    
+    // A posição dos glifos depende do tamanho da janela
+    if (screenWidth != g_ShownScreenWidth || screenHeight != g_ShownScreenHeight) {
+        g_ShownScreenWidth = screenWidth;
+        g_ShownScreenHeight = screenHeight;
+        g_HUDDirty = true;
+    }
+}
+
+static void PrintWidget(GLFWwindow* window, const HUDTextWidget& widget) {
+    TextRendering_PrintStringToBlock(g_HUDTextBlock, window, widget.text, widget.x, widget.y, widget.scale);
+}
+
+// Regera a geometria de todo o HUD a partir dos textos já formatados
+static void RebuildHUDText(GLFWwindow* window, const HUDState& state) {
+    TextRendering_ClearBlock(g_HUDTextBlock);
+
+    PrintWidget(window, g_MoneyWidget);
+    PrintWidget(window, g_LivesWidget);
+    PrintWidget(window, g_WaveWidget);
+
+    if (state.lives <= 0)
+        PrintWidget(window, g_GameOverWidget);
+
     // Mensagens (da mais antiga para a mais recente, de cima para baixo)
-    float currentY = messageY - lineSpacing;
-    for (size_t i = 0; i < g_ConsoleMessages.size(); i++) {
-        TextRendering_PrintString(window, g_ConsoleMessages[i], messageX, currentY, messageScale);
-        currentY -= lineSpacing;
+    TextRendering_PrintStringToBlock(g_HUDTextBlock, window, "Console:", CONSOLE_X, CONSOLE_Y, CONSOLE_SCALE);
+    float currentY = CONSOLE_Y - CONSOLE_LINE_SPACING;
+    for (size_t i = 0; i < state.consoleMessages.size(); i++) {
+        TextRendering_PrintStringToBlock(g_HUDTextBlock, window, state.consoleMessages[i].c_str(), CONSOLE_X, currentY, CONSOLE_SCALE);
+        currentY -= CONSOLE_LINE_SPACING;
     }
-    
-    // ===== INSTRUÇÕES (CANTO SUPERIOR DIREITO) =====
-    float instrX = 0.4f;
-    float instrY = 0.9f;
-    float instrScale = 0.8f;
-    
-    TextRendering_PrintString(window, "Duplo-clique: Abrir menu", instrX, instrY, instrScale);
-    TextRendering_PrintString(window, "ENTER: Iniciar proxima wave", instrX, instrY - 0.09f, instrScale);
-    TextRendering_PrintString(window, "1/2: Comprar torre", instrX, instrY - 0.12f, instrScale);
-    TextRendering_PrintString(window, "1: Torre Galinha ($100)", instrX, instrY - 0.15f, instrScale);
-    TextRendering_PrintString(window, "2: Torre Beagle ($200)", instrX, instrY - 0.18f, instrScale);
+
+    const size_t numInstructions = sizeof(g_InstructionWidgets) / sizeof(g_InstructionWidgets[0]);
+    for (size_t i = 0; i < numInstructions; i++)
+        PrintWidget(window, g_InstructionWidgets[i]);
+}
+
+void RenderHUD(GLFWwindow* window, const HUDState& state, int screenWidth, int screenHeight) {
+    if (g_HUDTextBlock == NULL)
+        g_HUDTextBlock = TextRendering_CreateBlock();
+
+    UpdateHUDWidgets(state, screenWidth, screenHeight);
+
+    if (g_HUDDirty) {
+        RebuildHUDText(window, state);
+        g_HUDDirty = false;
+    }
+
+    // Sem alterações, nenhum dado é enviado à GPU: só o desenho
+    TextRendering_DrawBlock(g_HUDTextBlock);
 }
@@ -37,6 +37,16 @@
 #include "hud.h"
 #include "enemy_system.h"
 #include "projectile_system.h"
+#include "map_mesh.h"
+#include "frustum.h"
+#include "render_stats.h"
+#include "camera.h"
+#include "materials.h"
+#include "render_queue.h"
+#include "simulation.h"
+#include "worker_pool.h"
+#include "memory_stats.h"
+#include "asset_archive.h"
 
 // Declaração de funções auxiliares para renderizar texto dentro da janela
 // OpenGL. Estas funções estão definidas no arquivo "textrendering.cpp".
@@ -44,9 +54,11 @@ void TextRendering_Init();
 float TextRendering_LineHeight(GLFWwindow* window);
 float TextRendering_CharWidth(GLFWwindow* window);
 void TextRendering_PrintString(GLFWwindow* window, const std::string &str, float x, float y, float scale = 1.0f);
+void TextRendering_Flush();
 
 // Função para mostrar FPS
 void TextRendering_ShowFramesPerSecond(GLFWwindow* window);
+void TextRendering_ShowRenderStats(GLFWwindow* window);
 
 // Função para desenhar o grid do mapa
 void DrawMapGrid();
@@ -65,6 +77,9 @@ void ScrollCallback(GLFWwindow* window, double xoffset, double yoffset);
 // Pilha que guardará as matrizes de modelagem.
 std::stack<glm::mat4>  g_MatrixStack;
 
+// Estatísticas de renderização do quadro atual. Veja "render_stats.h".
+RenderStats g_RenderStats;
+
 // Razão de proporção da janela (largura/altura). Veja função FramebufferSizeCallback().
 float g_ScreenRatio = 1.0f;
 
@@ -154,7 +169,7 @@ void SetupCallbacks(GLFWwindow* window);
 void InitializeOpenGL();
 void LoadGameResources();
 void UpdateCameras(glm::mat4& view, glm::mat4& projection);
-void RenderScene(GLFWwindow* window, const glm::mat4& view, const glm::mat4& projection);
+void RenderScene(GLFWwindow* window, const RenderSnapshot& snapshot, const glm::mat4& view, const glm::mat4& projection);
 
 // Retorna a altura do terreno baseada no tipo de célula
 float GetGroundHeight(int gridX, int gridZ) {
@@ -183,10 +198,18 @@ int main(int argc, char* argv[])
     // Inicializa OpenGL e imprime informações da GPU
     InitializeOpenGL();
 
+    // Pacote de recursos (ou arquivos avulsos) e threads usadas para ler e
+    // processar os recursos
+    InitializeAssets();
+    StartWorkerPool();
+
     LoadGameResources();
 
     InitializeMap();
 
+    // Pré-processa o grid em uma malha estática (veja "map_mesh.cpp")
+    BuildMapMesh();
+
     InitializeHUD();
 
     InitializeTowers();
@@ -213,19 +236,30 @@ int main(int argc, char* argv[])
     glCullFace(GL_BACK);
     glFrontFace(GL_CCW);
 
-    float prevTime = (float)glfwGetTime();
+    // Os dados temporários do carregamento inicial já foram liberados. Com o
+    // carregamento sob demanda, os modelos do jogo ainda não foram lidos: o
+    // RSS com eles é informado por UploadStreamedAssets(), quando os pedidos
+    // terminam (com -DDISABLE_ASSET_STREAMING, este já é o RSS do jogo)
+    PrintProcessMemoryUsage("Depois do carregamento inicial");
+
+    // Torres, inimigos, waves e projéteis são atualizados em outra thread
+    // (veja "simulation.h"); este loop só desenha e trata a entrada.
+    StartSimulationThread();
+
     while (!glfwWindowShouldClose(window))
     {
-        // Calcula deltaTime para física
-        float currentTime = (float)glfwGetTime();
-        float deltaTime = currentTime - prevTime;
-        prevTime = currentTime;
-        
-        UpdateAllTowersPhysics(deltaTime);
-        UpdateAllEnemies(deltaTime);
-        UpdateWaveSystem(deltaTime);
-        UpdateProjectiles(deltaTime);
-        
+        // Pegamos a cópia mais recente do estado do jogo, sem esperar pela
+        // simulação
+        const RenderSnapshot& snapshot = AcquireRenderSnapshot();
+
+        // Modelos e texturas lidos sob demanda desde o último quadro vão
+        // para a GPU antes do desenho (veja "resource_loader.h")
+        UploadStreamedAssets();
+
+        // Programas de GPU cuja compilação terminou; até lá, os materiais
+        // usam um programa de reserva (veja "materials.h")
+        UpdatePendingGpuPrograms();
+
         // Aqui executamos as operações de renderização
 
         // Definimos a cor do "fundo" do framebuffer como branco.  Tal cor é
@@ -244,7 +278,7 @@ int main(int argc, char* argv[])
         glm::mat4 view, projection;
         UpdateCameras(view, projection);
 
-        RenderScene(window, view, projection);
+        RenderScene(window, snapshot, view, projection);
 
         // O framebuffer onde OpenGL executa as operações de renderização não
         // é o mesmo que está sendo mostrado para o usuário, caso contrário
@@ -261,6 +295,10 @@ int main(int argc, char* argv[])
         glfwPollEvents();
     }
 
+    StopSimulationThread();
+    StopWorkerPool();
+    ShutdownAssets();
+
     // Finalizamos o uso dos recursos do sistema operacional
     glfwTerminate();
 
@@ -306,34 +344,21 @@ bool GetGridPositionFromMouse(GLFWwindow* window, double mouseX, double mouseY,
     float x = (2.0f * mouseX) / width - 1.0f;
     float y = 1.0f - (2.0f * mouseY) / height;
     
+    // Usamos as matrizes do último quadro desenhado (veja "camera.h"), já
+    // invertidas em UpdateCameras(). Antes do primeiro quadro não há câmera.
+    const CameraUniforms& camera = g_CameraUniforms;
+    if (camera.camera_position.w == 0.0f) return false;
+
     // Ray em clip space
     glm::vec4 rayClip = glm::vec4(x, y, -1.0f, 1.0f);
     
     // Converte para view space
-    float fov = M_PI / 3.0f;
-    glm::mat4 proj = Matrix_Perspective(fov, g_ScreenRatio, -0.1f, -50.0f);
-    glm::vec4 rayEye = glm::inverse(proj) * rayClip;
+    glm::vec4 rayEye = camera.inverse_projection * rayClip;
     rayEye = glm::vec4(rayEye.x, rayEye.y, -1.0f, 0.0f);
     
-    // Calcula posição e direção da câmera baseado no modo atual
-    glm::vec4 cameraPos;
-    
-    if (g_UseLookDownCamera) {
-        // CÂMERA LOOKDOWN
-        cameraPos = g_CameraLookDownPosition;  
-    } else {
-        // CÂMERA LOOK-AT: Calcula posição esférica
-        float r = g_CameraDistance;
-        float y_cam = r * sin(g_CameraPhi);
-        float z_cam = r * cos(g_CameraPhi) * cos(g_CameraTheta);
-        float x_cam = r * cos(g_CameraPhi) * sin(g_CameraTheta);
-        
-        cameraPos = glm::vec4(x_cam, y_cam, z_cam, 1.0f);
-
-    }
-    glm::mat4 view = Matrix_Camera_View(cameraPos, g_CameraView, g_CameraUp);
-    glm::vec3 rayDir = glm::normalize(glm::vec3(glm::inverse(view) * rayEye));
-    glm::vec3 rayOrigin = glm::vec3(cameraPos);
+    // Converte para world space, a partir da posição da câmera
+    glm::vec3 rayDir = glm::normalize(glm::vec3(camera.inverse_view * rayEye));
+    glm::vec3 rayOrigin = glm::vec3(camera.camera_position);
     
     // Intersecção raio-plano (Y=0)
     if (glm::abs(rayDir.y) < 0.001f) return false;
@@ -349,6 +374,22 @@ bool GetGridPositionFromMouse(GLFWwindow* window, double mouseX, double mouseY,
     return (outGridX >= 0 && outGridX < MAP_WIDTH && outGridZ >= 0 && outGridZ < MAP_HEIGHT);
 }
 
+// Os callbacks abaixo rodam na thread de renderização: ações que alteram o
+// estado do jogo viram comandos para a simulação (veja "simulation.h")
+static GameCommand MakeGameCommand(GameCommandType type)
+{
+    GameCommand command = GameCommand();
+    command.type = type;
+    return command;
+}
+
+static void PushSpawnEnemyCommand(EnemyType type)
+{
+    GameCommand command = MakeGameCommand(GAME_COMMAND_SPAWN_ENEMY);
+    command.enemy_type = type;
+    PushGameCommand(command);
+}
+
 // Função callback chamada sempre que o usuário aperta algum dos botões do mouse
 void MouseButtonCallback(GLFWwindow* window, int button, int action, int mods)
 {
@@ -369,7 +410,10 @@ void MouseButtonCallback(GLFWwindow* window, int button, int action, int mods)
                 gridX == g_LastClickGridX && gridZ == g_LastClickGridZ) {
                 // CLIQUE DUPLO: Abre menu de compra
                 printf("[INPUT] Clique duplo detectado em (%d, %d)\n", gridX, gridZ);
-                OpenTowerMenu(gridX, gridZ);
+                GameCommand command = MakeGameCommand(GAME_COMMAND_OPEN_TOWER_MENU);
+                command.gridX = gridX;
+                command.gridZ = gridZ;
+                PushGameCommand(command);
                 
                 // Reset para evitar triplo clique
                 g_LastClickTime = 0.0;
@@ -377,15 +421,10 @@ void MouseButtonCallback(GLFWwindow* window, int button, int action, int mods)
                 g_LastClickGridZ = -1;
             } else {
                 // CLIQUE SIMPLES: Seleciona torre
-                int towerIndex = SelectTowerAtPosition(gridX, gridZ);
-                if (towerIndex >= 0) {
-                    g_SelectedTowerIndex = towerIndex;
-                    ShowTowerInfo(towerIndex);
-                    printf("[SELECAO] Torre #%d selecionada\n", towerIndex + 1);
-                } else {
-                    g_SelectedTowerIndex = -1;
-                    printf("[SELECAO] Nenhuma torre nessa posicao\n");
-                }
+                GameCommand command = MakeGameCommand(GAME_COMMAND_SELECT_CELL);
+                command.gridX = gridX;
+                command.gridZ = gridZ;
+                PushGameCommand(command);
                 
                 // Salva tempo e posição do clique
                 g_LastClickTime = currentTime;
@@ -407,12 +446,7 @@ void MouseButtonCallback(GLFWwindow* window, int button, int action, int mods)
     if (button == GLFW_MOUSE_BUTTON_RIGHT && action == GLFW_PRESS)
     {
         // BOTÃO DIREITO: Desseleciona torre ou fecha menu
-        if (g_ShowTowerMenu) {
-            CloseTowerMenu();
-        } else {
-            g_SelectedTowerIndex = -1;
-            printf("[SELECAO] Torre desselecionada\n");
-        }
+        PushGameCommand(MakeGameCommand(GAME_COMMAND_CANCEL));
         
         // Guarda estado do mouse
         glfwGetCursorPos(window, &g_LastCursorPosX, &g_LastCursorPosY);
@@ -507,19 +541,19 @@ void KeyCallback(GLFWwindow* window, int key, int scancode, int action, int mod)
     if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
         glfwSetWindowShouldClose(window, GL_TRUE);
 
-    // Sistema de compra de torres
+    // Sistema de compra de torres (só tem efeito com o menu aberto)
     if (key == GLFW_KEY_1 && action == GLFW_PRESS)
     {
-        if (g_ShowTowerMenu) {
-            BuyTower(TOWER_CHICKEN);
-        }
+        GameCommand command = MakeGameCommand(GAME_COMMAND_BUY_TOWER);
+        command.tower_type = TOWER_CHICKEN;
+        PushGameCommand(command);
     }
     
     if (key == GLFW_KEY_2 && action == GLFW_PRESS)
     {
-        if (g_ShowTowerMenu) {
-            BuyTower(TOWER_BEAGLE);
-        }
+        GameCommand command = MakeGameCommand(GAME_COMMAND_BUY_TOWER);
+        command.tower_type = TOWER_BEAGLE;
+        PushGameCommand(command);
     }
 
     // Tecla C: Alterna entre look down e câmera look-at
@@ -531,39 +565,34 @@ void KeyCallback(GLFWwindow* window, int key, int scancode, int action, int mod)
     // Tecla E: Spawna um lobo (teste de inimigos)
     if (key == GLFW_KEY_E && action == GLFW_PRESS)
     {
-        SpawnEnemy(ENEMY_WOLF);
+        PushSpawnEnemyCommand(ENEMY_WOLF);
         printf("[TESTE] Lobo spawnado!\n");
     }
     
     // Tecla ENTER: Inicia próxima wave
     if (key == GLFW_KEY_ENTER && action == GLFW_PRESS)
     {
-        if (!IsWaveActive()) {
-            int nextWave = GetCurrentWaveNumber() + 1;
-            StartWave(nextWave);
-        } else {
-            printf("[WAVE] Wave ja esta ativa!\n");
-        }
+        PushGameCommand(MakeGameCommand(GAME_COMMAND_START_NEXT_WAVE));
     }
     
     // Tecla H: Spawna um gavião (teste de inimigos)
     if (key == GLFW_KEY_H && action == GLFW_PRESS)
     {
-        SpawnEnemy(ENEMY_HAWK);
+        PushSpawnEnemyCommand(ENEMY_HAWK);
         printf("[TESTE] Gaviao spawnado!\n");
     }
     
     // Tecla F: Spawna uma raposa (teste de inimigos)
     if (key == GLFW_KEY_F && action == GLFW_PRESS)
     {
-        SpawnEnemy(ENEMY_FOX);
+        PushSpawnEnemyCommand(ENEMY_FOX);
         printf("[TESTE] Raposa spawnada!\n");
     }
     
     // Tecla R: Spawna um rato (teste de inimigos)
     if (key == GLFW_KEY_R && action == GLFW_PRESS)
     {
-        SpawnEnemy(ENEMY_RAT);
+        PushSpawnEnemyCommand(ENEMY_RAT);
         printf("[TESTE] Rato spawnado!\n");
     }
     
@@ -612,6 +641,25 @@ void TextRendering_ShowFramesPerSecond(GLFWwindow* window)
     TextRendering_PrintString(window, buffer, 1.0f-(numchars + 1)*charwidth, 1.0f-lineheight, 1.0f);
 }
 
+// Escrevemos na tela, à esquerda do FPS, as estatísticas de renderização do
+// quadro atual (veja "render_stats.h").
+void TextRendering_ShowRenderStats(GLFWwindow* window)
+{
+    if ( !g_ShowInfoText )
+        return;
+
+    char buffer[64];
+    int numchars = snprintf(buffer, 64, "%d objetos, %d cortados, %d draws",
+                            g_RenderStats.objects_visible, g_RenderStats.objects_culled,
+                            g_RenderStats.draw_calls);
+
+    float lineheight = TextRendering_LineHeight(window);
+    float charwidth = TextRendering_CharWidth(window);
+
+    // Deixamos espaço para o texto do FPS ("????.?? fps")
+    TextRendering_PrintString(window, buffer, 1.0f-(numchars + 14)*charwidth, 1.0f-lineheight, 1.0f);
+}
+
 // Inicializa janela GLFW e contexto OpenGL
 GLFWwindow* InitializeWindow()
 {
@@ -695,28 +743,36 @@ void InitializeOpenGL()
 
 void LoadGameResources()
 {
-    LoadShadersFromFiles();
-
-    // Carregamos as imagens para serem utilizadas como textura
-    LoadTextureImage("../../data/textures/grid/grass.jpg");
-    LoadTextureImage("../../data/textures/grid/path.jpg");
-    LoadTextureImage("../../data/textures/towers/chicken.png");
-    LoadTextureImage("../../data/textures/guns/thompson.png");
-    LoadTextureImage("../../data/textures/towers/beagle.png");
-    LoadTextureImage("../../data/textures/guns/ak47.jpg");
-    LoadTextureImage("../../data/textures/enemies/hawk.png");
-    LoadTextureImage("../../data/textures/enemies/fox.png");
-    LoadTextureImage("../../data/textures/enemies/wolf.png");
-    LoadTextureImage("../../data/textures/enemies/rat.png");
-    LoadTextureImage("../../data/textures/environment/ChickenCoop.png");
-    LoadTextureImage("../../data/textures/projectile/Egg.png");
-
-    ObjModel planemodel("../../data/models/plane.obj");
-    ComputeNormals(&planemodel);
-    BuildTrianglesAndAddToVirtualScene(&planemodel);
-
-    // Carrega todos os modelos do Tower Defense
-    LoadAllGameModels(g_VirtualScene);
+    double start_time = glfwGetTime();
+
+    LoadMaterialPrograms();
+    InitCameraUniformBuffer();
+
+    // Registramos as imagens para serem utilizadas como textura. A ordem
+    // define a camada de cada uma (veja a tabela em "materials.cpp"); cada
+    // imagem só é lida quando é usada pela primeira vez
+    LoadTextureImage("data/textures/grid/grass.jpg");
+    LoadTextureImage("data/textures/grid/path.jpg");
+    LoadTextureImage("data/textures/towers/chicken.png");
+    LoadTextureImage("data/textures/guns/thompson.png");
+    LoadTextureImage("data/textures/towers/beagle.png");
+    LoadTextureImage("data/textures/guns/ak47.jpg");
+    LoadTextureImage("data/textures/enemies/hawk.png");
+    LoadTextureImage("data/textures/enemies/fox.png");
+    LoadTextureImage("data/textures/enemies/wolf.png");
+    LoadTextureImage("data/textures/enemies/rat.png");
+    LoadTextureImage("data/textures/environment/ChickenCoop.png");
+    LoadTextureImage("data/textures/projectile/Egg.png");
+
+    // Registra os modelos do Tower Defense, que também são lidos sob
+    // demanda, em paralelo, pelas threads de trabalho (veja "worker_pool.h");
+    // até lá uma esfera é desenhada no lugar de cada um
+    LoadAllGameModels();
+
+    CreateTextureArray();
+
+    printf("[LOAD] Recursos carregados em %.2f s (%d threads de trabalho)\n",
+           glfwGetTime() - start_time, GetWorkerCount());
 }
 
 void UpdateCameras(glm::mat4& view, glm::mat4& projection)
@@ -757,78 +813,71 @@ void UpdateCameras(glm::mat4& view, glm::mat4& projection)
         float field_of_view = M_PI / 3.0f;
         projection = Matrix_Perspective(field_of_view, g_ScreenRatio, nearplane, farplane);
 
+        // Enviamos as matrizes, suas inversas e a posição da câmera para a
+        // GPU, uma única vez por quadro. Veja "shader_vertex.glsl" e
+        // "shader_fragment.glsl", onde estas são efetivamente utilizadas.
+        UpdateCameraUniforms(view, projection, camera_position_c);
 }
 
-void RenderScene(GLFWwindow* window, const glm::mat4& view, const glm::mat4& projection)
+void RenderScene(GLFWwindow* window, const RenderSnapshot& snapshot, const glm::mat4& view, const glm::mat4& projection)
 {
-    // Pedimos para a GPU utilizar o programa de GPU criado acima (contendo
-    // os shaders de vértice e fragmentos).
-    glUseProgram(g_GpuProgramID);
+    // Os programas de GPU (um por classe de material) são ativados por
+    // BindMaterial() ao enviar a fila de renderização. Veja "materials.h".
+    BeginMaterialFrame();
+
+    // As matrizes "view" e "projection" já foram enviadas para a GPU em
+    // UpdateCameras(), no uniform buffer da câmera (veja "camera.h").
+
+    // Descartamos os desenhos e instâncias do quadro anterior
+    BeginRenderQueue();
+
+    // Câmera usada na escolha do nível de detalhe (LOD) dos modelos
+    int framebufferWidth, framebufferHeight;
+    glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+    SetLODCamera(view, projection, (float)framebufferHeight);
 
-    // Enviamos as matrizes "view" e "projection" para a placa de vídeo
-    // (GPU). Veja o arquivo "shader_vertex.glsl", onde estas são
-    // efetivamente aplicadas em todos os pontos.
-    glUniformMatrix4fv(g_view_uniform       , 1 , GL_FALSE , glm::value_ptr(view));
-    glUniformMatrix4fv(g_projection_uniform , 1 , GL_FALSE , glm::value_ptr(projection));
+    // Frustum de visualização usado para descartar objetos fora da tela
+    g_RenderStats = RenderStats();
+    SetViewFrustum(view, projection);
 
-    // Desenhamos o grid do mapa (Tower Defense)
+    // Enfileiramos o grid do mapa (Tower Defense)
     DrawMapGrid();
 
-    // Desenhamos todos os objetos do jogo
-    DrawAllTowers();
+    // Enfileiramos todos os objetos do jogo. A ordem não importa: a fila é
+    // ordenada por programa de GPU, VAO, material e profundidade antes do
+    // envio (veja "render_queue.h").
+    DrawAllTowers(snapshot);
     DrawChickenCoops();
-    DrawTowerRangeCircle();
-    DrawAllEnemies();
+    DrawTowerRangeCircle(snapshot);
+    DrawAllEnemies(snapshot);
 
     // Desenhemoa todos projeteis
-    DrawAllProjectils();
+    DrawAllProjectils(snapshot);
+
+    // Desenhamos a cena com o menor número de trocas de estado
+    FlushRenderQueue();
 
     // Imprimimos na tela informação sobre o número de quadros renderizados
     // por segundo (frames per second).
     TextRendering_ShowFramesPerSecond(window);
 
+    // E quantos objetos foram desenhados ou descartados pelo frustum culling
+    TextRendering_ShowRenderStats(window);
+
     // Renderiza o HUD (dinheiro e mensagens do console)
     int screenWidth, screenHeight;
     glfwGetWindowSize(window, &screenWidth, &screenHeight);
-    RenderHUD(window, screenWidth, screenHeight);
+    RenderHUD(window, snapshot.hud, screenWidth, screenHeight);
+
+    // Todo o texto do quadro é desenhado de uma só vez
+    TextRendering_Flush();
 }
 
 void DrawMapGrid()
-{    
-    for (int z = 0; z < MAP_HEIGHT; z++) {
-        for (int x = 0; x < MAP_WIDTH; x++) {
-            glm::vec3 worldPos = GridToWorld(x, z);
-            
-            // Matriz de transformação para cada célula
-            glm::mat4 model = Matrix_Translate(worldPos.x, 0.0f, worldPos.z)
-                            * Matrix_Scale(0.48f, 1.0f, 0.48f); // 0.48 para deixar espaço entre células
-            
-            glUniformMatrix4fv(g_model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-            
-            // Define a cor baseada no tipo de célula
-            CellType cellType = g_MapGrid[z][x];
-            
-            switch(cellType) {
-                case CELL_EMPTY:
-                    glUniform1i(g_object_id_uniform, CELL_EMPTY_PLANE);
-                    break;
-                case CELL_PATH:
-                    glUniform1i(g_object_id_uniform, CELL_PATH_PLANE);
-                    break;
-                case CELL_BLOCKED:
-                    glUniform1i(g_object_id_uniform, CELL_BLOCKED_PLANE);
-                    break;
-                case CELL_BASE:
-                    glUniform1i(g_object_id_uniform, CELL_BASE_PLANE);
-                    break;
-                case CELL_START:
-                    glUniform1i(g_object_id_uniform, CELL_START_PLANE);
-                    break;
-            }
-            
-            DrawVirtualObject("the_plane");
-        }
-    }
+{
+    // O grid não é mais desenhado célula a célula: a malha pré-processada
+    // agrupa as células por tipo, com poucas chamadas de desenho por bloco.
+    DrawMapMesh();
 }
 
 // set makeprg=cd\ ..\ &&\ make\ run\ >/dev/null
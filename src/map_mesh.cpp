@@ -0,0 +1,222 @@
+#include "map_mesh.h"
+#include "resource_loader.h"
+#include "game_attributes.h"
+#include "frustum.h"
+#include "render_queue.h"
+#include <glad/glad.h>
+#include <glm/vec3.hpp>
+#include <glm/mat4x4.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+
+// ============================================================================
+// DECLARAÇÕES EXTERNAS (definidas em main.cpp)
+// ============================================================================
+
+extern glm::vec3 GridToWorld(int gridX, int gridZ);
+
+// ============================================================================
+// CONSTANTES
+// ============================================================================
+
+// Metade do lado de uma célula desenhada. Menor que 0.5 para deixar espaço
+// entre as células.
+static constexpr float kCellHalfSize = 0.48f;
+
+// ============================================================================
+// ESTRUTURAS
+// ============================================================================
+
+struct MapChunk {
+    int firstX, firstZ;          // Primeira célula do bloco no grid
+    int sizeX, sizeZ;            // Número de células do bloco (menor na borda do mapa)
+    GLuint vertex_array_object_id;
+    GLuint vertex_buffer_id;
+    GLuint index_buffer_id;
+    size_t first_index[CELL_TYPE_COUNT]; // Faixa de índices de cada tipo de célula
+    size_t num_indices[CELL_TYPE_COUNT];
+    glm::vec3 bbox_min, bbox_max; // AABB do bloco, em coordenadas globais
+    bool dirty;                  // Precisa ser reconstruído antes do próximo desenho
+};
+
+// ============================================================================
+// ARMAZENAMENTO LOCAL
+// ============================================================================
+
+static std::vector<MapChunk> g_MapChunks;
+static int g_MapChunksX = 0;
+static int g_MapChunksZ = 0;
+
+// ============================================================================
+// IMPLEMENTAÇÃO
+// ============================================================================
+
+static int GetCellPlaneID(CellType type) {
+    switch (type) {
+        case CELL_EMPTY:   return CELL_EMPTY_PLANE;
+        case CELL_PATH:    return CELL_PATH_PLANE;
+        case CELL_BLOCKED: return CELL_BLOCKED_PLANE;
+        case CELL_BASE:    return CELL_BASE_PLANE;
+        case CELL_START:   return CELL_START_PLANE;
+        default:           return CELL_EMPTY_PLANE;
+    }
+}
+
+// Reconstrói os buffers de um bloco a partir do estado atual de g_MapGrid.
+// As células são agrupadas por tipo, para que cada tipo ocupe uma faixa
+// contígua do buffer de índices.
+static void BakeMapChunk(MapChunk& chunk) {
+    size_t numCells = (size_t)chunk.sizeX * chunk.sizeZ;
+
+    std::vector<PackedVertex> vertices;
+    std::vector<GLushort>  indices;
+    vertices.reserve(4 * numCells);
+    indices.reserve(6 * numCells);
+
+    // Mesmos cantos e coordenadas de textura de "plane.obj"
+    const float corners[4][2]   = { {-1.0f, 1.0f}, {1.0f, 1.0f}, {1.0f, -1.0f}, {-1.0f, -1.0f} };
+    const float texcoords[4][2] = { { 0.0f, 0.0f}, {1.0f, 0.0f}, {1.0f,  1.0f}, { 0.0f,  1.0f} };
+
+    // Todas as células apontam para cima
+    GLshort up[2];
+    EncodeOctahedralNormal(0.0f, 1.0f, 0.0f, up);
+
+    for (int type = 0; type < CELL_TYPE_COUNT; type++) {
+        chunk.first_index[type] = indices.size();
+
+        for (int z = chunk.firstZ; z < chunk.firstZ + chunk.sizeZ; z++) {
+            for (int x = chunk.firstX; x < chunk.firstX + chunk.sizeX; x++) {
+                if (g_MapGrid[z][x] != type)
+                    continue;
+
+                glm::vec3 worldPos = GridToWorld(x, z);
+                GLushort base = (GLushort)vertices.size();
+
+                for (int corner = 0; corner < 4; corner++) {
+                    PackedVertex v = {
+                        { worldPos.x + kCellHalfSize * corners[corner][0], 0.0f,
+                          worldPos.z + kCellHalfSize * corners[corner][1] },
+                        { up[0], up[1] },
+                        { texcoords[corner][0], texcoords[corner][1] }
+                    };
+                    vertices.push_back(v);
+                }
+
+                const GLushort quad[6] = { 0, 1, 2, 0, 2, 3 };
+                for (int i = 0; i < 6; i++)
+                    indices.push_back(base + quad[i]);
+            }
+        }
+
+        chunk.num_indices[type] = indices.size() - chunk.first_index[type];
+    }
+
+    glBindVertexArray(chunk.vertex_array_object_id);
+
+    glBindBuffer(GL_ARRAY_BUFFER, chunk.vertex_buffer_id);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(PackedVertex), vertices.data(), GL_STATIC_DRAW);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, chunk.index_buffer_id);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLushort), indices.data(), GL_STATIC_DRAW);
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    chunk.dirty = false;
+}
+
+void BuildMapMesh() {
+    // Libera os blocos de uma construção anterior, caso existam
+    for (MapChunk& chunk : g_MapChunks) {
+        glDeleteVertexArrays(1, &chunk.vertex_array_object_id);
+        glDeleteBuffers(1, &chunk.vertex_buffer_id);
+        glDeleteBuffers(1, &chunk.index_buffer_id);
+    }
+    g_MapChunks.clear();
+
+    g_MapChunksX = (MAP_WIDTH  + MAP_CHUNK_SIZE - 1) / MAP_CHUNK_SIZE;
+    g_MapChunksZ = (MAP_HEIGHT + MAP_CHUNK_SIZE - 1) / MAP_CHUNK_SIZE;
+
+    for (int cz = 0; cz < g_MapChunksZ; cz++) {
+        for (int cx = 0; cx < g_MapChunksX; cx++) {
+            MapChunk chunk;
+            chunk.firstX = cx * MAP_CHUNK_SIZE;
+            chunk.firstZ = cz * MAP_CHUNK_SIZE;
+            chunk.sizeX = std::min(MAP_CHUNK_SIZE, MAP_WIDTH  - chunk.firstX);
+            chunk.sizeZ = std::min(MAP_CHUNK_SIZE, MAP_HEIGHT - chunk.firstZ);
+
+            glm::vec3 first = GridToWorld(chunk.firstX, chunk.firstZ);
+            glm::vec3 last  = GridToWorld(chunk.firstX + chunk.sizeX - 1, chunk.firstZ + chunk.sizeZ - 1);
+            chunk.bbox_min = glm::vec3(std::min(first.x, last.x) - kCellHalfSize, 0.0f, std::min(first.z, last.z) - kCellHalfSize);
+            chunk.bbox_max = glm::vec3(std::max(first.x, last.x) + kCellHalfSize, 0.0f, std::max(first.z, last.z) + kCellHalfSize);
+
+            glGenVertexArrays(1, &chunk.vertex_array_object_id);
+            glGenBuffers(1, &chunk.vertex_buffer_id);
+            glGenBuffers(1, &chunk.index_buffer_id);
+
+            // O layout dos atributos fica gravado no VAO e não muda quando o
+            // bloco é reconstruído.
+            glBindVertexArray(chunk.vertex_array_object_id);
+            glBindBuffer(GL_ARRAY_BUFFER, chunk.vertex_buffer_id);
+            SetupPackedVertexAttributes();
+            glBindVertexArray(0);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+            BakeMapChunk(chunk);
+            g_MapChunks.push_back(chunk);
+        }
+    }
+
+    printf("[MAPA] Malha do mapa construida: %d bloco(s) de ate %dx%d celulas\n",
+           (int)g_MapChunks.size(), MAP_CHUNK_SIZE, MAP_CHUNK_SIZE);
+}
+
+void SetMapCell(int gridX, int gridZ, CellType type) {
+    if (gridX < 0 || gridX >= MAP_WIDTH || gridZ < 0 || gridZ >= MAP_HEIGHT)
+        return;
+
+    if (g_MapGrid[gridZ][gridX] == type)
+        return;
+
+    g_MapGrid[gridZ][gridX] = type;
+
+    int chunkIndex = (gridZ / MAP_CHUNK_SIZE) * g_MapChunksX + (gridX / MAP_CHUNK_SIZE);
+    if (chunkIndex < (int)g_MapChunks.size())
+        g_MapChunks[chunkIndex].dirty = true;
+}
+
+void DrawMapMesh() {
+    // Os vértices já estão em coordenadas globais
+    glm::mat4 identity = glm::mat4(1.0f);
+
+    // Blocos fora do frustum de visualização não são desenhados
+    static AABBBatch batch;
+    static std::vector<unsigned char> visible;
+    ClearAABBBatch(batch);
+    for (const MapChunk& chunk : g_MapChunks)
+        AddToAABBBatch(batch, chunk.bbox_min, chunk.bbox_max, identity);
+    CullAABBBatch(g_ViewFrustum, batch, visible);
+
+    for (size_t i = 0; i < g_MapChunks.size(); i++) {
+        if (visible[i] && g_MapChunks[i].dirty)
+            BakeMapChunk(g_MapChunks[i]);
+    }
+
+    // Um pacote por tipo de célula de cada bloco visível. A fila de
+    // renderização agrupa os pacotes por programa de GPU e por bloco.
+    for (size_t i = 0; i < g_MapChunks.size(); i++) {
+        const MapChunk& chunk = g_MapChunks[i];
+        if (!visible[i])
+            continue;
+
+        glm::vec3 center = 0.5f * (chunk.bbox_min + chunk.bbox_max);
+        for (int type = 0; type < CELL_TYPE_COUNT; type++) {
+            QueueElements(chunk.vertex_array_object_id, GL_TRIANGLES, GL_UNSIGNED_SHORT,
+                          chunk.first_index[type], (GLsizei)chunk.num_indices[type],
+                          GetCellPlaneID((CellType)type), identity, center);
+        }
+    }
+}
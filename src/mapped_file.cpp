@@ -0,0 +1,140 @@
+#include "mapped_file.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// ============================================================================
+// IMPLEMENTAÇÃO
+// ============================================================================
+
+static void ClearMappedFile(MappedFile* file)
+{
+    file->data = NULL;
+    file->size = 0;
+#ifdef _WIN32
+    file->file_handle = NULL;
+    file->mapping_handle = NULL;
+#endif
+}
+
+#ifdef _WIN32
+
+bool MapFile(const char* filename, MappedFile* file)
+{
+    ClearMappedFile(file);
+
+    HANDLE handle = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                                FILE_ATTRIBUTE_NORMAL, NULL);
+    if (handle == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(handle, &size) || size.QuadPart == 0)
+    {
+        CloseHandle(handle);
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingA(handle, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapping == NULL)
+    {
+        CloseHandle(handle);
+        return false;
+    }
+
+    void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (data == NULL)
+    {
+        CloseHandle(mapping);
+        CloseHandle(handle);
+        return false;
+    }
+
+    file->data = static_cast<const unsigned char*>(data);
+    file->size = (size_t)size.QuadPart;
+    file->file_handle = handle;
+    file->mapping_handle = mapping;
+    return true;
+}
+
+void UnmapFile(MappedFile* file)
+{
+    if (file->data == NULL)
+        return;
+
+    UnmapViewOfFile(file->data);
+    CloseHandle((HANDLE)file->mapping_handle);
+    CloseHandle((HANDLE)file->file_handle);
+    ClearMappedFile(file);
+}
+
+#else
+
+bool MapFile(const char* filename, MappedFile* file)
+{
+    ClearMappedFile(file);
+
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0)
+    {
+        close(fd);
+        return false;
+    }
+
+    void* data = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    // O mapeamento continua válido depois de fechar o descritor
+    close(fd);
+
+    if (data == MAP_FAILED)
+        return false;
+
+    file->data = static_cast<const unsigned char*>(data);
+    file->size = (size_t)info.st_size;
+    return true;
+}
+
+void UnmapFile(MappedFile* file)
+{
+    if (file->data == NULL)
+        return;
+
+    munmap(const_cast<unsigned char*>(file->data), file->size);
+    ClearMappedFile(file);
+}
+
+#endif
+
+uint64_t HashBytes(const unsigned char* data, size_t size)
+{
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash ^= data[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+bool HashFile(const char* filename, uint64_t* hash, uint64_t* size)
+{
+    MappedFile file;
+    if (!MapFile(filename, &file))
+        return false;
+
+    *hash = HashBytes(file.data, file.size);
+    *size = file.size;
+    UnmapFile(&file);
+    return true;
+}
@@ -0,0 +1,286 @@
+#include "materials.h"
+#include "resource_loader.h"
+#include "camera.h"
+#include "game_attributes.h"
+#include <cstdio>
+
+// ============================================================================
+// ESTRUTURAS
+// ============================================================================
+
+// Programa de GPU de uma classe de shader, com as posições de suas variáveis
+// uniformes
+struct MaterialProgram {
+    GLuint program_id;
+    GLint  model_uniform;
+    GLint  bbox_min_uniform;
+    GLint  bbox_max_uniform;
+    GLint  instanced_uniform;
+    GLint  kd_uniform;
+    GLint  ks_uniform;
+    GLint  ks_from_kd_uniform;
+    GLint  q_uniform;
+    GLint  texture_layer_uniform;
+    int    current_material; // Último material enviado a este programa (-1 = nenhum)
+    bool   ready;            // false enquanto o driver compila o programa
+    bool   failed;           // Compilação falhou: usa kFallbackShader para sempre
+};
+
+// ============================================================================
+// ARMAZENAMENTO LOCAL
+// ============================================================================
+
+// #defines de cada classe de shader, inseridos logo após a linha "#version"
+static const char* const kShaderDefines[SHADER_COUNT] = {
+    "",                                                      // SHADER_FLAT
+    "#define USE_DIFFUSE_TEXTURE\n",                         // SHADER_TEXTURED
+    "#define USE_DIFFUSE_TEXTURE\n#define USE_SPECULAR\n",   // SHADER_TEXTURED_SPECULAR
+    "#define USE_DIFFUSE_TEXTURE\n#define USE_GOURAUD\n",    // SHADER_GOURAUD_TEXTURED
+};
+
+// Nome do cache de binários de cada permutação (veja "program_cache.h")
+static const char* const kShaderCacheNames[SHADER_COUNT] = {
+    "material_flat",              // SHADER_FLAT
+    "material_textured",          // SHADER_TEXTURED
+    "material_textured_specular", // SHADER_TEXTURED_SPECULAR
+    "material_gouraud_textured",  // SHADER_GOURAUD_TEXTURED
+};
+
+static MaterialProgram g_MaterialPrograms[SHADER_COUNT];
+
+// Enquanto uma permutação é compilada, os seus objetos são desenhados com
+// SHADER_FLAT, que é compilada antes das demais e sem espera. A cor difusa
+// é a do material (se SHADER_FLAT) ou este cinza.
+static const MaterialShader kFallbackShader = SHADER_FLAT;
+static const glm::vec3 kFallbackKd(0.6f);
+
+// Valor de current_material quando o programa de reserva tem os parâmetros
+// de um material substituído
+static const int kFallbackMaterial = -2;
+static GLuint g_CurrentProgram = 0;
+
+static Material g_Materials[MAX_MATERIAL_ID];
+static bool g_MaterialsInitialized = false;
+
+// ============================================================================
+// TABELA DE MATERIAIS
+// ============================================================================
+
+static Material MakeFlat(glm::vec3 kd) {
+    Material m = { SHADER_FLAT, -1, kd, glm::vec3(0.0f), 0.0f, 1.0f };
+    return m;
+}
+
+static Material MakeTextured(GLint texture_layer) {
+    Material m = { SHADER_TEXTURED, texture_layer, glm::vec3(0.0f), glm::vec3(0.0f), 0.0f, 1.0f };
+    return m;
+}
+
+static Material MakeSpecular(GLint texture_layer, glm::vec3 ks, float ks_from_kd, float q) {
+    Material m = { SHADER_TEXTURED_SPECULAR, texture_layer, glm::vec3(0.0f), ks, ks_from_kd, q };
+    return m;
+}
+
+static Material MakeGouraud(GLint texture_layer) {
+    Material m = { SHADER_GOURAUD_TEXTURED, texture_layer, glm::vec3(0.0f), glm::vec3(0.0f), 0.0f, 1.0f };
+    return m;
+}
+
+// As camadas de textura seguem a ordem de LoadTextureImage() em main.cpp
+static void InitializeMaterialTable() {
+    // Objetos desconhecidos não refletem luz (preto)
+    for (int i = 0; i < MAX_MATERIAL_ID; i++)
+        g_Materials[i] = MakeFlat(glm::vec3(0.0f));
+
+    // Grid do mapa
+    g_Materials[CELL_EMPTY_PLANE]   = MakeTextured(0); // grass.jpg
+    g_Materials[CELL_PATH_PLANE]    = MakeTextured(1); // path.jpg
+    g_Materials[CELL_BLOCKED_PLANE] = MakeFlat(glm::vec3(0.3f, 0.3f, 0.3f)); // Cinza escuro
+    g_Materials[CELL_BASE_PLANE]    = MakeFlat(glm::vec3(0.2f, 0.4f, 0.9f)); // Azul
+    g_Materials[CELL_START_PLANE]   = MakeFlat(glm::vec3(1.0f, 0.0f, 0.0f)); // Vermelho
+
+    // Torres e armas (as armas têm brilho metálico)
+    g_Materials[MODEL_CHICKEN_TOWER] = MakeTextured(2);
+    g_Materials[MODEL_THOMPSON_GUN]  = MakeSpecular(3, glm::vec3(0.9f, 0.9f, 0.9f), 0.0f, 10.0f);
+    g_Materials[MODEL_BEAGLE_TOWER]  = MakeTextured(4);
+    g_Materials[MODEL_AK47]          = MakeSpecular(5, glm::vec3(0.9f, 0.9f, 0.9f), 0.0f, 10.0f);
+
+    // Inimigos
+    g_Materials[MODEL_HAWK] = MakeTextured(6);
+    g_Materials[MODEL_FOX]  = MakeTextured(7);
+    g_Materials[MODEL_WOLF] = MakeTextured(8);
+    g_Materials[MODEL_RAT]  = MakeTextured(9);
+
+    // Galinheiro com iluminação de Gouraud ("pixelado")
+    g_Materials[MODEL_CHICKEN_COOP] = MakeGouraud(10);
+
+    // Ovo: especular proporcional à cor da textura
+    g_Materials[MODEL_EGG] = MakeSpecular(11, glm::vec3(0.0f), 0.3f, 10.0f);
+
+    // Círculo de alcance da torre selecionada
+    g_Materials[TOWER_RANGE_CIRCLE] = MakeFlat(glm::vec3(1.0f, 1.0f, 0.0f)); // Amarelo
+
+    g_MaterialsInitialized = true;
+}
+
+// ============================================================================
+// IMPLEMENTAÇÃO
+// ============================================================================
+
+// Busca as posições das variáveis uniformes de um programa já pronto e
+// define os valores fixos
+static void SetupMaterialProgram(MaterialProgram& program) {
+    // Variáveis não usadas por uma permutação são removidas pelo
+    // compilador, e sua posição é -1 (ignorada por glUniform*())
+    GLuint id = program.program_id;
+    program.model_uniform           = glGetUniformLocation(id, "model");
+    program.bbox_min_uniform        = glGetUniformLocation(id, "bbox_min");
+    program.bbox_max_uniform        = glGetUniformLocation(id, "bbox_max");
+    program.instanced_uniform       = glGetUniformLocation(id, "instanced");
+    program.kd_uniform              = glGetUniformLocation(id, "material_kd");
+    program.ks_uniform              = glGetUniformLocation(id, "material_ks");
+    program.ks_from_kd_uniform      = glGetUniformLocation(id, "material_ks_from_kd");
+    program.q_uniform               = glGetUniformLocation(id, "material_q");
+    program.texture_layer_uniform   = glGetUniformLocation(id, "texture_layer");
+    program.current_material        = -1;
+    program.ready                   = true;
+
+    // As matrizes "view" e "projection" ficam no bloco "CameraBlock"
+    BindCameraUniformBlock(id);
+
+    glUseProgram(id);
+    glUniform1i(program.instanced_uniform, 0);
+    glUniform1i(glGetUniformLocation(id, "diffuse_textures"), DIFFUSE_TEXTURE_UNIT);
+}
+
+void LoadMaterialPrograms() {
+    if (!g_MaterialsInitialized)
+        InitializeMaterialTable();
+
+    // O programa de reserva (a primeira permutação) é criado e esperado; as
+    // demais compilações são enviadas ao driver de uma só vez e verificadas
+    // em BeginMaterialFrame(), sem bloquear
+    static_assert(kFallbackShader == 0, "o programa de reserva deve ser criado primeiro");
+    for (int shader = 0; shader < SHADER_COUNT; shader++) {
+        MaterialProgram& program = g_MaterialPrograms[shader];
+
+        std::string vertex_source = ReadShaderSource("src/shader_vertex.glsl", kShaderDefines[shader]);
+        std::string fragment_source = ReadShaderSource("src/shader_fragment.glsl", kShaderDefines[shader]);
+
+        // Deletamos o programa anterior, caso ele exista
+        if (program.program_id != 0)
+            DeleteGpuProgram(program.program_id);
+
+        program.ready = false;
+        program.failed = false;
+        if (shader == kFallbackShader) {
+            program.program_id = CreateGpuProgramFromSource(kShaderCacheNames[shader], vertex_source, fragment_source);
+            SetupMaterialProgram(program);
+        } else {
+            program.program_id = CreateGpuProgramAsync(kShaderCacheNames[shader], vertex_source, fragment_source);
+        }
+    }
+
+    int ready = 0;
+    for (int shader = 0; shader < SHADER_COUNT; shader++) {
+        MaterialProgram& program = g_MaterialPrograms[shader];
+        if (!program.ready && GetGpuProgramStatus(program.program_id) == GPU_PROGRAM_READY)
+            SetupMaterialProgram(program);
+        if (program.ready)
+            ready++;
+    }
+
+    glUseProgram(0);
+    g_CurrentProgram = 0;
+
+    printf("[MATERIAL] %d permutacoes de shader prontas, %d em compilacao\n", ready, (int)SHADER_COUNT - ready);
+}
+
+void BeginMaterialFrame() {
+    g_CurrentProgram = 0;
+
+    // Permutações cuja compilação terminou desde o último quadro (veja
+    // UpdatePendingGpuPrograms()). Se a compilação falhou, os objetos
+    // continuam com o programa de reserva.
+    bool changed = false;
+    for (int shader = 0; shader < SHADER_COUNT; shader++) {
+        MaterialProgram& program = g_MaterialPrograms[shader];
+        if (program.ready || program.failed)
+            continue;
+
+        GpuProgramStatus status = GetGpuProgramStatus(program.program_id);
+        if (status == GPU_PROGRAM_PENDING)
+            continue;
+        if (status == GPU_PROGRAM_FAILED) {
+            program.failed = true;
+            fprintf(stderr, "WARNING: Permutacao \"%s\" nao compilou; usando o programa de reserva.\n",
+                    kShaderCacheNames[shader]);
+            continue;
+        }
+
+        SetupMaterialProgram(program);
+        changed = true;
+        printf("[MATERIAL] Permutacao \"%s\" pronta\n", kShaderCacheNames[shader]);
+    }
+    if (changed)
+        glUseProgram(0);
+}
+
+const Material& GetMaterial(int object_id) {
+    if (!g_MaterialsInitialized)
+        InitializeMaterialTable();
+
+    if (object_id < 0 || object_id >= MAX_MATERIAL_ID)
+        return g_Materials[0];
+    return g_Materials[object_id];
+}
+
+bool MaterialsShareUniforms(int a, int b) {
+    if (a == b)
+        return true;
+
+    const Material& ma = GetMaterial(a);
+    const Material& mb = GetMaterial(b);
+    return ma.shader == mb.shader && ma.kd == mb.kd && ma.ks == mb.ks
+        && ma.ks_from_kd == mb.ks_from_kd && ma.q == mb.q;
+}
+
+void BindMaterial(int object_id) {
+    const Material& material = GetMaterial(object_id);
+
+    bool fallback = !g_MaterialPrograms[material.shader].ready;
+    MaterialProgram& program = g_MaterialPrograms[fallback ? kFallbackShader : material.shader];
+
+    if (g_CurrentProgram != program.program_id) {
+        glUseProgram(program.program_id);
+        g_CurrentProgram = program.program_id;
+
+        g_GpuProgramID       = program.program_id;
+        g_model_uniform      = program.model_uniform;
+        g_bbox_min_uniform   = program.bbox_min_uniform;
+        g_bbox_max_uniform   = program.bbox_max_uniform;
+        g_instanced_uniform  = program.instanced_uniform;
+    }
+
+    // Os valores de variáveis uniformes ficam guardados no programa, então
+    // só enviamos o material quando ele muda
+    if (fallback) {
+        // Somente a cor difusa é usada pelo programa de reserva; todos os
+        // materiais substituídos compartilham os mesmos valores
+        if (program.current_material != kFallbackMaterial) {
+            glUniform3f(program.kd_uniform, kFallbackKd.x, kFallbackKd.y, kFallbackKd.z);
+            glUniform3f(program.ks_uniform, 0.0f, 0.0f, 0.0f);
+            glUniform1f(program.ks_from_kd_uniform, 0.0f);
+            glUniform1f(program.q_uniform, 1.0f);
+            program.current_material = kFallbackMaterial;
+        }
+    } else if (program.current_material != object_id) {
+        glUniform3f(program.kd_uniform, material.kd.x, material.kd.y, material.kd.z);
+        glUniform3f(program.ks_uniform, material.ks.x, material.ks.y, material.ks.z);
+        glUniform1f(program.ks_from_kd_uniform, material.ks_from_kd);
+        glUniform1f(program.q_uniform, material.q);
+        if (material.texture_layer >= 0)
+            glUniform1f(program.texture_layer_uniform, (float)material.texture_layer);
+        program.current_material = object_id;
+    }
+}
@@ -0,0 +1,88 @@
+#include "memory_stats.h"
+#include <cstdio>
+#include <cstring>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define PSAPI_VERSION 2 // GetProcessMemoryInfo() em kernel32, sem -lpsapi
+#include <windows.h>
+#include <psapi.h>
+#elif defined(__APPLE__)
+#include <mach/mach.h>
+#include <sys/resource.h>
+#endif
+
+// ============================================================================
+// IMPLEMENTAÇÃO
+// ============================================================================
+
+#if defined(_WIN32)
+
+bool GetProcessMemoryUsage(ProcessMemoryUsage* usage)
+{
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return false;
+
+    usage->current_rss = counters.WorkingSetSize;
+    usage->peak_rss = counters.PeakWorkingSetSize;
+    return true;
+}
+
+#elif defined(__APPLE__)
+
+bool GetProcessMemoryUsage(ProcessMemoryUsage* usage)
+{
+    mach_task_basic_info_data_t info;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, (task_info_t)&info, &count) != KERN_SUCCESS)
+        return false;
+
+    struct rusage resources;
+    if (getrusage(RUSAGE_SELF, &resources) != 0)
+        return false;
+
+    usage->current_rss = (size_t)info.resident_size;
+    usage->peak_rss = (size_t)resources.ru_maxrss; // Em bytes no macOS
+    return true;
+}
+
+#else
+
+bool GetProcessMemoryUsage(ProcessMemoryUsage* usage)
+{
+    FILE* file = fopen("/proc/self/status", "r");
+    if (file == NULL)
+        return false;
+
+    // Linhas "VmRSS:   1234 kB" e "VmHWM:   1234 kB" (pico)
+    size_t current_kb = 0, peak_kb = 0;
+    char line[256];
+    while (fgets(line, sizeof(line), file) != NULL)
+    {
+        if (strncmp(line, "VmRSS:", 6) == 0)
+            sscanf(line + 6, "%zu", &current_kb);
+        else if (strncmp(line, "VmHWM:", 6) == 0)
+            sscanf(line + 6, "%zu", &peak_kb);
+    }
+    fclose(file);
+
+    if (current_kb == 0)
+        return false;
+
+    usage->current_rss = current_kb * 1024;
+    usage->peak_rss = peak_kb * 1024;
+    return true;
+}
+
+#endif
+
+void PrintProcessMemoryUsage(const char* label)
+{
+    ProcessMemoryUsage usage;
+    if (!GetProcessMemoryUsage(&usage))
+        return;
+
+    printf("[MEMORIA] %s: RSS %.1f MB (pico %.1f MB)\n", label,
+           usage.current_rss / (1024.0 * 1024.0), usage.peak_rss / (1024.0 * 1024.0));
+}
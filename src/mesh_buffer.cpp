@@ -0,0 +1,110 @@
+#include "mesh_buffer.h"
+#include <algorithm>
+#include <cstdio>
+
+// ============================================================================
+// ARMAZENAMENTO LOCAL
+// ============================================================================
+
+static GLuint g_SharedMeshVAO = 0;
+static GLuint g_SharedVertexBufferID = 0;
+static GLuint g_SharedIndexBufferID = 0;
+
+static size_t g_VertexCapacity = 0; // Em número de vértices
+static size_t g_IndexCapacity = 0;  // Em número de índices
+static size_t g_VertexCount = 0;
+static size_t g_IndexCount = 0;
+
+// Capacidades iniciais; cada ampliação dobra a capacidade
+static const size_t kInitialVertexCapacity = 64 * 1024;
+static const size_t kInitialIndexCapacity = 256 * 1024;
+
+// ============================================================================
+// IMPLEMENTAÇÃO
+// ============================================================================
+
+// Substitui "buffer_id" por um buffer maior com o mesmo conteúdo inicial
+static void GrowBuffer(GLuint& buffer_id, size_t used_bytes, size_t new_capacity_bytes) {
+    GLuint new_buffer_id;
+    glGenBuffers(1, &new_buffer_id);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, new_buffer_id);
+    glBufferData(GL_COPY_WRITE_BUFFER, new_capacity_bytes, NULL, GL_STATIC_DRAW);
+
+    if (buffer_id != 0) {
+        if (used_bytes > 0) {
+            glBindBuffer(GL_COPY_READ_BUFFER, buffer_id);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, used_bytes);
+            glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        }
+        glDeleteBuffers(1, &buffer_id);
+    }
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    buffer_id = new_buffer_id;
+}
+
+// Garante espaço para mais vértices e índices, ligando os novos buffers ao VAO
+static void ReserveSharedMeshBuffer(size_t num_vertices, size_t num_indices) {
+    bool rebind = false;
+
+    if (g_VertexCount + num_vertices > g_VertexCapacity) {
+        size_t capacity = std::max(g_VertexCapacity * 2, kInitialVertexCapacity);
+        capacity = std::max(capacity, g_VertexCount + num_vertices);
+        GrowBuffer(g_SharedVertexBufferID, g_VertexCount * sizeof(PackedVertex), capacity * sizeof(PackedVertex));
+        g_VertexCapacity = capacity;
+        rebind = true;
+    }
+
+    if (g_IndexCount + num_indices > g_IndexCapacity) {
+        size_t capacity = std::max(g_IndexCapacity * 2, kInitialIndexCapacity);
+        capacity = std::max(capacity, g_IndexCount + num_indices);
+        GrowBuffer(g_SharedIndexBufferID, g_IndexCount * sizeof(GLushort), capacity * sizeof(GLushort));
+        g_IndexCapacity = capacity;
+        rebind = true;
+    }
+
+    if (!rebind)
+        return;
+
+    if (g_SharedMeshVAO == 0)
+        glGenVertexArrays(1, &g_SharedMeshVAO);
+
+    // Os ponteiros de atributos e o buffer de índices são estado do VAO
+    glBindVertexArray(g_SharedMeshVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, g_SharedVertexBufferID);
+    SetupPackedVertexAttributes();
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, g_SharedIndexBufferID);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    printf("[MESHBUF] Buffer compartilhado: %d vertices, %d indices (%.1f KB)\n",
+           (int)g_VertexCapacity, (int)g_IndexCapacity,
+           (g_VertexCapacity * sizeof(PackedVertex) + g_IndexCapacity * sizeof(GLushort)) / 1024.0f);
+}
+
+GLuint GetSharedMeshVAO() {
+    return g_SharedMeshVAO;
+}
+
+void AppendToSharedMeshBuffer(const PackedVertex* vertices, size_t num_vertices,
+                              const GLushort* indices, size_t num_indices,
+                              GLint* base_vertex, size_t* first_index) {
+    ReserveSharedMeshBuffer(num_vertices, num_indices);
+
+    glBindBuffer(GL_ARRAY_BUFFER, g_SharedVertexBufferID);
+    glBufferSubData(GL_ARRAY_BUFFER, g_VertexCount * sizeof(PackedVertex),
+                    num_vertices * sizeof(PackedVertex), vertices);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    // GL_COPY_WRITE_BUFFER evita alterar o buffer de índices de algum VAO ligado
+    glBindBuffer(GL_COPY_WRITE_BUFFER, g_SharedIndexBufferID);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, g_IndexCount * sizeof(GLushort),
+                    num_indices * sizeof(GLushort), indices);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    *base_vertex = (GLint)g_VertexCount;
+    *first_index = g_IndexCount;
+
+    g_VertexCount += num_vertices;
+    g_IndexCount += num_indices;
+}
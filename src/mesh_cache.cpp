@@ -0,0 +1,328 @@
+#include "mesh_cache.h"
+#include "asset_archive.h"
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// ============================================================================
+// FORMATO DO ARQUIVO
+// ============================================================================
+//
+//   MeshCacheHeader
+//   MeshCacheObject[num_objects]
+//   nomes dos objetos (sem terminador), em sequência
+//   PackedVertex[num_vertices]          (em vertices_offset, alinhado a 4)
+//   índices de index_size bytes         (em indices_offset, alinhado a 4)
+//
+// Todos os valores estão na ordem de bytes da máquina que gravou o cache.
+
+static const char kMeshCacheMagic[8] = { 'O', 'V', 'O', 'M', 'E', 'S', 'H', '\0' };
+
+struct MeshCacheHeader
+{
+    char     magic[8];
+    uint32_t version;
+    uint32_t vertex_size;  // sizeof(PackedVertex)
+    uint64_t source_hash;
+    uint64_t source_size;
+    uint32_t num_objects;
+    uint32_t num_vertices;
+    uint32_t num_indices;
+    uint32_t index_size;   // 2 (buffer compartilhado) ou 4
+    uint64_t names_offset;
+    uint64_t vertices_offset;
+    uint64_t indices_offset;
+    uint64_t file_size;
+};
+
+struct MeshCacheLOD
+{
+    uint32_t first_index;
+    uint32_t num_indices;
+    float    error;
+};
+
+struct MeshCacheObject
+{
+    uint32_t     name_offset; // Relativo a names_offset
+    uint32_t     name_length;
+    uint32_t     first_index;
+    uint32_t     num_indices;
+    float        bbox_min[3];
+    float        bbox_max[3];
+    uint32_t     num_lods;
+    MeshCacheLOD lods[MAX_MESH_LODS];
+};
+
+// ============================================================================
+// IMPLEMENTAÇÃO
+// ============================================================================
+
+// Nome do recurso do cache (veja "asset_archive.h")
+static std::string MeshCacheName(const char* obj_filename)
+{
+    return std::string(obj_filename) + ".meshcache";
+}
+
+static uint64_t AlignTo4(uint64_t offset)
+{
+    return (offset + 3) & ~(uint64_t)3;
+}
+
+// Maior valor de um buffer de índices de "index_size" bytes
+static uint32_t MaxIndexValue(const unsigned char* indices, uint32_t num_indices, uint32_t index_size)
+{
+    uint32_t max_index = 0;
+    if (index_size == 2)
+    {
+        const uint16_t* values = reinterpret_cast<const uint16_t*>(indices);
+        for (uint32_t i = 0; i < num_indices; ++i)
+            max_index = values[i] > max_index ? values[i] : max_index;
+    }
+    else
+    {
+        const uint32_t* values = reinterpret_cast<const uint32_t*>(indices);
+        for (uint32_t i = 0; i < num_indices; ++i)
+            max_index = values[i] > max_index ? values[i] : max_index;
+    }
+    return max_index;
+}
+
+// Confere se o cabeçalho e as faixas de todos os objetos cabem no arquivo, e
+// se todos os índices apontam para vértices existentes: um cache corrompido
+// com o hash correto não pode fazer a GPU ler fora dos buffers
+static bool ValidateMeshCache(const AssetView& file, const MeshCacheKey& key)
+{
+    if (file.size < sizeof(MeshCacheHeader))
+        return false;
+
+    const MeshCacheHeader* header = reinterpret_cast<const MeshCacheHeader*>(file.data);
+    if (memcmp(header->magic, kMeshCacheMagic, sizeof(kMeshCacheMagic)) != 0
+        || header->version != MESH_CACHE_VERSION
+        || header->vertex_size != sizeof(PackedVertex)
+        || header->source_hash != key.source_hash
+        || header->source_size != key.source_size
+        || header->file_size != file.size)
+        return false;
+
+    if (header->index_size != 2 && header->index_size != 4)
+        return false;
+    if ((header->index_size == 2) != (MeshIndexType(header->num_vertices) == GL_UNSIGNED_SHORT))
+        return false;
+
+    uint64_t objects_end = sizeof(MeshCacheHeader) + (uint64_t)header->num_objects * sizeof(MeshCacheObject);
+    uint64_t vertices_end = header->vertices_offset + (uint64_t)header->num_vertices * sizeof(PackedVertex);
+    uint64_t indices_end = header->indices_offset + (uint64_t)header->num_indices * header->index_size;
+    if (header->names_offset < objects_end || header->vertices_offset < header->names_offset
+        || header->indices_offset < vertices_end || indices_end > file.size
+        || header->vertices_offset % 4 != 0 || header->indices_offset % 4 != 0)
+        return false;
+
+    const MeshCacheObject* objects = reinterpret_cast<const MeshCacheObject*>(file.data + sizeof(MeshCacheHeader));
+    uint64_t names_size = header->vertices_offset - header->names_offset;
+    for (uint32_t i = 0; i < header->num_objects; ++i)
+    {
+        const MeshCacheObject& object = objects[i];
+        if ((uint64_t)object.name_offset + object.name_length > names_size)
+            return false;
+        if ((uint64_t)object.first_index + object.num_indices > header->num_indices)
+            return false;
+        if (object.num_lods < 1 || object.num_lods > MAX_MESH_LODS)
+            return false;
+        for (uint32_t lod = 0; lod < object.num_lods; ++lod)
+            if ((uint64_t)object.lods[lod].first_index + object.lods[lod].num_indices > header->num_indices)
+                return false;
+    }
+
+    if (header->num_indices > 0
+        && MaxIndexValue(file.data + header->indices_offset, header->num_indices, header->index_size) >= header->num_vertices)
+        return false;
+
+    return true;
+}
+
+// ReadMeshCache() sem a mensagem de cache usado
+static bool OpenMeshCache(const char* obj_filename, MeshCacheKey* key, MeshCacheView* view)
+{
+    key->valid = false;
+    view->file.data = NULL; // Permite ReleaseMeshCache() mesmo em caso de falha
+    view->file.size = 0;
+    view->file.loose.data = NULL;
+    view->file.loose.size = 0;
+
+    if (!GetAssetHash(obj_filename, &key->source_hash, &key->source_size))
+        return false;
+    key->valid = true;
+
+    std::string cache_name = MeshCacheName(obj_filename);
+    AssetView& cache = view->file;
+    const MeshCacheKey& cache_key = *key;
+    bool stale = false;
+    if (!OpenCacheAsset(cache_name.c_str(),
+                        [&cache_key](const AssetView& file) { return ValidateMeshCache(file, cache_key); },
+                        &cache, &stale))
+    {
+        if (stale)
+            printf("[MESHCACHE] Cache desatualizado: %s\n", cache_name.c_str());
+        return false;
+    }
+
+    const MeshCacheHeader* header = reinterpret_cast<const MeshCacheHeader*>(cache.data);
+    const MeshCacheObject* records = reinterpret_cast<const MeshCacheObject*>(cache.data + sizeof(MeshCacheHeader));
+    const char* names = reinterpret_cast<const char*>(cache.data + header->names_offset);
+
+    std::vector<SceneObject>& objects = view->objects;
+    objects.resize(header->num_objects);
+    for (uint32_t i = 0; i < header->num_objects; ++i)
+    {
+        const MeshCacheObject& record = records[i];
+        SceneObject& object = objects[i];
+
+        object.name.assign(names + record.name_offset, record.name_length);
+        object.first_index    = record.first_index;
+        object.num_indices    = record.num_indices;
+        object.rendering_mode = GL_TRIANGLES;
+        object.index_type     = GL_UNSIGNED_INT; // Definidos por AddMeshToVirtualScene()
+        object.vertex_array_object_id = 0;
+        object.base_vertex    = 0;
+        object.bbox_min = glm::vec3(record.bbox_min[0], record.bbox_min[1], record.bbox_min[2]);
+        object.bbox_max = glm::vec3(record.bbox_max[0], record.bbox_max[1], record.bbox_max[2]);
+        object.num_lods = (int)record.num_lods;
+        for (uint32_t lod = 0; lod < record.num_lods; ++lod)
+        {
+            object.lods[lod].first_index = record.lods[lod].first_index;
+            object.lods[lod].num_indices = record.lods[lod].num_indices;
+            object.lods[lod].error       = record.lods[lod].error;
+        }
+    }
+
+    // Vértices e índices serão enviados diretamente do mapeamento para a GPU
+    view->vertices     = reinterpret_cast<const PackedVertex*>(cache.data + header->vertices_offset);
+    view->num_vertices = header->num_vertices;
+    view->indices      = cache.data + header->indices_offset;
+    view->num_indices  = header->num_indices;
+    view->index_type   = header->index_size == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    return true;
+}
+
+bool ReadMeshCache(const char* obj_filename, MeshCacheKey* key, MeshCacheView* view)
+{
+    if (!OpenMeshCache(obj_filename, key, view))
+        return false;
+
+    printf("[MESHCACHE] Cache usado: %s\n", MeshCacheName(obj_filename).c_str());
+    return true;
+}
+
+bool ReadMeshCacheObjects(const char* obj_filename, std::vector<SceneObject>* objects)
+{
+    MeshCacheKey key;
+    MeshCacheView view;
+    bool valid = OpenMeshCache(obj_filename, &key, &view);
+    if (valid)
+        objects->swap(view.objects);
+    ReleaseMeshCache(&view);
+    return valid;
+}
+
+void ReleaseMeshCache(MeshCacheView* view)
+{
+    ReleaseAsset(&view->file);
+    view->objects.clear();
+    view->vertices = NULL;
+    view->indices = NULL;
+}
+
+bool LoadMeshCache(const char* obj_filename, MeshCacheKey* key)
+{
+    MeshCacheView view;
+    if (!ReadMeshCache(obj_filename, key, &view))
+        return false;
+
+    AddMeshToVirtualScene(view.objects, view.vertices, view.num_vertices,
+                          view.indices, view.num_indices, view.index_type);
+    ReleaseMeshCache(&view);
+    return true;
+}
+
+void WriteMeshCache(const char* obj_filename, const MeshCacheKey& key, const MeshData& mesh)
+{
+    if (!key.valid)
+        return;
+
+    MeshCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, kMeshCacheMagic, sizeof(kMeshCacheMagic));
+    header.version      = MESH_CACHE_VERSION;
+    header.vertex_size  = sizeof(PackedVertex);
+    header.source_hash  = key.source_hash;
+    header.source_size  = key.source_size;
+    header.num_objects  = (uint32_t)mesh.objects.size();
+    header.num_vertices = (uint32_t)mesh.vertices.size();
+    header.num_indices  = (uint32_t)mesh.indices.size();
+    header.index_size   = MeshIndexType(mesh.vertices.size()) == GL_UNSIGNED_SHORT ? 2 : 4;
+
+    std::vector<MeshCacheObject> records(mesh.objects.size());
+    std::string names;
+    for (size_t i = 0; i < mesh.objects.size(); ++i)
+    {
+        const SceneObject& object = mesh.objects[i];
+        MeshCacheObject& record = records[i];
+        memset(&record, 0, sizeof(record));
+
+        record.name_offset = (uint32_t)names.size();
+        record.name_length = (uint32_t)object.name.size();
+        names += object.name;
+
+        record.first_index = (uint32_t)object.first_index;
+        record.num_indices = (uint32_t)object.num_indices;
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            record.bbox_min[axis] = object.bbox_min[axis];
+            record.bbox_max[axis] = object.bbox_max[axis];
+        }
+        record.num_lods = (uint32_t)object.num_lods;
+        for (int lod = 0; lod < object.num_lods; ++lod)
+        {
+            record.lods[lod].first_index = (uint32_t)object.lods[lod].first_index;
+            record.lods[lod].num_indices = (uint32_t)object.lods[lod].num_indices;
+            record.lods[lod].error       = object.lods[lod].error;
+        }
+    }
+
+    header.names_offset    = sizeof(MeshCacheHeader) + records.size() * sizeof(MeshCacheObject);
+    header.vertices_offset = AlignTo4(header.names_offset + names.size());
+    header.indices_offset  = AlignTo4(header.vertices_offset + mesh.vertices.size() * sizeof(PackedVertex));
+    header.file_size       = header.indices_offset + (uint64_t)mesh.indices.size() * header.index_size;
+
+    // Índices de 16 bits são convertidos antes da gravação
+    std::vector<uint16_t> short_indices;
+    FileChunk indices = { mesh.indices.data(), mesh.indices.size() * sizeof(GLuint) };
+    if (header.index_size == 2)
+    {
+        short_indices.assign(mesh.indices.begin(), mesh.indices.end());
+        indices.data = short_indices.data();
+        indices.size = short_indices.size() * sizeof(uint16_t);
+    }
+
+    static const unsigned char padding[4] = { 0, 0, 0, 0 };
+    std::vector<FileChunk> chunks;
+    chunks.push_back({ &header, sizeof(header) });
+    chunks.push_back({ records.data(), records.size() * sizeof(MeshCacheObject) });
+    chunks.push_back({ names.data(), names.size() });
+    chunks.push_back({ padding, (size_t)(header.vertices_offset - header.names_offset - names.size()) });
+    chunks.push_back({ mesh.vertices.data(), mesh.vertices.size() * sizeof(PackedVertex) });
+    chunks.push_back({ padding, (size_t)(header.indices_offset - header.vertices_offset
+                                         - mesh.vertices.size() * sizeof(PackedVertex)) });
+    chunks.push_back(indices);
+
+    std::string cache_path;
+    if (!WriteLooseAssetAtomically(MeshCacheName(obj_filename).c_str(), chunks, &cache_path))
+    {
+        fprintf(stderr, "WARNING: Nao foi possivel gravar o cache \"%s\".\n", cache_path.c_str());
+        return;
+    }
+
+    printf("[MESHCACHE] Cache gravado: %s (%.1f KB)\n", cache_path.c_str(), header.file_size / 1024.0f);
+}
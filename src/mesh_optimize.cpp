@@ -0,0 +1,279 @@
+#include "mesh_optimize.h"
+#include <glm/vec3.hpp>
+#include <glm/geometric.hpp>
+#include <algorithm>
+#include <cstring>
+
+// ============================================================================
+// ESTRUTURAS
+// ============================================================================
+
+// Cache FIFO de vértices transformados. Cada vértice guarda o "relógio" (o
+// número de vértices transformados até então) de quando entrou no cache; ele
+// ainda está no cache se menos de VERTEX_CACHE_SIZE vértices entraram depois.
+struct VertexCacheSimulator {
+    std::vector<long long> inserted;
+    long long clock;
+
+    explicit VertexCacheSimulator(size_t vertex_count)
+        : inserted(vertex_count, -(long long)VERTEX_CACHE_SIZE - 1), clock(0) {}
+
+    // Retorna true se o vértice precisou ser transformado
+    bool Access(GLuint v) {
+        if (clock - inserted[v] < VERTEX_CACHE_SIZE)
+            return false;
+        inserted[v] = clock++;
+        return true;
+    }
+
+    // Esvazia o cache
+    void Flush() {
+        clock += VERTEX_CACHE_SIZE;
+    }
+};
+
+// Trecho contíguo de triângulos e sua ordem de desenho (OptimizeOverdraw())
+struct OverdrawCluster {
+    size_t first_index;
+    size_t num_indices;
+    float  sort_key;
+};
+
+// ============================================================================
+// IMPLEMENTAÇÃO
+// ============================================================================
+
+float ComputeACMR(const GLuint* indices, size_t index_count, size_t vertex_count) {
+    size_t num_triangles = index_count / 3;
+    if (num_triangles == 0)
+        return 0.0f;
+
+    VertexCacheSimulator cache(vertex_count);
+    size_t misses = 0;
+    for (size_t i = 0; i < num_triangles * 3; ++i)
+        if (cache.Access(indices[i]))
+            ++misses;
+
+    return (float)misses / (float)num_triangles;
+}
+
+// Próximo vértice quando nenhum vizinho do leque atual serve: o vértice mais
+// recente da pilha de "becos sem saída" que ainda tem triângulos, ou então o
+// próximo na ordem dos vértices. Retorna -1 quando não sobra nenhum.
+static long long SkipDeadEnd(const std::vector<GLuint>& live, std::vector<GLuint>& dead_end,
+                             size_t& cursor, bool* cache_broken) {
+    while (!dead_end.empty()) {
+        GLuint v = dead_end.back();
+        dead_end.pop_back();
+        if (live[v] > 0)
+            return v;
+    }
+
+    *cache_broken = true;
+    while (cursor < live.size()) {
+        if (live[cursor] > 0)
+            return (long long)cursor;
+        ++cursor;
+    }
+    return -1;
+}
+
+void OptimizeVertexCache(GLuint* indices, size_t index_count, size_t vertex_count,
+                         std::vector<size_t>* clusters) {
+    size_t num_triangles = index_count / 3;
+    if (clusters)
+        clusters->assign(1, 0);
+    if (num_triangles == 0)
+        return;
+
+    // Triângulos de cada vértice (adjacência compacta) e quantos deles ainda
+    // não foram emitidos
+    std::vector<GLuint> live(vertex_count, 0);
+    for (size_t i = 0; i < num_triangles * 3; ++i)
+        ++live[indices[i]];
+
+    std::vector<size_t> adjacency_offset(vertex_count + 1, 0);
+    for (size_t v = 0; v < vertex_count; ++v)
+        adjacency_offset[v + 1] = adjacency_offset[v] + live[v];
+
+    std::vector<GLuint> adjacency(num_triangles * 3);
+    {
+        std::vector<size_t> fill(adjacency_offset.begin(), adjacency_offset.end() - 1);
+        for (size_t i = 0; i < num_triangles * 3; ++i)
+            adjacency[fill[indices[i]]++] = (GLuint)(i / 3);
+    }
+
+    std::vector<long long> cache_time(vertex_count, 0);
+    long long timestamp = VERTEX_CACHE_SIZE + 1;
+    std::vector<bool> emitted(num_triangles, false);
+    std::vector<GLuint> dead_end;
+    std::vector<GLuint> candidates;
+    std::vector<GLuint> output;
+    output.reserve(num_triangles * 3);
+    size_t cursor = 0;
+
+    long long fan = indices[0];
+    while (fan >= 0) {
+        // Emite todos os triângulos ainda pendentes ao redor de "fan"
+        candidates.clear();
+        for (size_t a = adjacency_offset[fan]; a < adjacency_offset[fan + 1]; ++a) {
+            GLuint triangle = adjacency[a];
+            if (emitted[triangle])
+                continue;
+
+            for (int k = 0; k < 3; ++k) {
+                GLuint v = indices[3 * triangle + k];
+                output.push_back(v);
+                dead_end.push_back(v);
+                candidates.push_back(v);
+                --live[v];
+                if (timestamp - cache_time[v] > VERTEX_CACHE_SIZE)
+                    cache_time[v] = timestamp++;
+            }
+            emitted[triangle] = true;
+        }
+
+        // O próximo leque é o vizinho que continuará no cache depois de
+        // emitir seus triângulos e que está nele há mais tempo
+        long long next = -1;
+        long long best_priority = -1;
+        for (size_t c = 0; c < candidates.size(); ++c) {
+            GLuint v = candidates[c];
+            if (live[v] == 0)
+                continue;
+
+            long long priority = 0;
+            if (timestamp - cache_time[v] + 2 * (long long)live[v] <= VERTEX_CACHE_SIZE)
+                priority = timestamp - cache_time[v];
+            if (priority > best_priority) {
+                best_priority = priority;
+                next = v;
+            }
+        }
+
+        if (next < 0) {
+            bool cache_broken = false;
+            next = SkipDeadEnd(live, dead_end, cursor, &cache_broken);
+            if (next >= 0 && cache_broken && clusters)
+                clusters->push_back(output.size());
+        }
+        fan = next;
+    }
+
+    memcpy(indices, output.data(), output.size() * sizeof(GLuint));
+}
+
+void OptimizeOverdraw(const std::vector<PackedVertex>& vertices, GLuint* indices, size_t index_count,
+                      const std::vector<size_t>& clusters, float threshold) {
+    size_t num_indices = index_count / 3 * 3;
+    if (num_indices == 0 || clusters.empty())
+        return;
+
+    // Corta cada trecho em grupos menores sempre que o ACMR acumulado desde o
+    // último corte (com o cache vazio no início do grupo, como ficará depois
+    // da reordenação) não passa de "threshold" vezes o ACMR do trecho. O
+    // último grupo de cada trecho pode passar do limite, então o fator é
+    // aproximado.
+    VertexCacheSimulator cache(vertices.size());
+    std::vector<OverdrawCluster> groups;
+
+    for (size_t c = 0; c < clusters.size(); ++c) {
+        size_t begin = clusters[c];
+        size_t end = (c + 1 < clusters.size()) ? clusters[c + 1] : num_indices;
+        float limit = ComputeACMR(indices + begin, end - begin, vertices.size()) * threshold;
+
+        size_t group_begin = begin;
+        size_t misses = 0;
+        cache.Flush();
+        for (size_t i = begin; i < end; i += 3) {
+            for (int k = 0; k < 3; ++k)
+                if (cache.Access(indices[i + k]))
+                    ++misses;
+
+            size_t group_triangles = (i + 3 - group_begin) / 3;
+            if (i + 3 == end || (float)misses <= limit * (float)group_triangles) {
+                OverdrawCluster group;
+                group.first_index = group_begin;
+                group.num_indices = i + 3 - group_begin;
+                group.sort_key    = 0.0f;
+                groups.push_back(group);
+
+                group_begin = i + 3;
+                misses = 0;
+                cache.Flush();
+            }
+        }
+    }
+
+    // Centroide e normal média (ponderados pela área) de cada grupo e da malha
+    std::vector<glm::vec3> group_centroids(groups.size());
+    std::vector<glm::vec3> group_normals(groups.size());
+    glm::vec3 mesh_centroid(0.0f);
+    float mesh_area = 0.0f;
+
+    for (size_t g = 0; g < groups.size(); ++g) {
+        glm::vec3 centroid(0.0f);
+        glm::vec3 normal(0.0f);
+        float area = 0.0f;
+
+        for (size_t i = groups[g].first_index; i < groups[g].first_index + groups[g].num_indices; i += 3) {
+            const PackedVertex& a = vertices[indices[i + 0]];
+            const PackedVertex& b = vertices[indices[i + 1]];
+            const PackedVertex& c = vertices[indices[i + 2]];
+            glm::vec3 pa(a.position[0], a.position[1], a.position[2]);
+            glm::vec3 pb(b.position[0], b.position[1], b.position[2]);
+            glm::vec3 pc(c.position[0], c.position[1], c.position[2]);
+
+            glm::vec3 cross = glm::cross(pb - pa, pc - pa);
+            float triangle_area = glm::length(cross);
+            centroid += (pa + pb + pc) * (triangle_area / 3.0f);
+            normal += cross;
+            area += triangle_area;
+        }
+
+        group_centroids[g] = area > 0.0f ? centroid / area : centroid;
+        group_normals[g] = glm::length(normal) > 0.0f ? glm::normalize(normal) : normal;
+        mesh_centroid += centroid;
+        mesh_area += area;
+    }
+    if (mesh_area > 0.0f)
+        mesh_centroid /= mesh_area;
+
+    // Grupos voltados para fora do centro da malha tendem a ficar na frente
+    // dos demais, então são desenhados primeiro
+    for (size_t g = 0; g < groups.size(); ++g)
+        groups[g].sort_key = glm::dot(group_centroids[g] - mesh_centroid, group_normals[g]);
+
+    std::stable_sort(groups.begin(), groups.end(),
+                     [](const OverdrawCluster& a, const OverdrawCluster& b) { return a.sort_key > b.sort_key; });
+
+    std::vector<GLuint> output;
+    output.reserve(num_indices);
+    for (size_t g = 0; g < groups.size(); ++g)
+        output.insert(output.end(), indices + groups[g].first_index,
+                      indices + groups[g].first_index + groups[g].num_indices);
+
+    memcpy(indices, output.data(), output.size() * sizeof(GLuint));
+}
+
+void OptimizeVertexFetch(std::vector<PackedVertex>& vertices, std::vector<GLuint>& indices) {
+    const GLuint unused = (GLuint)-1;
+    std::vector<GLuint> remap(vertices.size(), unused);
+    std::vector<PackedVertex> reordered;
+    reordered.reserve(vertices.size());
+
+    for (size_t i = 0; i < indices.size(); ++i) {
+        GLuint& v = indices[i];
+        if (remap[v] == unused) {
+            remap[v] = (GLuint)reordered.size();
+            reordered.push_back(vertices[v]);
+        }
+        v = remap[v];
+    }
+
+    for (size_t v = 0; v < vertices.size(); ++v)
+        if (remap[v] == unused)
+            reordered.push_back(vertices[v]);
+
+    vertices.swap(reordered);
+}
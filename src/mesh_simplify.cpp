@@ -0,0 +1,394 @@
+#include "mesh_simplify.h"
+#include <glm/vec3.hpp>
+#include <glm/geometric.hpp>
+#include <unordered_map>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+
+// ============================================================================
+// ESTRUTURAS
+// ============================================================================
+
+// Quádrica de erro: soma dos quadrados das distâncias de um ponto aos
+// planos dos triângulos acumulados, na forma p^T A p + 2 b^T p + c.
+struct Quadric {
+    double a00, a01, a02, a11, a12, a22;
+    double b0, b1, b2;
+    double c;
+};
+
+// Colapso candidato do vértice "from" sobre o vértice "to"
+struct Collapse {
+    GLuint from;
+    GLuint to;
+    double cost;
+};
+
+// ============================================================================
+// IMPLEMENTAÇÃO
+// ============================================================================
+
+static void QuadricClear(Quadric& q) {
+    memset(&q, 0, sizeof(q));
+}
+
+static void QuadricAdd(Quadric& q, const Quadric& r) {
+    q.a00 += r.a00; q.a01 += r.a01; q.a02 += r.a02;
+    q.a11 += r.a11; q.a12 += r.a12; q.a22 += r.a22;
+    q.b0 += r.b0; q.b1 += r.b1; q.b2 += r.b2;
+    q.c += r.c;
+}
+
+// Quádrica do plano n.p + d = 0 (n unitário)
+static Quadric QuadricFromPlane(const glm::vec3& n, float d) {
+    Quadric q;
+    q.a00 = n.x * n.x; q.a01 = n.x * n.y; q.a02 = n.x * n.z;
+    q.a11 = n.y * n.y; q.a12 = n.y * n.z; q.a22 = n.z * n.z;
+    q.b0 = n.x * d; q.b1 = n.y * d; q.b2 = n.z * d;
+    q.c = (double)d * d;
+    return q;
+}
+
+static double QuadricError(const Quadric& q, const glm::vec3& p) {
+    double x = p.x, y = p.y, z = p.z;
+    double e = q.a00 * x * x + 2.0 * q.a01 * x * y + 2.0 * q.a02 * x * z
+             + q.a11 * y * y + 2.0 * q.a12 * y * z + q.a22 * z * z
+             + 2.0 * (q.b0 * x + q.b1 * y + q.b2 * z) + q.c;
+    return e > 0.0 ? e : 0.0;
+}
+
+static glm::vec3 VertexPosition(const PackedVertex& v) {
+    return glm::vec3(v.position[0], v.position[1], v.position[2]);
+}
+
+static unsigned long long EdgeKey(GLuint a, GLuint b) {
+    if (a > b) std::swap(a, b);
+    return ((unsigned long long)a << 32) | b;
+}
+
+// Hash de uma posição (bit a bit), usado para detectar costuras
+struct PositionHash {
+    size_t operator()(const glm::vec3& p) const {
+        GLuint bits[3];
+        memcpy(bits, &p, sizeof(bits));
+        return (size_t)(bits[0] * 73856093u ^ bits[1] * 19349663u ^ bits[2] * 83492791u);
+    }
+};
+
+struct PositionEqual {
+    bool operator()(const glm::vec3& a, const glm::vec3& b) const {
+        return memcmp(&a, &b, sizeof(glm::vec3)) == 0;
+    }
+};
+
+// Chave de soldagem: posição e coordenada de textura. Cópias de um vértice
+// que diferem somente na normal (arestas vivas) são simplificadas como um
+// único vértice; veja RestoreNormals().
+struct WeldKey {
+    float values[5];
+};
+
+struct WeldKeyHash {
+    size_t operator()(const WeldKey& k) const {
+        GLuint bits[5];
+        memcpy(bits, k.values, sizeof(bits));
+        size_t hash = 2166136261u;
+        for (int i = 0; i < 5; i++)
+            hash = (hash ^ bits[i]) * 16777619u;
+        return hash;
+    }
+};
+
+struct WeldKeyEqual {
+    bool operator()(const WeldKey& a, const WeldKey& b) const {
+        return memcmp(a.values, b.values, sizeof(a.values)) == 0;
+    }
+};
+
+static glm::vec3 DecodeNormal(const PackedVertex& v) {
+    glm::vec3 n(v.normal[0] / 32767.0f, v.normal[1] / 32767.0f, 0.0f);
+    n.z = 1.0f - std::fabs(n.x) - std::fabs(n.y);
+    float t = std::max(-n.z, 0.0f);
+    n.x += (n.x >= 0.0f) ? -t : t;
+    n.y += (n.y >= 0.0f) ? -t : t;
+    return glm::normalize(n);
+}
+
+// Substitui cada índice pelo representante das cópias do vértice com mesma
+// posição e coordenada de textura. "next_copy" encadeia as cópias de cada
+// representante.
+static void WeldVertices(const std::vector<PackedVertex>& vertices,
+                         std::vector<GLuint>& indices,
+                         std::vector<GLuint>& next_copy) {
+    const GLuint none = ~0u;
+    std::vector<GLuint> weld(vertices.size(), none);
+    next_copy.assign(vertices.size(), none);
+
+    std::unordered_map<WeldKey, GLuint, WeldKeyHash, WeldKeyEqual> reps;
+    reps.reserve(indices.size());
+
+    for (size_t i = 0; i < indices.size(); i++) {
+        GLuint v = indices[i];
+        if (weld[v] == none) {
+            const PackedVertex& pv = vertices[v];
+            WeldKey key = { { pv.position[0], pv.position[1], pv.position[2], pv.texcoords[0], pv.texcoords[1] } };
+            std::pair<std::unordered_map<WeldKey, GLuint, WeldKeyHash, WeldKeyEqual>::iterator, bool> it
+                = reps.insert(std::make_pair(key, v));
+            GLuint rep = it.first->second;
+            weld[v] = rep;
+            if (rep != v) {
+                next_copy[v] = next_copy[rep];
+                next_copy[rep] = v;
+            }
+        }
+        indices[i] = weld[v];
+    }
+}
+
+// Para cada canto de triângulo, escolhe entre as cópias do representante a
+// que tem a normal mais próxima da normal do triângulo. Em modelos com
+// arestas vivas, isso preserva a aparência facetada da malha original.
+static void RestoreNormals(const std::vector<PackedVertex>& vertices,
+                           const std::vector<GLuint>& next_copy,
+                           std::vector<GLuint>& indices) {
+    const GLuint none = ~0u;
+    for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+        glm::vec3 p0 = VertexPosition(vertices[indices[t]]);
+        glm::vec3 p1 = VertexPosition(vertices[indices[t + 1]]);
+        glm::vec3 p2 = VertexPosition(vertices[indices[t + 2]]);
+        glm::vec3 face = glm::cross(p1 - p0, p2 - p0);
+
+        for (int i = 0; i < 3; i++) {
+            GLuint rep = indices[t + i];
+            if (next_copy[rep] == none)
+                continue;
+
+            GLuint best = rep;
+            float best_dot = glm::dot(DecodeNormal(vertices[rep]), face);
+            for (GLuint c = next_copy[rep]; c != none; c = next_copy[c]) {
+                float d = glm::dot(DecodeNormal(vertices[c]), face);
+                if (d > best_dot) {
+                    best_dot = d;
+                    best = c;
+                }
+            }
+            indices[t + i] = best;
+        }
+    }
+}
+
+// Marca os vértices que não podem ser movidos: os que compartilham a posição
+// com outro vértice soldado (costuras de textura) e os que estão em arestas
+// de borda ou não-manifold.
+static void ComputeLockedVertices(const std::vector<PackedVertex>& vertices,
+                                  const std::vector<GLuint>& indices,
+                                  std::vector<char>& locked) {
+    // Representante de cada posição distinta, e quantos vértices a usam
+    const GLuint unvisited = ~0u;
+    std::vector<GLuint> weld(vertices.size(), unvisited);
+    std::vector<int> copies(vertices.size(), 0);
+    std::unordered_map<glm::vec3, GLuint, PositionHash, PositionEqual> positions;
+    positions.reserve(indices.size());
+
+    for (size_t i = 0; i < indices.size(); i++) {
+        GLuint v = indices[i];
+        if (weld[v] != unvisited)
+            continue;
+        weld[v] = positions.insert(std::make_pair(VertexPosition(vertices[v]), v)).first->second;
+        copies[weld[v]]++;
+    }
+
+    for (size_t i = 0; i < indices.size(); i++) {
+        GLuint v = indices[i];
+        if (copies[weld[v]] > 1)
+            locked[v] = 1;
+    }
+
+    // Arestas (em posições soldadas) usadas por um número de triângulos
+    // diferente de dois
+    std::unordered_map<unsigned long long, int> edges;
+    edges.reserve(indices.size());
+    for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+        for (int e = 0; e < 3; e++) {
+            GLuint a = weld[indices[t + e]];
+            GLuint b = weld[indices[t + (e + 1) % 3]];
+            edges[EdgeKey(a, b)]++;
+        }
+    }
+    for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+        for (int e = 0; e < 3; e++) {
+            GLuint a = indices[t + e];
+            GLuint b = indices[t + (e + 1) % 3];
+            if (edges[EdgeKey(weld[a], weld[b])] != 2) {
+                locked[a] = 1;
+                locked[b] = 1;
+            }
+        }
+    }
+}
+
+// Verifica se mover "from" para a posição de "to" inverte ou degenera algum
+// dos triângulos adjacentes a "from" que não serão removidos.
+static bool CollapseFlipsTriangles(const std::vector<PackedVertex>& vertices,
+                                   const std::vector<GLuint>& indices,
+                                   const std::vector<GLuint>& adjacency,
+                                   size_t adj_begin, size_t adj_end,
+                                   GLuint from, GLuint to) {
+    glm::vec3 target = VertexPosition(vertices[to]);
+
+    for (size_t k = adj_begin; k < adj_end; k++) {
+        size_t t = adjacency[k];
+        GLuint tri[3] = { indices[t], indices[t + 1], indices[t + 2] };
+        if (tri[0] == to || tri[1] == to || tri[2] == to)
+            continue; // Triângulo removido pelo colapso
+
+        glm::vec3 p[3], q[3];
+        for (int i = 0; i < 3; i++) {
+            p[i] = VertexPosition(vertices[tri[i]]);
+            q[i] = (tri[i] == from) ? target : p[i];
+        }
+
+        glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+        glm::vec3 after  = glm::cross(q[1] - q[0], q[2] - q[0]);
+        float len_after = glm::length(after);
+        if (len_after <= 1e-12f || glm::dot(before, after) <= 0.25f * glm::length(before) * len_after)
+            return true;
+    }
+    return false;
+}
+
+float SimplifyMesh(const std::vector<PackedVertex>& vertices,
+                   const GLuint* indices, size_t index_count,
+                   size_t target_index_count, float max_error,
+                   std::vector<GLuint>& out_indices) {
+    out_indices.assign(indices, indices + index_count);
+
+    std::vector<GLuint> next_copy;
+    WeldVertices(vertices, out_indices, next_copy);
+
+    size_t vertex_count = vertices.size();
+    std::vector<char> locked(vertex_count, 0);
+    ComputeLockedVertices(vertices, out_indices, locked);
+
+    // Quádricas iniciais: planos de todos os triângulos adjacentes
+    std::vector<Quadric> quadrics(vertex_count);
+    for (size_t v = 0; v < vertex_count; v++)
+        QuadricClear(quadrics[v]);
+
+    for (size_t t = 0; t + 2 < out_indices.size(); t += 3) {
+        glm::vec3 p0 = VertexPosition(vertices[out_indices[t]]);
+        glm::vec3 p1 = VertexPosition(vertices[out_indices[t + 1]]);
+        glm::vec3 p2 = VertexPosition(vertices[out_indices[t + 2]]);
+        glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+        float len = glm::length(n);
+        if (len <= 0.0f)
+            continue;
+        n /= len;
+        Quadric q = QuadricFromPlane(n, -glm::dot(n, p0));
+        for (int i = 0; i < 3; i++)
+            QuadricAdd(quadrics[out_indices[t + i]], q);
+    }
+
+    double max_cost = (double)max_error * max_error;
+    double result_cost = 0.0;
+
+    std::vector<Collapse> candidates;
+    std::vector<GLuint> adj_offsets(vertex_count + 1);
+    std::vector<GLuint> adjacency;
+    std::vector<GLuint> collapse_target(vertex_count);
+    std::vector<char> touched(vertex_count);
+
+    // Cada passo aplica um conjunto de colapsos independentes, do mais
+    // barato para o mais caro, e então reconstrói os índices.
+    while (out_indices.size() > target_index_count) {
+        // Triângulos adjacentes a cada vértice
+        std::fill(adj_offsets.begin(), adj_offsets.end(), 0);
+        for (size_t i = 0; i < out_indices.size(); i++)
+            adj_offsets[out_indices[i] + 1]++;
+        for (size_t v = 0; v < vertex_count; v++)
+            adj_offsets[v + 1] += adj_offsets[v];
+        adjacency.resize(out_indices.size());
+        std::vector<GLuint> fill(adj_offsets.begin(), adj_offsets.end() - 1);
+        for (size_t i = 0; i < out_indices.size(); i++)
+            adjacency[fill[out_indices[i]]++] = (GLuint)(i - i % 3);
+
+        candidates.clear();
+        for (size_t t = 0; t + 2 < out_indices.size(); t += 3) {
+            for (int e = 0; e < 3; e++) {
+                GLuint a = out_indices[t + e];
+                GLuint b = out_indices[t + (e + 1) % 3];
+                for (int dir = 0; dir < 2; dir++) {
+                    GLuint from = dir ? b : a;
+                    GLuint to   = dir ? a : b;
+                    if (locked[from])
+                        continue;
+                    Quadric q = quadrics[from];
+                    QuadricAdd(q, quadrics[to]);
+                    Collapse c = { from, to, QuadricError(q, VertexPosition(vertices[to])) };
+                    if (c.cost <= max_cost)
+                        candidates.push_back(c);
+                }
+            }
+        }
+        if (candidates.empty())
+            break;
+
+        std::sort(candidates.begin(), candidates.end(),
+                  [](const Collapse& x, const Collapse& y) { return x.cost < y.cost; });
+
+        for (size_t v = 0; v < vertex_count; v++)
+            collapse_target[v] = (GLuint)v;
+        std::fill(touched.begin(), touched.end(), 0);
+
+        size_t triangles_to_remove = (out_indices.size() - target_index_count + 2) / 3;
+        size_t removed = 0;
+        size_t applied = 0;
+
+        for (size_t i = 0; i < candidates.size() && removed < triangles_to_remove; i++) {
+            const Collapse& c = candidates[i];
+            if (touched[c.from] || touched[c.to])
+                continue;
+
+            size_t begin = adj_offsets[c.from], end = adj_offsets[c.from + 1];
+            if (CollapseFlipsTriangles(vertices, out_indices, adjacency, begin, end, c.from, c.to))
+                continue;
+
+            // Vizinhos de "from" mudam de forma: não podem participar de
+            // outro colapso neste mesmo passo
+            for (size_t k = begin; k < end; k++) {
+                size_t t = adjacency[k];
+                touched[out_indices[t]] = 1;
+                touched[out_indices[t + 1]] = 1;
+                touched[out_indices[t + 2]] = 1;
+                if (out_indices[t] == c.to || out_indices[t + 1] == c.to || out_indices[t + 2] == c.to)
+                    removed++;
+            }
+
+            collapse_target[c.from] = c.to;
+            QuadricAdd(quadrics[c.to], quadrics[c.from]);
+            result_cost = std::max(result_cost, c.cost);
+            applied++;
+        }
+        if (applied == 0)
+            break;
+
+        // Reescreve os índices, descartando triângulos degenerados
+        size_t write = 0;
+        for (size_t t = 0; t + 2 < out_indices.size(); t += 3) {
+            GLuint a = collapse_target[out_indices[t]];
+            GLuint b = collapse_target[out_indices[t + 1]];
+            GLuint c = collapse_target[out_indices[t + 2]];
+            if (a == b || b == c || a == c)
+                continue;
+            out_indices[write++] = a;
+            out_indices[write++] = b;
+            out_indices[write++] = c;
+        }
+        out_indices.resize(write);
+    }
+
+    RestoreNormals(vertices, next_copy, out_indices);
+
+    return (float)std::sqrt(result_cost);
+}
@@ -0,0 +1,885 @@
+#include "obj_parser.h"
+#include "worker_pool.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <set>
+#include <utility>
+
+// ============================================================================
+// ESTRUTURAS LOCAIS
+// ============================================================================
+
+// Trechos menores que isso não compensam uma tarefa do pool
+static const size_t kMinChunkBytes = 256 * 1024;
+
+// Mudanças de estado entre faces
+enum ObjEventType {
+    OBJ_EVENT_SHAPE,     // "g" ou "o": começa um novo shape
+    OBJ_EVENT_MATERIAL,  // "usemtl"
+    OBJ_EVENT_SMOOTHING  // "s"
+};
+
+struct ObjEvent
+{
+    ObjEventType type;
+    size_t       face;      // Número de faces do trecho lidas antes do evento
+    std::string  name;      // Nome do shape ou do material
+    unsigned int smoothing;
+};
+
+// Um vértice de face: índices 0-based de posição, coordenada de textura e
+// normal (-1 se ausente)
+struct ObjCorner
+{
+    int v, vt, vn;
+};
+
+// Resultado da leitura de um trecho do arquivo
+struct ObjChunk
+{
+    const char* begin;
+    const char* end;
+    size_t      num_lines;
+
+    std::vector<float>       positions;
+    std::vector<float>       normals;
+    std::vector<float>       texcoords;
+    std::vector<ObjCorner>   corners;
+    std::vector<int>         face_sizes;  // Vértices de cada face, em "corners"
+    std::vector<ObjEvent>    events;
+
+    // Índices negativos são relativos ao fim da lista de atributos: são
+    // calculados em relação ao início do trecho e corrigidos na junção
+    std::vector<size_t>      relative_v, relative_vt, relative_vn;
+
+    // Arquivos de cada linha "mtllib" (tenta-se um por um, como a tinyobj)
+    std::vector<std::vector<std::string> > mtllibs;
+
+    bool        unsupported;
+    std::string error;
+    size_t      error_line; // Relativa ao trecho
+
+    // Triangulação (veja TriangulateChunk())
+    std::vector<tinyobj::index_t> triangles;
+    std::vector<size_t>           face_first_triangle; // num_faces + 1 entradas
+
+    ObjChunk() : begin(NULL), end(NULL), num_lines(0), unsupported(false), error_line(0) {}
+};
+
+// ============================================================================
+// LEITURA DE NÚMEROS
+// ============================================================================
+
+static inline bool IsSpace(char c) { return c == ' ' || c == '\t'; }
+static inline bool IsDigit(char c) { return c >= '0' && c <= '9'; }
+
+static const char* SkipSpaces(const char* p, const char* end)
+{
+    while (p < end && IsSpace(*p))
+        ++p;
+    return p;
+}
+
+// Fim da palavra iniciada em "p" (como strcspn(p, " \t\r") da tinyobj)
+static const char* TokenEnd(const char* p, const char* end)
+{
+    while (p < end && !IsSpace(*p) && *p != '\r')
+        ++p;
+    return p;
+}
+
+// Equivalente a atoi() limitado a [p, end); retorna onde parou
+static const char* ParseInt(const char* p, const char* end, int* value)
+{
+    bool negative = false;
+    if (p < end && (*p == '+' || *p == '-'))
+    {
+        negative = (*p == '-');
+        ++p;
+    }
+    int result = 0;
+    while (p < end && IsDigit(*p))
+    {
+        result = result * 10 + (*p - '0');
+        ++p;
+    }
+    *value = negative ? -result : result;
+    return p;
+}
+
+static const double kPowersOf10[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+// Lê um número real de [p, end), aceitando as mesmas formas que a tinyobj
+// ("5", "-.5", "1.5e-3"...). Os dígitos são acumulados em um inteiro de 64
+// bits: com até 19 dígitos significativos (sem contar zeros à direita) e
+// expoente decimal de até 22, uma única multiplicação ou divisão em double
+// dá o valor corretamente arredondado. Nos outros casos (raros em OBJs) os
+// dígitos além do 19º são descartados e o expoente é aplicado com pow(): o
+// erro fica muito abaixo da precisão de um float. Não usa strtod(), que
+// depende do locale. Retorna false, sem alterar "value", se não há número.
+static bool ParseFloat(const char* p, const char* end, float* value)
+{
+    bool negative = false;
+    if (p < end && (*p == '+' || *p == '-'))
+    {
+        negative = (*p == '-');
+        ++p;
+    }
+
+    uint64_t mantissa = 0;
+    int significant_digits = 0;
+    int exponent = 0;
+    bool any_digit = false;
+    bool truncated = false;
+
+    while (p < end && IsDigit(*p))
+    {
+        any_digit = true;
+        if (significant_digits < 19)
+        {
+            mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+            if (mantissa != 0)
+                ++significant_digits;
+        }
+        else
+        {
+            truncated |= (*p != '0');
+            ++exponent; // Dígito inteiro descartado
+        }
+        ++p;
+    }
+
+    if (p < end && *p == '.')
+    {
+        ++p;
+        while (p < end && IsDigit(*p))
+        {
+            any_digit = true;
+            if (significant_digits < 19)
+            {
+                mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+                if (mantissa != 0)
+                    ++significant_digits;
+                --exponent;
+            }
+            else
+            {
+                truncated |= (*p != '0');
+            }
+            ++p;
+        }
+    }
+
+    if (!any_digit)
+        return false;
+
+    if (p < end && (*p == 'e' || *p == 'E'))
+    {
+        ++p;
+        bool negative_exponent = false;
+        if (p < end && (*p == '+' || *p == '-'))
+        {
+            negative_exponent = (*p == '-');
+            ++p;
+        }
+        if (p >= end || !IsDigit(*p))
+            return false; // "1e" sem expoente é inválido também para a tinyobj
+
+        int e = 0;
+        while (p < end && IsDigit(*p))
+        {
+            if (e < 100000)
+                e = e * 10 + (*p - '0');
+            ++p;
+        }
+        exponent += negative_exponent ? -e : e;
+    }
+
+    // Zeros à direita ("1.500000") não precisam ocupar a mantissa
+    while (mantissa != 0 && mantissa % 10 == 0)
+    {
+        mantissa /= 10;
+        ++exponent;
+    }
+
+    double result;
+    if (!truncated && mantissa <= (1ull << 53) && exponent >= -22 && exponent <= 22)
+    {
+        result = (double)mantissa;
+        result = exponent < 0 ? result / kPowersOf10[-exponent] : result * kPowersOf10[exponent];
+    }
+    else
+    {
+        // Sem o teste, 0 * pow(10, 400) daria NaN
+        result = mantissa == 0 ? 0.0 : (double)mantissa * std::pow(10.0, (double)exponent);
+    }
+
+    *value = (float)(negative ? -result : result);
+    return true;
+}
+
+// Lê "count" números separados por espaços (0 para os que faltam)
+static void ParseFloats(const char* p, const char* end, int count, std::vector<float>& out)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        p = SkipSpaces(p, end);
+        const char* token_end = TokenEnd(p, end);
+        float value = 0.0f;
+        ParseFloat(p, token_end, &value);
+        out.push_back(value);
+        p = token_end;
+    }
+}
+
+// ============================================================================
+// LEITURA DE UM TRECHO
+// ============================================================================
+
+// Converte um índice do OBJ (a partir de 1, ou negativo = relativo ao último
+// atributo lido) em 0-based. "count" é o número de atributos lidos no trecho.
+// Retorna false para o índice 0, inválido.
+static bool FixIndex(int raw, size_t count, size_t position, std::vector<size_t>& relative, int* index)
+{
+    if (raw > 0)
+    {
+        *index = raw - 1;
+        return true;
+    }
+    if (raw == 0)
+    {
+        *index = -1;
+        return false;
+    }
+    *index = (int)count + raw; // Corrigido na junção (pode ser negativo aqui)
+    relative.push_back(position);
+    return true;
+}
+
+static bool ParseFace(ObjChunk& chunk, const char* p, const char* end)
+{
+    int num_corners = 0;
+    p = SkipSpaces(p, end);
+    while (p < end && *p != '\r')
+    {
+        const char* token_end = TokenEnd(p, end);
+        size_t position = chunk.corners.size();
+
+        ObjCorner corner;
+        corner.v = corner.vt = corner.vn = -1;
+
+        // "v", "v/vt", "v//vn" ou "v/vt/vn"
+        int raw;
+        const char* q = ParseInt(p, token_end, &raw);
+        if (!FixIndex(raw, chunk.positions.size() / 3, position, chunk.relative_v, &corner.v))
+        {
+            chunk.error = "Indice de vertice zero ou invalido";
+            return false;
+        }
+        while (q < token_end && *q != '/')
+            ++q;
+        if (q < token_end)
+        {
+            ++q;
+            if (q < token_end && *q == '/')
+            {
+                // "v//vn"
+                ParseInt(q + 1, token_end, &raw);
+                FixIndex(raw, chunk.normals.size() / 3, position, chunk.relative_vn, &corner.vn);
+            }
+            else
+            {
+                q = ParseInt(q, token_end, &raw);
+                FixIndex(raw, chunk.texcoords.size() / 2, position, chunk.relative_vt, &corner.vt);
+                while (q < token_end && *q != '/')
+                    ++q;
+                if (q < token_end)
+                {
+                    ParseInt(q + 1, token_end, &raw);
+                    FixIndex(raw, chunk.normals.size() / 3, position, chunk.relative_vn, &corner.vn);
+                }
+            }
+        }
+
+        chunk.corners.push_back(corner);
+        ++num_corners;
+        p = token_end;
+        while (p < end && (IsSpace(*p) || *p == '\r'))
+            ++p;
+    }
+
+    chunk.face_sizes.push_back(num_corners);
+    return true;
+}
+
+static void PushEvent(ObjChunk& chunk, ObjEventType type, const std::string& name, unsigned int smoothing)
+{
+    ObjEvent event;
+    event.type = type;
+    event.face = chunk.face_sizes.size();
+    event.name = name;
+    event.smoothing = smoothing;
+    chunk.events.push_back(event);
+}
+
+// Interpreta uma linha (sem o '\n' e o '\r' finais). Retorna false em caso
+// de erro ou de elemento não suportado.
+static bool ParseLine(ObjChunk& chunk, const char* p, const char* end)
+{
+    p = SkipSpaces(p, end);
+    if (p == end || *p == '#')
+        return true;
+
+    char c0 = p[0];
+    char c1 = (end - p > 1) ? p[1] : '\0';
+    char c2 = (end - p > 2) ? p[2] : '\0';
+
+    if (c0 == 'v' && IsSpace(c1))
+    {
+        ParseFloats(p + 2, end, 3, chunk.positions);
+        return true;
+    }
+    if (c0 == 'v' && c1 == 'n' && IsSpace(c2))
+    {
+        ParseFloats(p + 3, end, 3, chunk.normals);
+        return true;
+    }
+    if (c0 == 'v' && c1 == 't' && IsSpace(c2))
+    {
+        ParseFloats(p + 3, end, 2, chunk.texcoords);
+        return true;
+    }
+    if (c0 == 'f' && IsSpace(c1))
+        return ParseFace(chunk, p + 2, end);
+
+    if (end - p >= 6 && strncmp(p, "usemtl", 6) == 0)
+    {
+        const char* name = SkipSpaces(p + 6, end);
+        PushEvent(chunk, OBJ_EVENT_MATERIAL, std::string(name, TokenEnd(name, end)), 0);
+        return true;
+    }
+    if (end - p >= 7 && strncmp(p, "mtllib", 6) == 0 && IsSpace(p[6]))
+    {
+        std::vector<std::string> filenames;
+        for (const char* q = SkipSpaces(p + 7, end); q < end; q = SkipSpaces(q, end))
+        {
+            const char* token_end = TokenEnd(q, end);
+            if (token_end == q)
+                break;
+            filenames.push_back(std::string(q, token_end));
+            q = token_end;
+        }
+        chunk.mtllibs.push_back(filenames);
+        return true;
+    }
+    if (c0 == 'g' && IsSpace(c1))
+    {
+        // Vários nomes são juntados com espaços, como faz a tinyobj
+        std::string name;
+        for (const char* q = SkipSpaces(p + 2, end); q < end; q = SkipSpaces(q, end))
+        {
+            const char* token_end = TokenEnd(q, end);
+            if (token_end == q)
+                break;
+            if (!name.empty())
+                name += ' ';
+            name.append(q, token_end);
+            q = token_end;
+        }
+        PushEvent(chunk, OBJ_EVENT_SHAPE, name, 0);
+        return true;
+    }
+    if (c0 == 'o' && IsSpace(c1))
+    {
+        PushEvent(chunk, OBJ_EVENT_SHAPE, std::string(p + 2, end), 0);
+        return true;
+    }
+    if (c0 == 's' && IsSpace(c1))
+    {
+        const char* q = SkipSpaces(p + 2, end);
+        if (q == end)
+            return true;
+        unsigned int smoothing = 0;
+        if (!(end - q >= 3 && strncmp(q, "off", 3) == 0))
+        {
+            int id;
+            ParseInt(q, end, &id);
+            smoothing = id < 0 ? 0 : (unsigned int)id;
+        }
+        PushEvent(chunk, OBJ_EVENT_SMOOTHING, std::string(), smoothing);
+        return true;
+    }
+
+    if (((c0 == 'l' || c0 == 'p' || c0 == 't') && IsSpace(c1)) || (c0 == 'v' && c1 == 'w' && IsSpace(c2)))
+    {
+        chunk.unsupported = true;
+        return false;
+    }
+
+    // Comandos desconhecidos são ignorados
+    return true;
+}
+
+static void ParseChunk(ObjChunk* chunk)
+{
+    const char* p = chunk->begin;
+    while (p < chunk->end)
+    {
+        const char* line_end = static_cast<const char*>(memchr(p, '\n', chunk->end - p));
+        if (line_end == NULL)
+            line_end = chunk->end;
+        const char* next = (line_end < chunk->end) ? line_end + 1 : chunk->end;
+
+        ++chunk->num_lines;
+        if (line_end > p && line_end[-1] == '\r')
+            --line_end;
+
+        if (!ParseLine(*chunk, p, line_end))
+        {
+            chunk->error_line = chunk->num_lines;
+            return;
+        }
+        p = next;
+    }
+}
+
+// ============================================================================
+// TRIANGULAÇÃO (mesmas regras de exportGroupsToShape() da tinyobjloader)
+// ============================================================================
+
+static void PushTriangle(std::vector<tinyobj::index_t>& out, const ObjCorner& a, const ObjCorner& b, const ObjCorner& c)
+{
+    const ObjCorner* corners[3] = { &a, &b, &c };
+    for (int i = 0; i < 3; ++i)
+    {
+        tinyobj::index_t index;
+        index.vertex_index   = corners[i]->v;
+        index.normal_index   = corners[i]->vn;
+        index.texcoord_index = corners[i]->vt;
+        out.push_back(index);
+    }
+}
+
+// Teste de ponto dentro de polígono, https://wrf.ecse.rpi.edu//Research/Short_Notes/pnpoly.html
+static bool PointInPolygon(int num_vertices, const float* xs, const float* ys, float x, float y)
+{
+    bool inside = false;
+    for (int i = 0, j = num_vertices - 1; i < num_vertices; j = i++)
+    {
+        if (((ys[i] > y) != (ys[j] > y)) && (x < (xs[j] - xs[i]) * (y - ys[i]) / (ys[j] - ys[i]) + xs[i]))
+            inside = !inside;
+    }
+    return inside;
+}
+
+// Quads são divididos pela diagonal mais curta
+static void TriangulateQuad(const ObjCorner* face, const std::vector<float>& v, std::vector<tinyobj::index_t>& out)
+{
+    size_t vi[4];
+    for (int k = 0; k < 4; ++k)
+    {
+        vi[k] = (size_t)face[k].v;
+        if (3 * vi[k] + 2 >= v.size())
+            return; // Face inválida: ignorada, como na tinyobj
+    }
+
+    float e02x = v[3*vi[2] + 0] - v[3*vi[0] + 0];
+    float e02y = v[3*vi[2] + 1] - v[3*vi[0] + 1];
+    float e02z = v[3*vi[2] + 2] - v[3*vi[0] + 2];
+    float e13x = v[3*vi[3] + 0] - v[3*vi[1] + 0];
+    float e13y = v[3*vi[3] + 1] - v[3*vi[1] + 1];
+    float e13z = v[3*vi[3] + 2] - v[3*vi[1] + 2];
+    float sqr02 = e02x * e02x + e02y * e02y + e02z * e02z;
+    float sqr13 = e13x * e13x + e13y * e13y + e13z * e13z;
+
+    if (sqr02 < sqr13)
+    {
+        PushTriangle(out, face[0], face[1], face[2]);
+        PushTriangle(out, face[0], face[2], face[3]);
+    }
+    else
+    {
+        PushTriangle(out, face[0], face[1], face[3]);
+        PushTriangle(out, face[1], face[2], face[3]);
+    }
+}
+
+// Polígonos com mais de 4 vértices: remoção de orelhas no plano dos dois
+// eixos de maior extensão
+static void TriangulatePolygon(const ObjCorner* face, size_t num_corners, const std::vector<float>& v,
+                               std::vector<tinyobj::index_t>& out)
+{
+    // Escolhe os dois eixos de trabalho pelo primeiro canto não degenerado
+    size_t axes[2] = { 1, 2 };
+    for (size_t k = 0; k < num_corners; ++k)
+    {
+        size_t vi0 = (size_t)face[(k + 0) % num_corners].v;
+        size_t vi1 = (size_t)face[(k + 1) % num_corners].v;
+        size_t vi2 = (size_t)face[(k + 2) % num_corners].v;
+        if (3 * vi0 + 2 >= v.size() || 3 * vi1 + 2 >= v.size() || 3 * vi2 + 2 >= v.size())
+            continue;
+
+        float e0x = v[3*vi1 + 0] - v[3*vi0 + 0];
+        float e0y = v[3*vi1 + 1] - v[3*vi0 + 1];
+        float e0z = v[3*vi1 + 2] - v[3*vi0 + 2];
+        float e1x = v[3*vi2 + 0] - v[3*vi1 + 0];
+        float e1y = v[3*vi2 + 1] - v[3*vi1 + 1];
+        float e1z = v[3*vi2 + 2] - v[3*vi1 + 2];
+        float cx = std::fabs(e0y * e1z - e0z * e1y);
+        float cy = std::fabs(e0z * e1x - e0x * e1z);
+        float cz = std::fabs(e0x * e1y - e0y * e1x);
+        const float epsilon = std::numeric_limits<float>::epsilon();
+        if (cx > epsilon || cy > epsilon || cz > epsilon)
+        {
+            if (!(cx > cy && cx > cz))
+            {
+                axes[0] = 0;
+                if (cz > cx && cz > cy)
+                    axes[1] = 1;
+            }
+            break;
+        }
+    }
+
+    std::vector<ObjCorner> remaining(face, face + num_corners);
+    size_t guess_vert = 0;
+    size_t remaining_iterations = num_corners;
+    size_t previous_remaining = num_corners;
+
+    while (remaining.size() > 3 && remaining_iterations > 0)
+    {
+        size_t npolys = remaining.size();
+        if (guess_vert >= npolys)
+            guess_vert -= npolys;
+
+        if (previous_remaining != npolys)
+        {
+            previous_remaining = npolys;
+            remaining_iterations = npolys;
+        }
+        else
+        {
+            remaining_iterations--;
+        }
+
+        ObjCorner ind[3];
+        float vx[3], vy[3];
+        for (size_t k = 0; k < 3; ++k)
+        {
+            ind[k] = remaining[(guess_vert + k) % npolys];
+            size_t vi = (size_t)ind[k].v;
+            if (vi * 3 + axes[0] >= v.size() || vi * 3 + axes[1] >= v.size())
+            {
+                vx[k] = 0.0f;
+                vy[k] = 0.0f;
+            }
+            else
+            {
+                vx[k] = v[vi * 3 + axes[0]];
+                vy[k] = v[vi * 3 + axes[1]];
+            }
+        }
+
+        // Ângulo interno (côncavo): tenta o próximo vértice
+        float e0x = vx[1] - vx[0];
+        float e0y = vy[1] - vy[0];
+        float e1x = vx[2] - vx[1];
+        float e1y = vy[2] - vy[1];
+        float cross = e0x * e1y - e0y * e1x;
+        float area = (vx[0] * vy[1] - vy[0] * vx[1]) * 0.5f;
+        if (cross * area < 0.0f)
+        {
+            guess_vert += 1;
+            continue;
+        }
+
+        // Nenhum outro vértice pode estar dentro da orelha
+        bool overlap = false;
+        for (size_t other = 3; other < npolys; ++other)
+        {
+            size_t ovi = (size_t)remaining[(guess_vert + other) % npolys].v;
+            if (ovi * 3 + axes[0] >= v.size() || ovi * 3 + axes[1] >= v.size())
+                continue;
+            if (PointInPolygon(3, vx, vy, v[ovi * 3 + axes[0]], v[ovi * 3 + axes[1]]))
+            {
+                overlap = true;
+                break;
+            }
+        }
+        if (overlap)
+        {
+            guess_vert += 1;
+            continue;
+        }
+
+        PushTriangle(out, ind[0], ind[1], ind[2]);
+        remaining.erase(remaining.begin() + (guess_vert + 1) % npolys);
+    }
+
+    if (remaining.size() == 3)
+        PushTriangle(out, remaining[0], remaining[1], remaining[2]);
+}
+
+static void TriangulateChunk(ObjChunk* chunk, const std::vector<float>* positions)
+{
+    const std::vector<float>& v = *positions;
+    size_t num_faces = chunk->face_sizes.size();
+
+    chunk->triangles.reserve(chunk->corners.size() * 3 / 2);
+    chunk->face_first_triangle.resize(num_faces + 1);
+
+    size_t corner = 0;
+    for (size_t f = 0; f < num_faces; ++f)
+    {
+        chunk->face_first_triangle[f] = chunk->triangles.size() / 3;
+
+        size_t num_corners = (size_t)chunk->face_sizes[f];
+        const ObjCorner* face = chunk->corners.data() + corner;
+        corner += num_corners;
+
+        if (num_corners < 3)
+            continue; // Face degenerada
+        else if (num_corners == 3)
+            PushTriangle(chunk->triangles, face[0], face[1], face[2]);
+        else if (num_corners == 4)
+            TriangulateQuad(face, v, chunk->triangles);
+        else
+            TriangulatePolygon(face, num_corners, v, chunk->triangles);
+    }
+    chunk->face_first_triangle[num_faces] = chunk->triangles.size() / 3;
+
+    // Os cantos não são mais necessários
+    std::vector<ObjCorner>().swap(chunk->corners);
+}
+
+// ============================================================================
+// JUNÇÃO DOS TRECHOS
+// ============================================================================
+
+// Acrescenta ao shape as faces [first_face, end_face) de um trecho
+static void AppendFaces(tinyobj::shape_t& shape, const ObjChunk& chunk, size_t first_face, size_t end_face,
+                        int material, unsigned int smoothing)
+{
+    size_t first_triangle = chunk.face_first_triangle[first_face];
+    size_t end_triangle = chunk.face_first_triangle[end_face];
+    size_t num_triangles = end_triangle - first_triangle;
+    if (num_triangles == 0)
+        return;
+
+    tinyobj::mesh_t& mesh = shape.mesh;
+    mesh.indices.insert(mesh.indices.end(),
+                        chunk.triangles.begin() + 3 * first_triangle,
+                        chunk.triangles.begin() + 3 * end_triangle);
+    mesh.num_face_vertices.insert(mesh.num_face_vertices.end(), num_triangles, (unsigned char)3);
+    mesh.material_ids.insert(mesh.material_ids.end(), num_triangles, material);
+    mesh.smoothing_group_ids.insert(mesh.smoothing_group_ids.end(), num_triangles, smoothing);
+}
+
+// Carrega os arquivos MTL citados pelo OBJ, na ordem em que aparecem
+static void LoadMaterials(const std::vector<ObjChunk>& chunks, tinyobj::MaterialReader* reader,
+                          std::vector<tinyobj::material_t>* materials,
+                          std::map<std::string, int>* material_map, std::string* err)
+{
+    if (reader == NULL)
+        return;
+
+    std::set<std::string> loaded;
+
+    for (size_t c = 0; c < chunks.size(); ++c)
+    {
+        for (size_t line = 0; line < chunks[c].mtllibs.size(); ++line)
+        {
+            const std::vector<std::string>& filenames = chunks[c].mtllibs[line];
+            for (size_t i = 0; i < filenames.size(); ++i)
+            {
+                if (loaded.count(filenames[i]) > 0)
+                    break;
+
+                std::string warn_mtl, err_mtl;
+                bool ok = (*reader)(filenames[i], materials, material_map, &warn_mtl, &err_mtl);
+                if (err != NULL)
+                    *err += err_mtl;
+                if (ok)
+                {
+                    loaded.insert(filenames[i]);
+                    break;
+                }
+            }
+        }
+    }
+}
+
+// Soma "base" aos índices relativos de um trecho; retorna false se algum
+// continua negativo
+static bool FixRelativeIndices(ObjChunk& chunk, const std::vector<size_t>& positions, int ObjCorner::*member, int base)
+{
+    for (size_t i = 0; i < positions.size(); ++i)
+    {
+        int& index = chunk.corners[positions[i]].*member;
+        index += base;
+        if (index < 0)
+            return false;
+    }
+    return true;
+}
+
+ObjParseResult ParseObjData(const char* data, size_t size, tinyobj::MaterialReader* material_reader,
+                            tinyobj::attrib_t* attrib, std::vector<tinyobj::shape_t>* shapes,
+                            std::vector<tinyobj::material_t>* materials, std::string* err)
+{
+    // Divide o arquivo em trechos terminados em '\n', lidos por ParallelFor()
+    // nas threads de trabalho livres (veja "worker_pool.h")
+    const char* data_end = data + size;
+    size_t max_chunks = (size_t)GetWorkerCount() + 1;
+    size_t num_chunks = std::max((size_t)1, std::min(max_chunks, size / kMinChunkBytes));
+
+    std::vector<ObjChunk> chunks(num_chunks);
+    const char* chunk_begin = data;
+    for (size_t i = 0; i < num_chunks; ++i)
+    {
+        const char* chunk_end = data_end;
+        if (i + 1 < num_chunks)
+        {
+            chunk_end = std::max(chunk_begin, data + size * (i + 1) / num_chunks);
+            const char* newline = static_cast<const char*>(memchr(chunk_end, '\n', data_end - chunk_end));
+            chunk_end = newline ? newline + 1 : data_end;
+        }
+        chunks[i].begin = chunk_begin;
+        chunks[i].end = chunk_end;
+        chunk_begin = chunk_end;
+    }
+
+    ParallelFor((int)chunks.size(), [&chunks](int i) { ParseChunk(&chunks[i]); });
+
+    // O primeiro problema, na ordem do arquivo, decide o resultado
+    size_t line_base = 0;
+    for (size_t i = 0; i < chunks.size(); ++i)
+    {
+        if (chunks[i].unsupported)
+            return OBJ_PARSE_UNSUPPORTED;
+        if (!chunks[i].error.empty())
+        {
+            if (err != NULL)
+            {
+                char message[256];
+                snprintf(message, sizeof(message), "%s (linha %zu).\n",
+                         chunks[i].error.c_str(), line_base + chunks[i].error_line);
+                *err += message;
+            }
+            return OBJ_PARSE_FAILED;
+        }
+        line_base += chunks[i].num_lines;
+    }
+
+    std::map<std::string, int> material_map;
+    LoadMaterials(chunks, material_reader, materials, &material_map, err);
+
+    // Junta os atributos e corrige os índices relativos
+    size_t total_positions = 0, total_normals = 0, total_texcoords = 0;
+    for (size_t i = 0; i < chunks.size(); ++i)
+    {
+        total_positions += chunks[i].positions.size();
+        total_normals += chunks[i].normals.size();
+        total_texcoords += chunks[i].texcoords.size();
+    }
+
+    std::vector<float> positions, normals, texcoords;
+    positions.reserve(total_positions);
+    normals.reserve(total_normals);
+    texcoords.reserve(total_texcoords);
+
+    for (size_t i = 0; i < chunks.size(); ++i)
+    {
+        ObjChunk& chunk = chunks[i];
+        if (!FixRelativeIndices(chunk, chunk.relative_v, &ObjCorner::v, (int)(positions.size() / 3))
+            || !FixRelativeIndices(chunk, chunk.relative_vn, &ObjCorner::vn, (int)(normals.size() / 3))
+            || !FixRelativeIndices(chunk, chunk.relative_vt, &ObjCorner::vt, (int)(texcoords.size() / 2)))
+        {
+            if (err != NULL)
+                *err += "Indice relativo invalido.\n";
+            return OBJ_PARSE_FAILED;
+        }
+
+        positions.insert(positions.end(), chunk.positions.begin(), chunk.positions.end());
+        normals.insert(normals.end(), chunk.normals.begin(), chunk.normals.end());
+        texcoords.insert(texcoords.end(), chunk.texcoords.begin(), chunk.texcoords.end());
+        std::vector<float>().swap(chunk.positions);
+        std::vector<float>().swap(chunk.normals);
+        std::vector<float>().swap(chunk.texcoords);
+    }
+
+    // Triangulação em paralelo: precisa de todas as posições
+    ParallelFor((int)chunks.size(), [&chunks, &positions](int i) { TriangulateChunk(&chunks[i], &positions); });
+
+    // Monta os shapes percorrendo as faces e os eventos na ordem do arquivo.
+    // Como na tinyobj, um shape só é emitido se tiver triângulos, exceto o
+    // último, que também é emitido se houve faces (mesmo degeneradas) depois
+    // da última troca de material.
+    std::string name;
+    int material = -1;
+    unsigned int smoothing = 0;
+    bool pending_faces = false;
+    tinyobj::shape_t shape;
+
+    for (size_t i = 0; i < chunks.size(); ++i)
+    {
+        const ObjChunk& chunk = chunks[i];
+        size_t face = 0;
+        size_t num_faces = chunk.face_sizes.size();
+
+        for (size_t e = 0; e <= chunk.events.size(); ++e)
+        {
+            size_t event_face = (e < chunk.events.size()) ? chunk.events[e].face : num_faces;
+            if (event_face > face)
+            {
+                shape.name = name;
+                AppendFaces(shape, chunk, face, event_face, material, smoothing);
+                pending_faces = true;
+                face = event_face;
+            }
+            if (e == chunk.events.size())
+                break;
+
+            const ObjEvent& event = chunk.events[e];
+            if (event.type == OBJ_EVENT_SHAPE)
+            {
+                if (!shape.mesh.indices.empty())
+                    shapes->push_back(std::move(shape));
+                shape = tinyobj::shape_t();
+                pending_faces = false;
+                name = event.name;
+            }
+            else if (event.type == OBJ_EVENT_MATERIAL)
+            {
+                std::map<std::string, int>::const_iterator it = material_map.find(event.name);
+                int new_material = (it != material_map.end()) ? it->second : -1;
+                if (new_material != material)
+                {
+                    pending_faces = false;
+                    material = new_material;
+                }
+            }
+            else
+            {
+                smoothing = event.smoothing;
+            }
+        }
+    }
+
+    if (pending_faces || !shape.mesh.indices.empty())
+        shapes->push_back(std::move(shape));
+
+    attrib->vertices.swap(positions);
+    attrib->normals.swap(normals);
+    attrib->texcoords.swap(texcoords);
+    return OBJ_PARSE_OK;
+}
@@ -0,0 +1,238 @@
+#include "program_cache.h"
+#include "asset_archive.h"
+#include <GLFW/glfw3.h>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+// Funções e constantes de GL_ARB_get_program_binary (OpenGL 4.1), que não
+// fazem parte do carregador GLAD gerado para a OpenGL 3.3
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+
+typedef void (APIENTRYP ProgramBinaryGetProc)(GLuint program, GLsizei buf_size, GLsizei* length,
+                                              GLenum* binary_format, void* binary);
+typedef void (APIENTRYP ProgramBinaryLoadProc)(GLuint program, GLenum binary_format,
+                                               const void* binary, GLsizei length);
+typedef void (APIENTRYP ProgramParameteriProc)(GLuint program, GLenum pname, GLint value);
+
+// ============================================================================
+// FORMATO DO ARQUIVO
+// ============================================================================
+//
+//   ProgramCacheHeader
+//   binário do programa (binary_size bytes)
+//
+// Todos os valores estão na ordem de bytes da máquina que gravou o cache.
+
+static const char kProgramCacheMagic[8] = { 'O', 'V', 'O', 'P', 'R', 'O', 'G', '\0' };
+
+struct ProgramCacheHeader
+{
+    char     magic[8];
+    uint32_t version;
+    uint32_t binary_format; // Devolvido por glGetProgramBinary()
+    uint64_t key_hash;
+    uint64_t binary_size;
+    uint64_t file_size;
+};
+
+// ============================================================================
+// ARMAZENAMENTO LOCAL
+// ============================================================================
+
+static bool g_ProgramBinaryChecked = false;
+static ProgramBinaryGetProc  g_GetProgramBinary = NULL;
+static ProgramBinaryLoadProc g_ProgramBinary = NULL;
+static ProgramParameteriProc g_ProgramParameteri = NULL;
+
+// ============================================================================
+// IMPLEMENTAÇÃO
+// ============================================================================
+
+// Carrega as funções de binários de programas, se a OpenGL as oferece e
+// aceita ao menos um formato de binário
+static bool ProgramBinarySupported()
+{
+    if (!g_ProgramBinaryChecked)
+    {
+        g_ProgramBinaryChecked = true;
+
+#ifndef DISABLE_PROGRAM_CACHE
+        GLint major = 0;
+        GLint minor = 0;
+        glGetIntegerv(GL_MAJOR_VERSION, &major);
+        glGetIntegerv(GL_MINOR_VERSION, &minor);
+        bool core = major > 4 || (major == 4 && minor >= 1);
+
+        if (core || glfwExtensionSupported("GL_ARB_get_program_binary"))
+        {
+            g_GetProgramBinary  = (ProgramBinaryGetProc)glfwGetProcAddress("glGetProgramBinary");
+            g_ProgramBinary     = (ProgramBinaryLoadProc)glfwGetProcAddress("glProgramBinary");
+            g_ProgramParameteri = (ProgramParameteriProc)glfwGetProcAddress("glProgramParameteri");
+        }
+
+        GLint num_formats = 0;
+        if (g_GetProgramBinary != NULL && g_ProgramBinary != NULL && g_ProgramParameteri != NULL)
+            glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &num_formats);
+
+        if (num_formats <= 0)
+        {
+            g_GetProgramBinary = NULL;
+            g_ProgramBinary = NULL;
+            g_ProgramParameteri = NULL;
+        }
+#endif
+
+        printf("[PROGCACHE] Binarios de programas %s\n", g_ProgramBinary != NULL ? "disponiveis" : "indisponiveis");
+    }
+    return g_ProgramBinary != NULL;
+}
+
+// Nome do recurso do cache (veja "asset_archive.h")
+static std::string ProgramCacheName(const char* name)
+{
+    return std::string("data/") + name + ".programcache";
+}
+
+static void AppendGLString(std::string& text, GLenum name)
+{
+    const GLubyte* value = glGetString(name);
+    if (value != NULL)
+        text += reinterpret_cast<const char*>(value);
+    text += '\0';
+}
+
+static bool ValidateProgramCache(const AssetView& cache, const ProgramCacheKey& key)
+{
+    if (cache.size < sizeof(ProgramCacheHeader))
+        return false;
+
+    const ProgramCacheHeader* header = reinterpret_cast<const ProgramCacheHeader*>(cache.data);
+    return memcmp(header->magic, kProgramCacheMagic, sizeof(kProgramCacheMagic)) == 0
+        && header->version == PROGRAM_CACHE_VERSION
+        && header->key_hash == key.hash
+        && header->binary_size == cache.size - sizeof(ProgramCacheHeader)
+        && header->file_size == cache.size;
+}
+
+// Cria um programa a partir do binário do cache. Retorna 0 se o driver o
+// recusa.
+static GLuint CreateProgramFromCache(const AssetView& cache)
+{
+    const ProgramCacheHeader* header = reinterpret_cast<const ProgramCacheHeader*>(cache.data);
+
+    GLuint program_id = glCreateProgram();
+    PrepareProgramForCache(program_id);
+    g_ProgramBinary(program_id, (GLenum)header->binary_format, cache.data + sizeof(ProgramCacheHeader),
+                    (GLsizei)header->binary_size);
+
+    GLint linked_ok = GL_FALSE;
+    glGetProgramiv(program_id, GL_LINK_STATUS, &linked_ok);
+    if (linked_ok == GL_FALSE)
+    {
+        glDeleteProgram(program_id);
+        return 0;
+    }
+    return program_id;
+}
+
+GLuint LoadProgramCache(const char* name, const std::string& vertex_source,
+                        const std::string& fragment_source, ProgramCacheKey* key)
+{
+    key->valid = false;
+    if (!ProgramBinarySupported())
+        return 0;
+
+    // Os códigos-fonte e as strings do driver são separados por '\0', para
+    // que a divisão entre eles faça parte da chave
+    std::string identity;
+    identity.reserve(vertex_source.size() + fragment_source.size() + 256);
+    identity += vertex_source;
+    identity += '\0';
+    identity += fragment_source;
+    identity += '\0';
+    AppendGLString(identity, GL_VENDOR);
+    AppendGLString(identity, GL_RENDERER);
+    AppendGLString(identity, GL_VERSION);
+
+    key->hash = HashBytes(reinterpret_cast<const unsigned char*>(identity.data()), identity.size());
+    key->valid = true;
+
+    std::string cache_name = ProgramCacheName(name);
+    AssetView cache;
+    const ProgramCacheKey& cache_key = *key;
+    bool stale = false;
+    bool valid = OpenCacheAsset(cache_name.c_str(),
+                                [&cache_key](const AssetView& file) { return ValidateProgramCache(file, cache_key); },
+                                &cache, &stale);
+
+    // O driver também pode recusar um binário válido
+    GLuint program_id = valid ? CreateProgramFromCache(cache) : 0;
+    if (program_id == 0)
+    {
+        if (stale || valid)
+            printf("[PROGCACHE] Cache desatualizado: %s\n", cache_name.c_str());
+        ReleaseAsset(&cache);
+        return 0;
+    }
+
+    ReleaseAsset(&cache);
+    printf("[PROGCACHE] Cache usado: %s\n", cache_name.c_str());
+    return program_id;
+}
+
+void PrepareProgramForCache(GLuint program_id)
+{
+    if (ProgramBinarySupported())
+        g_ProgramParameteri(program_id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+}
+
+void WriteProgramCache(const char* name, const ProgramCacheKey& key, GLuint program_id)
+{
+    if (!key.valid || !ProgramBinarySupported())
+        return;
+
+    GLint linked_ok = GL_FALSE;
+    glGetProgramiv(program_id, GL_LINK_STATUS, &linked_ok);
+    GLint binary_length = 0;
+    glGetProgramiv(program_id, GL_PROGRAM_BINARY_LENGTH, &binary_length);
+    if (linked_ok == GL_FALSE || binary_length <= 0)
+        return;
+
+    std::vector<unsigned char> binary((size_t)binary_length);
+    GLsizei length = 0;
+    GLenum binary_format = 0;
+    g_GetProgramBinary(program_id, binary_length, &length, &binary_format, binary.data());
+    if (length <= 0)
+        return;
+
+    ProgramCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, kProgramCacheMagic, sizeof(kProgramCacheMagic));
+    header.version       = PROGRAM_CACHE_VERSION;
+    header.binary_format = (uint32_t)binary_format;
+    header.key_hash      = key.hash;
+    header.binary_size   = (uint64_t)length;
+    header.file_size     = sizeof(header) + (uint64_t)length;
+
+    std::vector<FileChunk> chunks;
+    chunks.push_back({ &header, sizeof(header) });
+    chunks.push_back({ binary.data(), (size_t)length });
+
+    std::string cache_path;
+    if (!WriteLooseAssetAtomically(ProgramCacheName(name).c_str(), chunks, &cache_path))
+    {
+        fprintf(stderr, "WARNING: Nao foi possivel gravar o cache \"%s\".\n", cache_path.c_str());
+        return;
+    }
+
+    printf("[PROGCACHE] Cache gravado: %s (%.1f KB)\n", cache_path.c_str(), header.file_size / 1024.0f);
+}
@@ -4,14 +4,14 @@
 #include "hud.h"
 #include "collisions.h"
 #include "enemy_system.h"
+#include "resource_loader.h"
+#include "materials.h"
+#include "render_queue.h"
 #include <glad/glad.h>
 #include <glm/gtc/type_ptr.hpp>
 #include <cmath>
 
 // Globais externas
-extern void DrawVirtualObject(const char* object_name);
-extern GLint g_model_uniform;
-extern GLint g_object_id_uniform;
 extern std::vector<Enemy> g_Enemies;
 
 // Lista de projéteis
@@ -49,18 +49,35 @@ void UpdateProjectiles(float deltaTime) {
     CheckProjectileCollisions();
 }
 
-void DrawAllProjectils() {
-    for (Projectile& p : g_Projectiles) {
-        if (!p.active)
-            continue;
+void CaptureProjectiles(RenderSnapshot& snapshot) {
+    snapshot.projectiles.clear();
+    for (const Projectile& p : g_Projectiles) {
+        if (p.active)
+            snapshot.projectiles.push_back(p.position);
+    }
+}
+
+void DrawAllProjectils(const RenderSnapshot& snapshot) {
+    // Todos os ovos compartilham o mesmo modelo, então são desenhados com uma
+    // única chamada instanciada.
+    static std::vector<InstanceData> instances;
+    instances.clear();
 
-        glm::mat4 model = Matrix_Translate(p.position.x, p.position.y, p.position.z)
-                        * Matrix_Scale(0.001f, 0.001f, 0.001f);
+    GLfloat eggLayer = (GLfloat)GetMaterial(MODEL_EGG).texture_layer;
 
-        glUniformMatrix4fv(g_model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-        glUniform1i(g_object_id_uniform, MODEL_EGG);
-        DrawVirtualObject("Uncracked_Egg");
+    for (const glm::vec3& position : snapshot.projectiles) {
+        InstanceData instance;
+        instance.model = Matrix_Translate(position.x, position.y, position.z)
+                       * Matrix_Scale(0.001f, 0.001f, 0.001f);
+        instance.texture_layer = eggLayer;
+
+        instances.push_back(instance);
     }
+
+    if (instances.empty())
+        return;
+
+    QueueVirtualObjectInstanced(g_Meshes.egg, MODEL_EGG, instances.data(), instances.size());
 }
 
 void CheckProjectileCollisions() {
@@ -0,0 +1,517 @@
+#include "render_queue.h"
+#include "materials.h"
+#include "frustum.h"
+#include "camera.h"
+#include "render_stats.h"
+#include <GLFW/glfw3.h>
+#include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+// ============================================================================
+// ESTRUTURAS
+// ============================================================================
+
+// Um desenho enfileirado. Pacotes instanciados leem "instance_count"
+// instâncias a partir de "first_instance" no buffer de instâncias. Os
+// demais usam a matriz "model", que também é copiada para o buffer de
+// instâncias em "first_instance" (usada pelo caminho de multi-draw).
+struct DrawPacket {
+    GLuint     vertex_array_object_id;
+    GLenum     rendering_mode;
+    GLenum     index_type;
+    size_t     first_index;
+    GLsizei    num_indices;
+    GLint      base_vertex;
+    int        material_id;
+    MeshHandle mesh;           // Objeto de g_VirtualScene (para "bbox_min/max"), ou INVALID_MESH_HANDLE
+    size_t     first_instance;
+    GLsizei    instance_count; // 0 = desenho não instanciado
+    glm::mat4  model;
+};
+
+// Comando lido por glMultiDrawElementsIndirect() (layout definido pela OpenGL)
+struct DrawElementsIndirectCommand {
+    GLuint count;
+    GLuint instance_count;
+    GLuint first_index;
+    GLint  base_vertex;
+    GLuint base_instance;
+};
+
+// Entrada ordenada pelo radix sort: a chave e o índice do pacote
+struct SortEntry {
+    uint64_t key;
+    uint32_t packet;
+};
+
+// ============================================================================
+// ARMAZENAMENTO LOCAL
+// ============================================================================
+
+static std::vector<DrawPacket>   g_Packets;
+static std::vector<SortEntry>    g_SortEntries;
+static std::vector<SortEntry>    g_SortScratch;
+static std::vector<InstanceData> g_QueuedInstances;
+
+// Buffer de instâncias compartilhado por todos os VAOs. As instâncias de um
+// quadro são acumuladas na CPU e enviadas com uma única chamada em
+// FlushRenderQueue().
+static GLuint g_InstanceBufferID = 0;
+static size_t g_InstanceBufferCapacity = 0; // Capacidade em número de instâncias
+
+// glMultiDrawElementsIndirect() faz parte da OpenGL 4.3, e não é carregada
+// pela GLAD (gerada para a versão 3.3). Sem ela, cada pacote é desenhado
+// com uma chamada própria. Compilar com -DDISABLE_MULTI_DRAW_INDIRECT força
+// o caminho antigo.
+typedef void (APIENTRYP PFNMULTIDRAWELEMENTSINDIRECTPROC)(GLenum mode, GLenum type, const void* indirect,
+                                                          GLsizei drawcount, GLsizei stride);
+static PFNMULTIDRAWELEMENTSINDIRECTPROC g_glMultiDrawElementsIndirect = NULL;
+static bool g_MultiDrawIndirectChecked = false;
+
+#ifndef GL_DRAW_INDIRECT_BUFFER
+#define GL_DRAW_INDIRECT_BUFFER 0x8F3F
+#endif
+
+static std::vector<DrawElementsIndirectCommand> g_IndirectCommands;
+static GLuint g_IndirectBufferID = 0;
+static size_t g_IndirectBufferCapacity = 0; // Capacidade em número de comandos
+
+// ============================================================================
+// CHAVE DE ORDENAÇÃO
+// ============================================================================
+
+static const int kShaderShift   = 60;
+static const int kVAOShift      = 44;
+static const int kMaterialShift = 36;
+static const int kDepthShift    = 12;
+
+// Profundidade (distância ao longo do eixo da câmera) quantizada em 24 bits.
+// Para floats positivos, a ordem dos bits coincide com a ordem dos valores,
+// então basta descartar os bits menos significativos da mantissa.
+static uint64_t DepthBits(const glm::mat4& model, const glm::vec3& center) {
+    glm::vec4 position_view = g_CameraUniforms.view * (model * glm::vec4(center, 1.0f));
+    float depth = std::max(0.0f, -position_view.z);
+
+    uint32_t bits;
+    std::memcpy(&bits, &depth, sizeof(bits));
+    return (uint64_t)(bits >> 7) & 0xFFFFFF;
+}
+
+static uint64_t MakeSortKey(int material_id, GLuint vertex_array_object_id, uint64_t depth_bits) {
+    uint64_t shader = (uint64_t)GetMaterial(material_id).shader & 0xF;
+    return (shader << kShaderShift)
+         | (((uint64_t)vertex_array_object_id & 0xFFFF) << kVAOShift)
+         | (((uint64_t)material_id & 0xFF) << kMaterialShift)
+         | (depth_bits << kDepthShift);
+}
+
+static void PushPacket(const DrawPacket& packet, uint64_t depth_bits) {
+    SortEntry entry;
+    entry.key = MakeSortKey(packet.material_id, packet.vertex_array_object_id, depth_bits);
+    entry.packet = (uint32_t)g_Packets.size();
+    g_SortEntries.push_back(entry);
+    g_Packets.push_back(packet);
+}
+
+// Radix sort LSD de 8 bits por passo. Passos em que todas as chaves têm o
+// mesmo byte são pulados (ex.: os bits reservados).
+static void RadixSort(std::vector<SortEntry>& entries, std::vector<SortEntry>& scratch) {
+    size_t count = entries.size();
+    scratch.resize(count);
+
+    for (int shift = 0; shift < 64; shift += 8) {
+        size_t histogram[256] = { 0 };
+        for (size_t i = 0; i < count; i++)
+            histogram[(entries[i].key >> shift) & 0xFF]++;
+
+        if (histogram[(entries[0].key >> shift) & 0xFF] == count)
+            continue;
+
+        size_t offset = 0;
+        for (int digit = 0; digit < 256; digit++) {
+            size_t digit_count = histogram[digit];
+            histogram[digit] = offset;
+            offset += digit_count;
+        }
+
+        for (size_t i = 0; i < count; i++)
+            scratch[histogram[(entries[i].key >> shift) & 0xFF]++] = entries[i];
+
+        entries.swap(scratch);
+    }
+}
+
+// ============================================================================
+// IMPLEMENTAÇÃO
+// ============================================================================
+
+static size_t IndexSize(GLenum index_type) {
+    return index_type == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+}
+
+// Verifica, uma única vez, se a OpenGL atual oferece glMultiDrawElementsIndirect()
+static void CheckMultiDrawIndirect() {
+    if (g_MultiDrawIndirectChecked)
+        return;
+    g_MultiDrawIndirectChecked = true;
+
+#ifndef DISABLE_MULTI_DRAW_INDIRECT
+    GLint major = 0, minor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+    glGetIntegerv(GL_MINOR_VERSION, &minor);
+    if (major > 4 || (major == 4 && minor >= 3))
+        g_glMultiDrawElementsIndirect = (PFNMULTIDRAWELEMENTSINDIRECTPROC)glfwGetProcAddress("glMultiDrawElementsIndirect");
+#endif
+
+    if (g_glMultiDrawElementsIndirect != NULL)
+        printf("[RENDER] Fila enviada com glMultiDrawElementsIndirect\n");
+    else
+        printf("[RENDER] glMultiDrawElementsIndirect indisponivel; uma chamada por pacote\n");
+}
+
+// Primeira referência a um modelo ou a uma textura carregados sob demanda:
+// pede a leitura, e até lá o desenho usa o placeholder (veja
+// "resource_loader.h")
+static void RequestDrawAssets(MeshHandle mesh, int material_id) {
+    RequestMesh(mesh);
+    RequestTextureLayer(GetMaterial(material_id).texture_layer);
+}
+
+// Copia a matriz "model" de um pacote não instanciado para o buffer de
+// instâncias, com a camada de textura do seu material
+static size_t PushSingleInstance(const glm::mat4& model, int material_id) {
+    InstanceData instance;
+    instance.model = model;
+    instance.texture_layer = (GLfloat)std::max(0, (int)GetMaterial(material_id).texture_layer);
+    g_QueuedInstances.push_back(instance);
+    return g_QueuedInstances.size() - 1;
+}
+
+void BeginRenderQueue() {
+    CheckMultiDrawIndirect();
+
+    g_Packets.clear();
+    g_SortEntries.clear();
+    g_QueuedInstances.clear();
+}
+
+void QueueVirtualObject(MeshHandle mesh, int lod, int material_id, const glm::mat4& model) {
+    // Objetos que não foram carregados são ignorados
+    if (mesh < 0 || mesh >= (MeshHandle)g_VirtualScene.size())
+        return;
+    RequestDrawAssets(mesh, material_id);
+
+    const SceneObject& object = g_VirtualScene[mesh];
+    const MeshLOD& range = object.lods[std::max(0, std::min(lod, object.num_lods - 1))];
+
+    DrawPacket packet;
+    packet.vertex_array_object_id = object.vertex_array_object_id;
+    packet.rendering_mode = object.rendering_mode;
+    packet.index_type = object.index_type;
+    packet.first_index = range.first_index;
+    packet.num_indices = (GLsizei)range.num_indices;
+    packet.base_vertex = object.base_vertex;
+    packet.material_id = material_id;
+    packet.mesh = mesh;
+    packet.first_instance = PushSingleInstance(model, material_id);
+    packet.instance_count = 0;
+    packet.model = model;
+
+    PushPacket(packet, DepthBits(model, 0.5f * (object.bbox_min + object.bbox_max)));
+}
+
+void QueueVirtualObjectInstanced(MeshHandle mesh, int material_id, const InstanceData* instances, size_t count) {
+    if (count == 0 || mesh < 0 || mesh >= (MeshHandle)g_VirtualScene.size())
+        return;
+    RequestDrawAssets(mesh, material_id);
+
+    const SceneObject& object = g_VirtualScene[mesh];
+    glm::vec3 center = 0.5f * (object.bbox_min + object.bbox_max);
+
+    // Descartamos as instâncias fora do frustum de visualização
+    static AABBBatch batch;
+    static std::vector<unsigned char> visible;
+    ClearAABBBatch(batch);
+    for (size_t i = 0; i < count; i++)
+        AddToAABBBatch(batch, object.bbox_min, object.bbox_max, instances[i].model);
+    if (CullAABBBatch(g_ViewFrustum, batch, visible) == 0)
+        return;
+
+    // LOD de cada instância visível (-1 = descartada)
+    static std::vector<int> lods;
+    lods.resize(count);
+    for (size_t i = 0; i < count; i++)
+        lods[i] = visible[i] ? SelectMeshLOD(mesh, instances[i].model) : -1;
+
+    // As instâncias de cada LOD ficam contíguas no buffer de instâncias, e
+    // são desenhadas por um único pacote. A profundidade do pacote é a da
+    // instância mais próxima.
+    for (int lod = 0; lod < object.num_lods; lod++) {
+        size_t first_instance = g_QueuedInstances.size();
+        uint64_t nearest = 0xFFFFFF;
+
+        for (size_t i = 0; i < count; i++) {
+            if (lods[i] != lod)
+                continue;
+            g_QueuedInstances.push_back(instances[i]);
+            nearest = std::min(nearest, DepthBits(instances[i].model, center));
+        }
+
+        size_t instance_count = g_QueuedInstances.size() - first_instance;
+        if (instance_count == 0)
+            continue;
+
+        DrawPacket packet;
+        packet.vertex_array_object_id = object.vertex_array_object_id;
+        packet.rendering_mode = object.rendering_mode;
+        packet.index_type = object.index_type;
+        packet.first_index = object.lods[lod].first_index;
+        packet.num_indices = (GLsizei)object.lods[lod].num_indices;
+        packet.base_vertex = object.base_vertex;
+        packet.material_id = material_id;
+        packet.mesh = mesh;
+        packet.first_instance = first_instance;
+        packet.instance_count = (GLsizei)instance_count;
+        packet.model = glm::mat4(1.0f);
+
+        PushPacket(packet, nearest);
+    }
+}
+
+void QueueElements(GLuint vertex_array_object_id, GLenum rendering_mode, GLenum index_type,
+                   size_t first_index, GLsizei num_indices, int material_id,
+                   const glm::mat4& model, const glm::vec3& center) {
+    if (num_indices == 0)
+        return;
+    RequestTextureLayer(GetMaterial(material_id).texture_layer);
+
+    DrawPacket packet;
+    packet.vertex_array_object_id = vertex_array_object_id;
+    packet.rendering_mode = rendering_mode;
+    packet.index_type = index_type;
+    packet.first_index = first_index;
+    packet.num_indices = num_indices;
+    packet.base_vertex = 0;
+    packet.material_id = material_id;
+    packet.mesh = INVALID_MESH_HANDLE;
+    packet.first_instance = PushSingleInstance(model, material_id);
+    packet.instance_count = 0;
+    packet.model = model;
+
+    PushPacket(packet, DepthBits(model, center));
+}
+
+// Envia as instâncias do quadro para a GPU com uma única chamada
+static void UploadQueuedInstances() {
+    if (g_QueuedInstances.empty())
+        return;
+
+    if (g_InstanceBufferID == 0)
+        glGenBuffers(1, &g_InstanceBufferID);
+
+    glBindBuffer(GL_ARRAY_BUFFER, g_InstanceBufferID);
+
+    // "Orphaning": pedimos um novo armazenamento, para que o driver não
+    // precise esperar a GPU terminar de ler o quadro anterior.
+    g_InstanceBufferCapacity = std::max(g_InstanceBufferCapacity, std::max(g_QueuedInstances.size(), (size_t)256));
+    glBufferData(GL_ARRAY_BUFFER, g_InstanceBufferCapacity * sizeof(InstanceData), NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, g_QueuedInstances.size() * sizeof(InstanceData), g_QueuedInstances.data());
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+// Aponta os atributos por instância (locations 3 a 7, veja
+// "shader_vertex.glsl") do VAO ligado para a primeira instância dada
+static void SetInstanceAttributes(size_t first_instance) {
+    size_t offset = first_instance * sizeof(InstanceData);
+
+    glBindBuffer(GL_ARRAY_BUFFER, g_InstanceBufferID);
+
+    // Uma mat4 ocupa quatro locations consecutivas, uma por coluna.
+    for (GLuint column = 0; column < 4; column++) {
+        GLuint location = 3 + column;
+        glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+                              (void*)(offset + offsetof(InstanceData, model) + column * sizeof(glm::vec4)));
+        glVertexAttribDivisor(location, 1);
+        glEnableVertexAttribArray(location);
+    }
+
+    glVertexAttribPointer(7, 1, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+                          (void*)(offset + offsetof(InstanceData, texture_layer)));
+    glVertexAttribDivisor(7, 1);
+    glEnableVertexAttribArray(7);
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+// Desabilita os atributos por instância do VAO ligado, para que desenhos
+// comuns deste mesmo VAO não leiam o buffer de instâncias
+static void DisableInstanceAttributes() {
+    for (GLuint location = 3; location <= 7; location++)
+        glDisableVertexAttribArray(location);
+}
+
+// Dois pacotes podem ser desenhados pela mesma chamada de multi-draw se
+// usam o mesmo VAO, o mesmo tipo de índice e materiais com as mesmas
+// variáveis uniformes (a camada de textura vai em cada instância)
+static bool CanShareMultiDraw(const DrawPacket& a, const DrawPacket& b) {
+    return a.vertex_array_object_id == b.vertex_array_object_id
+        && a.rendering_mode == b.rendering_mode
+        && a.index_type == b.index_type
+        && MaterialsShareUniforms(a.material_id, b.material_id);
+}
+
+// Envia os pacotes ordenados em grupos: cada grupo de pacotes compatíveis
+// vira uma única chamada glMultiDrawElementsIndirect(). Todo desenho é
+// instanciado; "base_instance" indica onde estão a matriz "model" e a
+// camada de textura de cada pacote no buffer de instâncias.
+static void SubmitMultiDrawIndirect() {
+    g_IndirectCommands.resize(g_SortEntries.size());
+    for (size_t i = 0; i < g_SortEntries.size(); i++) {
+        const DrawPacket& packet = g_Packets[g_SortEntries[i].packet];
+        DrawElementsIndirectCommand& command = g_IndirectCommands[i];
+        command.count = (GLuint)packet.num_indices;
+        command.instance_count = (GLuint)std::max(1, (int)packet.instance_count);
+        command.first_index = (GLuint)packet.first_index;
+        command.base_vertex = packet.base_vertex;
+        command.base_instance = (GLuint)packet.first_instance;
+    }
+
+    if (g_IndirectBufferID == 0)
+        glGenBuffers(1, &g_IndirectBufferID);
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, g_IndirectBufferID);
+    g_IndirectBufferCapacity = std::max(g_IndirectBufferCapacity, std::max(g_IndirectCommands.size(), (size_t)256));
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, g_IndirectBufferCapacity * sizeof(DrawElementsIndirectCommand), NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, g_IndirectCommands.size() * sizeof(DrawElementsIndirectCommand),
+                    g_IndirectCommands.data());
+
+    GLuint current_program = 0;
+    GLuint current_vao = 0;
+
+    size_t first = 0;
+    while (first < g_SortEntries.size()) {
+        const DrawPacket& packet = g_Packets[g_SortEntries[first].packet];
+
+        size_t last = first + 1;
+        while (last < g_SortEntries.size() && CanShareMultiDraw(packet, g_Packets[g_SortEntries[last].packet]))
+            last++;
+
+        BindMaterial(packet.material_id);
+        if (g_GpuProgramID != current_program) {
+            current_program = g_GpuProgramID;
+            glUniform1i(g_instanced_uniform, 1);
+            g_RenderStats.state_changes++;
+        }
+
+        // Os atributos por instância começam no início do buffer; a OpenGL
+        // soma "base_instance" ao buscá-los
+        if (packet.vertex_array_object_id != current_vao) {
+            glBindVertexArray(packet.vertex_array_object_id);
+            SetInstanceAttributes(0);
+            current_vao = packet.vertex_array_object_id;
+            g_RenderStats.state_changes++;
+        }
+
+        g_glMultiDrawElementsIndirect(packet.rendering_mode, packet.index_type,
+                                      (void*)(first * sizeof(DrawElementsIndirectCommand)),
+                                      (GLsizei)(last - first), 0);
+        g_RenderStats.draw_calls++;
+
+        first = last;
+    }
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    glBindVertexArray(0);
+}
+
+void FlushRenderQueue() {
+    if (g_Packets.empty())
+        return;
+
+    UploadQueuedInstances();
+    RadixSort(g_SortEntries, g_SortScratch);
+
+    if (g_glMultiDrawElementsIndirect != NULL) {
+        SubmitMultiDrawIndirect();
+        return;
+    }
+
+    // Estado atual da OpenGL. Os valores das variáveis uniformes pertencem ao
+    // programa, então são esquecidos quando o programa muda.
+    GLuint      current_program = 0;
+    GLuint      current_vao = 0;
+    bool        instance_attributes_enabled = false;
+    int         current_instanced = -1;
+    MeshHandle  current_bbox_mesh = INVALID_MESH_HANDLE;
+    bool        has_model = false;
+    glm::mat4   current_model;
+
+    for (size_t i = 0; i < g_SortEntries.size(); i++) {
+        const DrawPacket& packet = g_Packets[g_SortEntries[i].packet];
+        bool instanced = packet.instance_count > 0;
+
+        BindMaterial(packet.material_id);
+        if (g_GpuProgramID != current_program) {
+            current_program = g_GpuProgramID;
+            current_instanced = -1;
+            current_bbox_mesh = INVALID_MESH_HANDLE;
+            has_model = false;
+            g_RenderStats.state_changes++;
+        }
+
+        if (packet.vertex_array_object_id != current_vao) {
+            if (instance_attributes_enabled)
+                DisableInstanceAttributes();
+            instance_attributes_enabled = false;
+
+            glBindVertexArray(packet.vertex_array_object_id);
+            current_vao = packet.vertex_array_object_id;
+            g_RenderStats.state_changes++;
+        }
+
+        if (instanced) {
+            SetInstanceAttributes(packet.first_instance);
+            instance_attributes_enabled = true;
+        } else if (instance_attributes_enabled) {
+            DisableInstanceAttributes();
+            instance_attributes_enabled = false;
+        }
+
+        if (current_instanced != (int)instanced) {
+            glUniform1i(g_instanced_uniform, instanced ? 1 : 0);
+            current_instanced = (int)instanced;
+        }
+
+        if (!instanced && (!has_model || std::memcmp(&current_model, &packet.model, sizeof(glm::mat4)) != 0)) {
+            glUniformMatrix4fv(g_model_uniform, 1, GL_FALSE, glm::value_ptr(packet.model));
+            current_model = packet.model;
+            has_model = true;
+        }
+
+        // Parâmetros da axis-aligned bounding box (AABB) do modelo
+        if (packet.mesh != INVALID_MESH_HANDLE && packet.mesh != current_bbox_mesh) {
+            const SceneObject& object = g_VirtualScene[packet.mesh];
+            glUniform4f(g_bbox_min_uniform, object.bbox_min.x, object.bbox_min.y, object.bbox_min.z, 1.0f);
+            glUniform4f(g_bbox_max_uniform, object.bbox_max.x, object.bbox_max.y, object.bbox_max.z, 1.0f);
+            current_bbox_mesh = packet.mesh;
+        }
+
+        void* indices = (void*)(packet.first_index * IndexSize(packet.index_type));
+        if (instanced)
+            glDrawElementsInstancedBaseVertex(packet.rendering_mode, packet.num_indices, packet.index_type, indices,
+                                              packet.instance_count, packet.base_vertex);
+        else
+            glDrawElementsBaseVertex(packet.rendering_mode, packet.num_indices, packet.index_type, indices,
+                                     packet.base_vertex);
+        g_RenderStats.draw_calls++;
+    }
+
+    if (instance_attributes_enabled)
+        DisableInstanceAttributes();
+    glBindVertexArray(0);
+}
@@ -1,39 +1,119 @@
 #include "resource_loader.h"
 #include "utils.h"
 #include "matrices.h"
+#include "enemy_system.h"
+#include "mesh_simplify.h"
+#include "mesh_optimize.h"
+#include "frustum.h"
+#include "camera.h"
+#include "mesh_buffer.h"
+#include "mesh_cache.h"
+#include "worker_pool.h"
+#include "texture_cache.h"
+#include "obj_parser.h"
+#include "asset_archive.h"
+#include "program_cache.h"
+#include "memory_stats.h"
 
 #include <cmath>
 #include <cstdio>
 #include <cstdlib>
 #include <map>
+#include <memory>
+#include <unordered_map>
 #include <string>
+#include <cstring>
+#include <cstddef>
 #include <vector>
 #include <limits>
-#include <fstream>
-#include <sstream>
+#include <streambuf>
+#include <istream>
 #include <stdexcept>
 #include <algorithm>
+#include <utility>
 
 #include <glad/glad.h>
+#include <GLFW/glfw3.h>
 #include <glm/vec3.hpp>
 #include <glm/vec4.hpp>
 #include <tiny_obj_loader.h>
 #include <stb_image.h>
 
-std::map<std::string, SceneObject> g_VirtualScene;
+std::vector<SceneObject> g_VirtualScene;
+GameMeshHandles g_Meshes;
 GLuint g_GpuProgramID = 0;
 GLint g_model_uniform;
-GLint g_view_uniform;
-GLint g_projection_uniform;
-GLint g_object_id_uniform;
 GLint g_bbox_min_uniform;
 GLint g_bbox_max_uniform;
+GLint g_instanced_uniform;
 GLuint g_NumLoadedTextures = 0;
+GLuint g_TextureArrayID = 0;
 
 static int g_ModelsLoaded = 0;
 static int g_ModelsFailed = 0;
 
-// Este construtor lê o modelo de um arquivo utilizando a biblioteca tinyobjloader.
+// Tabela nome -> handle, consultada somente durante o carregamento (e pela
+// versão de depuração de DrawVirtualObject()). Os desenhos usam handles.
+static std::map<std::string, MeshHandle> g_MeshHandlesByName;
+
+// Parâmetros da cadeia de LODs (veja BuildMeshLODs() e SelectMeshLOD())
+static const size_t kLODMinIndices        = 3 * 256; // Objetos menores não são simplificados
+static const float  kLODMaxRelativeError  = 0.05f;   // Erro máximo, relativo à diagonal da AABB
+static const float  kLODMaxPixelError     = 1.0f;    // Erro máximo tolerado na tela, em pixels
+
+// Piora máxima do ACMR aceita para reduzir o overdraw (veja OptimizeOverdraw())
+static const float  kOverdrawACMRThreshold = 1.05f;
+
+// Câmera do quadro atual, usada por SelectMeshLOD()
+static glm::mat4 g_LODView;
+static glm::mat4 g_LODProjection;
+static float     g_LODViewportHeight = 0.0f;
+
+// std::streambuf que lê diretamente de um bloco de memória, sem cópia. Usado
+// para entregar recursos mapeados (veja "asset_archive.h") à tinyobjloader.
+struct MemoryStreamBuffer : public std::streambuf
+{
+    MemoryStreamBuffer(const unsigned char* data, size_t size)
+    {
+        char* begin = const_cast<char*>(reinterpret_cast<const char*>(data));
+        setg(begin, begin, begin + size);
+    }
+};
+
+// Leitor dos arquivos MTL citados por um OBJ, que os busca como recursos
+// (do pacote ou avulsos) no diretório "basedir"
+class AssetMaterialReader : public tinyobj::MaterialReader
+{
+public:
+    explicit AssetMaterialReader(const std::string& basedir) : m_basedir(basedir) {}
+
+    virtual bool operator()(const std::string& mtl_name, std::vector<tinyobj::material_t>* materials,
+                            std::map<std::string, int>* material_map, std::string* warn, std::string* err)
+    {
+        std::string name = m_basedir + mtl_name;
+        AssetView file;
+        if (!OpenAsset(name.c_str(), &file))
+        {
+            if (warn != NULL)
+                *warn += "Material file [ " + name + " ] not found.\n";
+            return false;
+        }
+
+        MemoryStreamBuffer buffer(file.data, file.size);
+        std::istream stream(&buffer);
+        tinyobj::LoadMtl(material_map, materials, &stream, warn, err);
+        ReleaseAsset(&file);
+        return true;
+    }
+
+private:
+    std::string m_basedir;
+};
+
+// Este construtor lê o modelo de um recurso (veja "asset_archive.h")
+// utilizando o leitor de "obj_parser.h", que produz os mesmos dados que a
+// biblioteca tinyobjloader. Arquivos com elementos que ele não trata, ou a
+// leitura sem triangulação, usam a tinyobjloader.
 // Veja: https://github.com/syoyo/tinyobjloader
 ObjModel::ObjModel(const char* filename, const char* basepath, bool triangulate)
 {
@@ -54,9 +134,34 @@ ObjModel::ObjModel(const char* filename, const char* basepath, bool triangulate)
         }
     }
 
+    AssetView file;
+    if (!OpenAsset(filename, &file))
+    {
+        fprintf(stderr, "\nCannot open file [%s]\n", filename);
+        throw std::runtime_error("Erro ao carregar modelo.");
+    }
+
+    AssetMaterialReader material_reader(basepath != NULL ? basepath : "");
     std::string warn;
     std::string err;
-    bool ret = tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, filename, basepath, triangulate);
+    bool ret = false;
+    bool use_tinyobj = true;
+#ifndef DISABLE_FAST_OBJ_PARSER
+    if (triangulate)
+    {
+        ObjParseResult result = ParseObjData(reinterpret_cast<const char*>(file.data), file.size, &material_reader,
+                                             &attrib, &shapes, &materials, &err);
+        use_tinyobj = (result == OBJ_PARSE_UNSUPPORTED);
+        ret = (result == OBJ_PARSE_OK);
+    }
+#endif
+    if (use_tinyobj)
+    {
+        MemoryStreamBuffer buffer(file.data, file.size);
+        std::istream stream(&buffer);
+        ret = tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, &stream, &material_reader, triangulate);
+    }
+    ReleaseAsset(&file);
 
     if (!err.empty())
         fprintf(stderr, "\n%s\n", err.c_str());
@@ -86,17 +191,187 @@ ObjModel::ObjModel(const char* filename, const char* basepath, bool triangulate)
 // FUNÇÕES DE PROCESSAMENTO DE MODELOS
 // ============================================================================
 
+// Codifica uma normal unitária em dois valores snorm16 usando a projeção
+// octaédrica: a esfera é projetada no octaedro |x|+|y|+|z| = 1, e o
+// hemisfério inferior é "dobrado" sobre o quadrado [-1,1]^2. Veja a
+// decodificação correspondente em "shader_vertex.glsl".
+void EncodeOctahedralNormal(float nx, float ny, float nz, GLshort out[2])
+{
+    float sum = std::abs(nx) + std::abs(ny) + std::abs(nz);
+    if ( sum == 0.0f )
+    {
+        // Normal inexistente: codificamos (0,0,1)
+        out[0] = 0;
+        out[1] = 0;
+        return;
+    }
+
+    float x = nx / sum;
+    float y = ny / sum;
+    if ( nz < 0.0f )
+    {
+        float fx = (1.0f - std::abs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+        float fy = (1.0f - std::abs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+        x = fx;
+        y = fy;
+    }
+
+    out[0] = (GLshort)std::lround(std::max(-1.0f, std::min(1.0f, x)) * 32767.0f);
+    out[1] = (GLshort)std::lround(std::max(-1.0f, std::min(1.0f, y)) * 32767.0f);
+}
+
+// Define os atributos de PackedVertex no VAO atualmente ligado, lendo do
+// GL_ARRAY_BUFFER atualmente ligado.
+void SetupPackedVertexAttributes()
+{
+    GLsizei stride = sizeof(PackedVertex);
+
+    // "(location = 0)" em "shader_vertex.glsl": três floats; o W = 1 é
+    // preenchido pela própria OpenGL.
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(PackedVertex, position));
+    glEnableVertexAttribArray(0);
+
+    // "(location = 1)": dois shorts normalizados para [-1,1]
+    glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, stride, (void*)offsetof(PackedVertex, normal));
+    glEnableVertexAttribArray(1);
+
+    // "(location = 2)": coordenadas de textura
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(PackedVertex, texcoords));
+    glEnableVertexAttribArray(2);
+}
+
+// Tamanho em bytes de um índice do tipo dado (GL_UNSIGNED_SHORT ou GL_UNSIGNED_INT)
+static size_t IndexSize(GLenum index_type)
+{
+    return index_type == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+}
+
+// Hash e igualdade byte a byte de PackedVertex, usados para encontrar
+// vértices idênticos (mesma posição, normal e coordenada de textura).
+struct PackedVertexHash
+{
+    size_t operator()(const PackedVertex& v) const
+    {
+        // FNV-1a
+        const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&v);
+        size_t hash = 2166136261u;
+        for (size_t i = 0; i < sizeof(PackedVertex); ++i)
+        {
+            hash ^= bytes[i];
+            hash *= 16777619u;
+        }
+        return hash;
+    }
+};
+
+struct PackedVertexEqual
+{
+    bool operator()(const PackedVertex& a, const PackedVertex& b) const
+    {
+        return memcmp(&a, &b, sizeof(PackedVertex)) == 0;
+    }
+};
+
+// Gera a cadeia de LODs de um objeto. Cada nível tem no máximo metade dos
+// triângulos do anterior e é anexado ao final de "indices", reaproveitando os
+// vértices do objeto original. A cadeia termina quando a simplificação não
+// consegue mais reduzir a malha sem ultrapassar o erro máximo.
+static void BuildMeshLODs(SceneObject& object, const std::vector<PackedVertex>& vertices, std::vector<GLuint>& indices)
+{
+    object.lods[0].first_index = object.first_index;
+    object.lods[0].num_indices = object.num_indices;
+    object.lods[0].error       = 0.0f;
+    object.num_lods = 1;
+
+    if ( object.rendering_mode != GL_TRIANGLES || object.num_indices < kLODMinIndices )
+        return;
+
+    float max_error = kLODMaxRelativeError * glm::length(object.bbox_max - object.bbox_min);
+
+    std::vector<GLuint> source;
+    std::vector<GLuint> simplified;
+
+    while ( object.num_lods < MAX_MESH_LODS )
+    {
+        const MeshLOD& previous = object.lods[object.num_lods - 1];
+        source.assign(indices.begin() + previous.first_index,
+                      indices.begin() + previous.first_index + previous.num_indices);
+
+        size_t target = (previous.num_indices / 2) / 3 * 3;
+        float error = SimplifyMesh(vertices, source.data(), source.size(), target, max_error, simplified);
+
+        // Um nível que remove menos de 15% dos triângulos não compensa
+        if ( simplified.empty() || simplified.size() > previous.num_indices * 85 / 100 )
+            break;
+
+        OptimizeVertexCache(simplified.data(), simplified.size(), vertices.size(), NULL);
+
+        MeshLOD lod;
+        lod.first_index = indices.size();
+        lod.num_indices = simplified.size();
+        lod.error       = previous.error + error; // Os erros de níveis sucessivos se acumulam
+        indices.insert(indices.end(), simplified.begin(), simplified.end());
+
+        object.lods[object.num_lods++] = lod;
+    }
+
+    if ( object.num_lods > 1 )
+    {
+        printf("  (LODs de %s:", object.name.c_str());
+        for (int i = 0; i < object.num_lods; ++i)
+            printf(" %d", (int)(object.lods[i].num_indices / 3));
+        printf(" triangulos)\n");
+    }
+}
+
+// Reordena os triângulos de um objeto para o cache de vértices da GPU e
+// para reduzir o overdraw (veja "mesh_optimize.h"), imprimindo o ACMR antes
+// e depois
+static void OptimizeObjectIndices(const SceneObject& object, const std::vector<PackedVertex>& vertices,
+                                  std::vector<GLuint>& indices)
+{
+    if ( object.num_indices < 3 )
+        return;
+
+    GLuint* first = indices.data() + object.first_index;
+    float acmr_before = ComputeACMR(first, object.num_indices, vertices.size());
+
+    std::vector<size_t> clusters;
+    OptimizeVertexCache(first, object.num_indices, vertices.size(), &clusters);
+    OptimizeOverdraw(vertices, first, object.num_indices, clusters, kOverdrawACMRThreshold);
+
+    float acmr_after = ComputeACMR(first, object.num_indices, vertices.size());
+    printf("  (ACMR de %s: %.3f -> %.3f)\n", object.name.c_str(), acmr_before, acmr_after);
+}
+
 // Constrói triângulos para futura renderização a partir de um ObjModel.
-void BuildTrianglesAndAddToVirtualScene(ObjModel* model)
+//
+// Cada canto de triângulo é convertido para um PackedVertex, e cantos
+// idênticos são deduplicados, de forma que o buffer de índices realmente
+// reaproveita vértices. Todos os objetos do arquivo compartilham os mesmos
+// vértices, e a cadeia de LODs de cada objeto é anexada ao mesmo vetor de
+// índices. Por fim, os triângulos são reordenados para o cache de vértices e
+// os vértices, na ordem em que são usados.
+void BuildMeshData(ObjModel* model, MeshData* mesh)
 {
-    GLuint vertex_array_object_id;
-    glGenVertexArrays(1, &vertex_array_object_id);
-    glBindVertexArray(vertex_array_object_id);
+    size_t total_corners = 0;
+    for (size_t shape = 0; shape < model->shapes.size(); ++shape)
+        total_corners += model->shapes[shape].mesh.indices.size();
 
-    std::vector<GLuint> indices;
-    std::vector<float>  model_coefficients;
-    std::vector<float>  normal_coefficients;
-    std::vector<float>  texture_coefficients;
+    std::vector<GLuint>&       indices = mesh->indices;
+    std::vector<PackedVertex>& vertices = mesh->vertices;
+    std::unordered_map<PackedVertex, GLuint, PackedVertexHash, PackedVertexEqual> unique_vertices;
+
+    indices.clear();
+    vertices.clear();
+    mesh->objects.clear();
+
+    // Os LODs são acrescentados ao final dos índices: cada nível tem no máximo
+    // ~metade dos triângulos do anterior, então reservamos o dobro para que o
+    // vetor não seja realocado (e copiado) durante BuildMeshLODs()
+    indices.reserve(2 * total_corners);
+    vertices.reserve(model->attrib.vertices.size() / 3);
+    unique_vertices.reserve(model->attrib.vertices.size() / 3);
 
     for (size_t shape = 0; shape < model->shapes.size(); ++shape)
     {
@@ -117,16 +392,15 @@ void BuildTrianglesAndAddToVirtualScene(ObjModel* model)
             {
                 tinyobj::index_t idx = model->shapes[shape].mesh.indices[3*triangle + vertex];
 
-                indices.push_back(first_index + 3*triangle + vertex);
+                PackedVertex packed;
+                memset(&packed, 0, sizeof(packed));
 
                 const float vx = model->attrib.vertices[3*idx.vertex_index + 0];
                 const float vy = model->attrib.vertices[3*idx.vertex_index + 1];
                 const float vz = model->attrib.vertices[3*idx.vertex_index + 2];
-                //printf("tri %d vert %d = (%.2f, %.2f, %.2f)\n", (int)triangle, (int)vertex, vx, vy, vz);
-                model_coefficients.push_back( vx ); // X
-                model_coefficients.push_back( vy ); // Y
-                model_coefficients.push_back( vz ); // Z
-                model_coefficients.push_back( 1.0f ); // W
+                packed.position[0] = vx;
+                packed.position[1] = vy;
+                packed.position[2] = vz;
 
                 bbox_min.x = std::min(bbox_min.x, vx);
                 bbox_min.y = std::min(bbox_min.y, vy);
@@ -145,89 +419,173 @@ void BuildTrianglesAndAddToVirtualScene(ObjModel* model)
                     const float nx = model->attrib.normals[3*idx.normal_index + 0];
                     const float ny = model->attrib.normals[3*idx.normal_index + 1];
                     const float nz = model->attrib.normals[3*idx.normal_index + 2];
-                    normal_coefficients.push_back( nx ); // X
-                    normal_coefficients.push_back( ny ); // Y
-                    normal_coefficients.push_back( nz ); // Z
-                    normal_coefficients.push_back( 0.0f ); // W
+                    EncodeOctahedralNormal(nx, ny, nz, packed.normal);
                 }
 
                 if ( idx.texcoord_index != -1 )
                 {
-                    const float u = model->attrib.texcoords[2*idx.texcoord_index + 0];
-                    const float v = model->attrib.texcoords[2*idx.texcoord_index + 1];
-                    texture_coefficients.push_back( u );
-                    texture_coefficients.push_back( v );
+                    packed.texcoords[0] = model->attrib.texcoords[2*idx.texcoord_index + 0];
+                    packed.texcoords[1] = model->attrib.texcoords[2*idx.texcoord_index + 1];
                 }
+
+                std::pair<std::unordered_map<PackedVertex, GLuint, PackedVertexHash, PackedVertexEqual>::iterator, bool> inserted
+                    = unique_vertices.insert(std::make_pair(packed, (GLuint)vertices.size()));
+                if ( inserted.second )
+                    vertices.push_back(packed);
+
+                indices.push_back(inserted.first->second);
             }
         }
 
-        size_t last_index = indices.size() - 1;
-
         SceneObject theobject;
         theobject.name           = model->shapes[shape].name;
         theobject.first_index    = first_index; // Primeiro índice
-        theobject.num_indices    = last_index - first_index + 1; // Número de indices
+        theobject.num_indices    = indices.size() - first_index; // Número de indices
         theobject.rendering_mode = GL_TRIANGLES;       // Índices correspondem ao tipo de rasterização GL_TRIANGLES.
-        theobject.vertex_array_object_id = vertex_array_object_id;
+        theobject.index_type     = GL_UNSIGNED_INT;    // Definido por AddMeshToVirtualScene()
+        theobject.vertex_array_object_id = 0;          // Idem
+        theobject.base_vertex    = 0;
 
         theobject.bbox_min = bbox_min;
         theobject.bbox_max = bbox_max;
+        theobject.num_lods = 0; // Preenchido por BuildMeshLODs()
 
-        g_VirtualScene[model->shapes[shape].name] = theobject;
-    }
-
-    GLuint VBO_model_coefficients_id;
-    glGenBuffers(1, &VBO_model_coefficients_id);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO_model_coefficients_id);
-    glBufferData(GL_ARRAY_BUFFER, model_coefficients.size() * sizeof(float), NULL, GL_STATIC_DRAW);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, model_coefficients.size() * sizeof(float), model_coefficients.data());
-    GLuint location = 0; // "(location = 0)" em "shader_vertex.glsl"
-    GLint  number_of_dimensions = 4; // vec4 em "shader_vertex.glsl"
-    glVertexAttribPointer(location, number_of_dimensions, GL_FLOAT, GL_FALSE, 0, 0);
-    glEnableVertexAttribArray(location);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-    if ( !normal_coefficients.empty() )
-    {
-        GLuint VBO_normal_coefficients_id;
-        glGenBuffers(1, &VBO_normal_coefficients_id);
-        glBindBuffer(GL_ARRAY_BUFFER, VBO_normal_coefficients_id);
-        glBufferData(GL_ARRAY_BUFFER, normal_coefficients.size() * sizeof(float), NULL, GL_STATIC_DRAW);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, normal_coefficients.size() * sizeof(float), normal_coefficients.data());
-        location = 1; // "(location = 1)" em "shader_vertex.glsl"
-        number_of_dimensions = 4; // vec4 em "shader_vertex.glsl"
-        glVertexAttribPointer(location, number_of_dimensions, GL_FLOAT, GL_FALSE, 0, 0);
-        glEnableVertexAttribArray(location);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        OptimizeObjectIndices(theobject, vertices, indices);
+        mesh->objects.push_back(theobject);
     }
 
-    if ( !texture_coefficients.empty() )
+    // Cadeia de LODs de cada objeto, no mesmo buffer de índices
+    for (size_t i = 0; i < mesh->objects.size(); ++i)
+        BuildMeshLODs(mesh->objects[i], vertices, indices);
+
+    OptimizeVertexFetch(vertices, indices);
+}
+
+// Com até 65536 vértices únicos, índices de 16 bits são suficientes e
+// ocupam metade da memória. Nesse caso a malha vai para o buffer
+// compartilhado por todos os modelos (veja "mesh_buffer.h").
+GLenum MeshIndexType(size_t num_vertices)
+{
+    return num_vertices <= MESH_BUFFER_MAX_VERTICES_PER_RANGE ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+}
+
+// Envia uma malha para a GPU e adiciona seus objetos a g_VirtualScene. Os
+// índices devem estar no formato MeshIndexType(num_vertices), e as faixas de
+// "objects" são relativas ao início de "indices".
+void AddMeshToVirtualScene(const std::vector<SceneObject>& objects,
+                           const PackedVertex* vertices, size_t num_vertices,
+                           const void* indices, size_t num_indices, GLenum index_type)
+{
+    GLuint vertex_array_object_id = 0;
+    GLint  base_vertex = 0;
+    size_t index_offset = 0;
+
+    if ( index_type == GL_UNSIGNED_SHORT )
     {
-        GLuint VBO_texture_coefficients_id;
-        glGenBuffers(1, &VBO_texture_coefficients_id);
-        glBindBuffer(GL_ARRAY_BUFFER, VBO_texture_coefficients_id);
-        glBufferData(GL_ARRAY_BUFFER, texture_coefficients.size() * sizeof(float), NULL, GL_STATIC_DRAW);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, texture_coefficients.size() * sizeof(float), texture_coefficients.data());
-        location = 2; // "(location = 1)" em "shader_vertex.glsl"
-        number_of_dimensions = 2; // vec2 em "shader_vertex.glsl"
-        glVertexAttribPointer(location, number_of_dimensions, GL_FLOAT, GL_FALSE, 0, 0);
-        glEnableVertexAttribArray(location);
+        AppendToSharedMeshBuffer(vertices, num_vertices, static_cast<const GLushort*>(indices), num_indices,
+                                 &base_vertex, &index_offset);
+        vertex_array_object_id = GetSharedMeshVAO();
+    }
+    else
+    {
+        // Malhas muito grandes ficam com VAO e buffers próprios, com índices
+        // de 32 bits
+        glGenVertexArrays(1, &vertex_array_object_id);
+        glBindVertexArray(vertex_array_object_id);
+
+        GLuint VBO_vertices_id;
+        glGenBuffers(1, &VBO_vertices_id);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO_vertices_id);
+        glBufferData(GL_ARRAY_BUFFER, num_vertices * sizeof(PackedVertex), vertices, GL_STATIC_DRAW);
+        SetupPackedVertexAttributes();
         glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        GLuint indices_id;
+        glGenBuffers(1, &indices_id);
+
+        // "Ligamos" o buffer. Note que o tipo agora é GL_ELEMENT_ARRAY_BUFFER.
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indices_id);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, num_indices * sizeof(GLuint), indices, GL_STATIC_DRAW);
+        // glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0); // XXX Errado!
+
+        // "Desligamos" o VAO, evitando assim que operações posteriores venham a
+        // alterar o mesmo. Isso evita bugs.
+        glBindVertexArray(0);
     }
 
-    GLuint indices_id;
-    glGenBuffers(1, &indices_id);
+    for (size_t i = 0; i < objects.size(); ++i)
+    {
+        // As faixas de índices (inclusive as dos LODs) passam a ser relativas
+        // ao início do buffer onde a malha foi armazenada
+        SceneObject object = objects[i];
+        object.index_type = index_type;
+        object.vertex_array_object_id = vertex_array_object_id;
+        object.base_vertex = base_vertex;
+        object.first_index += index_offset;
+        for (int lod = 0; lod < object.num_lods; ++lod)
+            object.lods[lod].first_index += index_offset;
+
+        // Um objeto com nome repetido substitui o anterior, mantendo o handle
+        std::map<std::string, MeshHandle>::iterator it = g_MeshHandlesByName.find(object.name);
+        if (it != g_MeshHandlesByName.end())
+        {
+            g_VirtualScene[it->second] = object;
+        }
+        else
+        {
+            g_MeshHandlesByName[object.name] = (MeshHandle)g_VirtualScene.size();
+            g_VirtualScene.push_back(object);
+        }
+    }
 
-    // "Ligamos" o buffer. Note que o tipo agora é GL_ELEMENT_ARRAY_BUFFER.
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indices_id);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), NULL, GL_STATIC_DRAW);
-    glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, indices.size() * sizeof(GLuint), indices.data());
-    // glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0); // XXX Errado!
-    //
+    printf("  (%d vertices unicos para %d indices, %s bits, %.1f KB)\n",
+           (int)num_vertices, (int)num_indices, index_type == GL_UNSIGNED_SHORT ? "16" : "32",
+           (num_vertices * sizeof(PackedVertex) + num_indices * IndexSize(index_type)) / 1024.0f);
+}
 
-    // "Desligamos" o VAO, evitando assim que operações posteriores venham a
-    // alterar o mesmo. Isso evita bugs.
-    glBindVertexArray(0);
+// Envia uma malha construída por BuildMeshData() para a GPU
+void AddMeshDataToVirtualScene(const MeshData& mesh)
+{
+    GLenum index_type = MeshIndexType(mesh.vertices.size());
+    if ( index_type == GL_UNSIGNED_SHORT )
+    {
+        std::vector<GLushort> short_indices(mesh.indices.begin(), mesh.indices.end());
+        AddMeshToVirtualScene(mesh.objects, mesh.vertices.data(), mesh.vertices.size(),
+                              short_indices.data(), short_indices.size(), index_type);
+    }
+    else
+    {
+        AddMeshToVirtualScene(mesh.objects, mesh.vertices.data(), mesh.vertices.size(),
+                              mesh.indices.data(), mesh.indices.size(), index_type);
+    }
+}
+
+void BuildTrianglesAndAddToVirtualScene(ObjModel* model)
+{
+    MeshData mesh;
+    BuildMeshData(model, &mesh);
+    AddMeshDataToVirtualScene(mesh);
+}
+
+// Carrega um arquivo OBJ (com normais calculadas, se faltarem) e o adiciona
+// a g_VirtualScene. A malha processada fica em um cache binário ao lado do
+// arquivo (veja "mesh_cache.h"); enquanto o OBJ não muda, as próximas
+// execuções usam o cache sem ler o OBJ. Lança std::runtime_error se o
+// arquivo não pode ser carregado.
+void LoadObjModelCached(const char* filename)
+{
+    MeshCacheKey key;
+    if ( LoadMeshCache(filename, &key) )
+        return;
+
+    ObjModel model(filename);
+    ComputeNormals(&model);
+
+    MeshData mesh;
+    BuildMeshData(&model, &mesh);
+    AddMeshDataToVirtualScene(mesh);
+
+    WriteMeshCache(filename, key, mesh);
 }
 
 // Função que computa as normais de um ObjModel, caso elas não tenham sido
@@ -293,73 +651,358 @@ void ComputeNormals(ObjModel* model)
     }
 }
 
-// Função que carrega os shaders de vértices e de fragmentos que serão
-// utilizados para renderização. Veja slides 180-200 do documento Aula_03_Rendering_Pipeline_Grafico.pdf.
-void LoadShadersFromFiles()
-{
-    GLuint vertex_shader_id = LoadShader_Vertex("../../src/shader_vertex.glsl");
-    GLuint fragment_shader_id = LoadShader_Fragment("../../src/shader_fragment.glsl");
-
-    // Deletamos o programa de GPU anterior, caso ele exista.
-    if ( g_GpuProgramID != 0 )
-        glDeleteProgram(g_GpuProgramID);
-
-    // Criamos um programa de GPU utilizando os shaders carregados acima.
-    g_GpuProgramID = CreateGpuProgram(vertex_shader_id, fragment_shader_id);
-
-    // Buscamos o endereço das variáveis definidas dentro do Vertex Shader.
-    // Utilizaremos estas variáveis para enviar dados para a placa de vídeo
-    // (GPU)! Veja arquivo "shader_vertex.glsl" e "shader_fragment.glsl".
-    g_model_uniform      = glGetUniformLocation(g_GpuProgramID, "model"); // Variável da matriz "model"
-    g_view_uniform       = glGetUniformLocation(g_GpuProgramID, "view"); // Variável da matriz "view" em shader_vertex.glsl
-    g_projection_uniform = glGetUniformLocation(g_GpuProgramID, "projection"); // Variável da matriz "projection" em shader_vertex.glsl
-    g_object_id_uniform  = glGetUniformLocation(g_GpuProgramID, "object_id"); // Variável "object_id" em shader_fragment.glsl
-    g_bbox_min_uniform   = glGetUniformLocation(g_GpuProgramID, "bbox_min");
-    g_bbox_max_uniform   = glGetUniformLocation(g_GpuProgramID, "bbox_max");
-
-    // Variáveis em "shader_fragment.glsl" para acesso das imagens de textura
-    glUseProgram(g_GpuProgramID);
-    glUniform1i(glGetUniformLocation(g_GpuProgramID, "texture_grass"), 0);
-    glUniform1i(glGetUniformLocation(g_GpuProgramID, "texture_path"), 1);
-    glUniform1i(glGetUniformLocation(g_GpuProgramID, "texture_chicken"), 2);
-    glUniform1i(glGetUniformLocation(g_GpuProgramID, "texture_thompson"), 3);
-    glUniform1i(glGetUniformLocation(g_GpuProgramID, "texture_beagle"), 4);
-    glUniform1i(glGetUniformLocation(g_GpuProgramID, "texture_ak47"), 5);
-    glUniform1i(glGetUniformLocation(g_GpuProgramID, "texture_hawk"), 6);
-    glUniform1i(glGetUniformLocation(g_GpuProgramID, "texture_fox"), 7);
-    glUniform1i(glGetUniformLocation(g_GpuProgramID, "texture_wolf"), 8);
-    glUniform1i(glGetUniformLocation(g_GpuProgramID, "texture_rat"), 9);
-    glUniform1i(glGetUniformLocation(g_GpuProgramID, "texture_chicken_coop"), 10);
-    glUniform1i(glGetUniformLocation(g_GpuProgramID, "texture_egg"), 11);
-    
-    glUseProgram(0);
+// Conversões entre sRGB (8 bits) e intensidade linear, usadas ao
+// redimensionar as imagens: a média de cores deve ser feita no espaço linear,
+// assim como faz a GPU ao filtrar texturas GL_SRGB8.
+struct SRGBTables
+{
+    static const int kLinearTableSize = 4096;
+    float         to_linear[256];
+    unsigned char to_srgb[kLinearTableSize + 1];
+
+    SRGBTables()
+    {
+        for (int i = 0; i < 256; ++i)
+        {
+            float c = i / 255.0f;
+            to_linear[i] = (c <= 0.04045f) ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+        }
+        for (int i = 0; i <= kLinearTableSize; ++i)
+        {
+            float c = (float)i / kLinearTableSize;
+            float srgb = (c <= 0.0031308f) ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+            to_srgb[i] = (unsigned char)std::lround(std::max(0.0f, std::min(1.0f, srgb)) * 255.0f);
+        }
+    }
+};
+
+// As imagens são redimensionadas em paralelo: a inicialização de uma
+// variável estática local é thread-safe em C++11
+static const SRGBTables& GetSRGBTables()
+{
+    static const SRGBTables tables;
+    return tables;
+}
+
+static float SRGBToLinear(const SRGBTables& tables, unsigned char value)
+{
+    return tables.to_linear[value];
 }
 
+static unsigned char LinearToSRGB(const SRGBTables& tables, float value)
+{
+    value = std::max(0.0f, std::min(1.0f, value));
+    return tables.to_srgb[(int)(value * SRGBTables::kLinearTableSize + 0.5f)];
+}
 
-// Função que carrega uma imagem para ser utilizada como textura
-void LoadTextureImage(const char* filename)
+// Pesos de um filtro de redimensionamento em um eixo: cada pixel de destino
+// é uma soma ponderada de uma faixa contígua de pixels de origem.
+struct ResampleTap
 {
-    printf("Carregando imagem \"%s\"... ", filename);
+    int first;                  // Primeiro pixel de origem
+    std::vector<float> weights; // Pesos a partir de "first" (somam 1)
+};
+
+static void ComputeResampleTaps(int src_size, int dst_size, std::vector<ResampleTap>& taps)
+{
+    taps.resize(dst_size);
+    float scale = (float)src_size / dst_size;
+
+    for (int x = 0; x < dst_size; ++x)
+    {
+        ResampleTap& tap = taps[x];
+        tap.weights.clear();
+
+        if ( scale > 1.0f )
+        {
+            // Redução: média da área coberta pelo pixel de destino (box filter)
+            float begin = x * scale;
+            float end = begin + scale;
+            tap.first = (int)begin;
+            int last = std::min(src_size - 1, (int)std::ceil(end) - 1);
+            for (int i = tap.first; i <= last; ++i)
+            {
+                float overlap = std::min(end, (float)(i + 1)) - std::max(begin, (float)i);
+                tap.weights.push_back(overlap / scale);
+            }
+        }
+        else
+        {
+            // Ampliação: interpolação bilinear com GL_CLAMP_TO_EDGE, igual à
+            // filtragem GL_LINEAR da imagem original
+            float center = (x + 0.5f) * scale - 0.5f;
+            int i0 = (int)std::floor(center);
+            float t = center - i0;
+            int a = std::max(0, std::min(src_size - 1, i0));
+            int b = std::max(0, std::min(src_size - 1, i0 + 1));
+            tap.first = a;
+            if ( a == b )
+                tap.weights.push_back(1.0f);
+            else
+            {
+                tap.weights.push_back(1.0f - t);
+                tap.weights.push_back(t);
+            }
+        }
+    }
+}
+
+// Redimensiona uma imagem RGB sRGB de src_width x src_height para
+// dst_width x dst_height, filtrando cada eixo separadamente.
+static void ResampleImageRGB(const unsigned char* src, int src_width, int src_height,
+                             unsigned char* dst, int dst_width, int dst_height)
+{
+    const SRGBTables& tables = GetSRGBTables();
+    std::vector<ResampleTap> taps_x, taps_y;
+    ComputeResampleTaps(src_width, dst_width, taps_x);
+    ComputeResampleTaps(src_height, dst_height, taps_y);
+
+    // Passo horizontal: src_height linhas de dst_width pixels, em intensidade linear
+    std::vector<float> rows((size_t)src_height * dst_width * 3);
+    for (int y = 0; y < src_height; ++y)
+    {
+        const unsigned char* src_row = src + (size_t)y * src_width * 3;
+        float* row = &rows[(size_t)y * dst_width * 3];
+        for (int x = 0; x < dst_width; ++x)
+        {
+            const ResampleTap& tap = taps_x[x];
+            float r = 0.0f, g = 0.0f, b = 0.0f;
+            for (size_t k = 0; k < tap.weights.size(); ++k)
+            {
+                const unsigned char* pixel = src_row + (size_t)(tap.first + k) * 3;
+                r += tap.weights[k] * SRGBToLinear(tables, pixel[0]);
+                g += tap.weights[k] * SRGBToLinear(tables, pixel[1]);
+                b += tap.weights[k] * SRGBToLinear(tables, pixel[2]);
+            }
+            row[3*x + 0] = r;
+            row[3*x + 1] = g;
+            row[3*x + 2] = b;
+        }
+    }
+
+    // Passo vertical, convertendo de volta para sRGB
+    for (int y = 0; y < dst_height; ++y)
+    {
+        const ResampleTap& tap = taps_y[y];
+        unsigned char* dst_row = dst + (size_t)y * dst_width * 3;
+        for (int x = 0; x < 3 * dst_width; ++x)
+        {
+            float value = 0.0f;
+            for (size_t k = 0; k < tap.weights.size(); ++k)
+                value += tap.weights[k] * rows[(size_t)(tap.first + k) * dst_width * 3 + x];
+            dst_row[x] = LinearToSRGB(tables, value);
+        }
+    }
+}
+
+// Reduz uma imagem RGB sRGB de size x size para (size/2) x (size/2), com a
+// média de cada bloco de 2x2 pixels no espaço linear (como glGenerateMipmap()
+// faz com texturas GL_SRGB8)
+static void DownsampleImageRGB(const unsigned char* src, int size, unsigned char* dst)
+{
+    const SRGBTables& tables = GetSRGBTables();
+    int dst_size = size / 2;
+    for (int y = 0; y < dst_size; ++y)
+    {
+        const unsigned char* row0 = src + (size_t)(2*y) * size * 3;
+        const unsigned char* row1 = row0 + (size_t)size * 3;
+        unsigned char* dst_row = dst + (size_t)y * dst_size * 3;
+        for (int x = 0; x < 3 * dst_size; ++x)
+        {
+            int c = x % 3;
+            int src_x = 2 * (x - c) + c;
+            float value = SRGBToLinear(tables, row0[src_x]) + SRGBToLinear(tables, row0[src_x + 3])
+                        + SRGBToLinear(tables, row1[src_x]) + SRGBToLinear(tables, row1[src_x + 3]);
+            dst_row[x] = LinearToSRGB(tables, 0.25f * value);
+        }
+    }
+}
+
+// Calcula a cadeia de mipmaps de uma camada TEXTURE_LAYER_SIZE x
+// TEXTURE_LAYER_SIZE, já no formato enviado para a GPU (veja
+// "texture_cache.h")
+static void BuildTextureMipChain(std::vector<unsigned char>& level_pixels, TextureFormat format,
+                                 std::vector<unsigned char>* chain)
+{
+    chain->resize(TextureMipChainBytes(format, TEXTURE_LAYER_SIZE));
+
+    std::vector<unsigned char> next_pixels;
+    size_t offset = 0;
+    for (int size = TEXTURE_LAYER_SIZE; ; size /= 2)
+    {
+        if ( format == TEXTURE_FORMAT_BC1 )
+            EncodeBC1(level_pixels.data(), size, size, chain->data() + offset);
+        else
+            std::memcpy(chain->data() + offset, level_pixels.data(), TextureLevelBytes(format, size));
+        offset += TextureLevelBytes(format, size);
+
+        if ( size == 1 )
+            break;
+
+        next_pixels.resize((size_t)(size / 2) * (size / 2) * 3);
+        DownsampleImageRGB(level_pixels.data(), size, next_pixels.data());
+        level_pixels.swap(next_pixels);
+    }
+}
+
+// Formato das camadas, escolhido na primeira chamada de LoadTextureImage()
+static TextureFormat g_TextureFormat = TEXTURE_FORMAT_RGB8;
+static bool g_TextureFormatChosen = false;
+
+#ifndef GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_SRGB_S3TC_DXT1_EXT 0x8C4C
+#endif
+
+// Usa BC1 se a OpenGL aceita texturas S3TC sRGB (compile com
+// -DDISABLE_TEXTURE_COMPRESSION para manter as texturas sem compressão)
+static void ChooseTextureFormat()
+{
+    if ( g_TextureFormatChosen )
+        return;
+    g_TextureFormatChosen = true;
+
+#ifndef DISABLE_TEXTURE_COMPRESSION
+    if ( glfwExtensionSupported("GL_EXT_texture_compression_s3tc")
+         && (glfwExtensionSupported("GL_EXT_texture_sRGB") || glfwExtensionSupported("GL_EXT_texture_compression_s3tc_srgb")) )
+        g_TextureFormat = TEXTURE_FORMAT_BC1;
+#endif
+}
+
+// Arquivo de cada camada de g_TextureArrayID e se a sua leitura já foi
+// pedida (veja RequestTextureLayer()). Somente a thread principal acessa
+// estes vetores.
+static std::vector<std::string> g_TextureLayerFiles;
+static std::vector<bool>        g_TextureLayerRequested;
+
+// Envia para a GPU a cadeia de mipmaps de uma camada, no formato
+// g_TextureFormat (veja BuildTextureMipChain())
+static void UploadTextureLayer(GLint layer, const unsigned char* chain)
+{
+    glActiveTexture(GL_TEXTURE0 + DIFFUSE_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, g_TextureArrayID);
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
+    glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
+
+    const int num_levels = TextureMipLevels(TEXTURE_LAYER_SIZE);
+    size_t level_offset = 0;
+    for (int level = 0; level < num_levels; ++level)
+    {
+        int size = std::max(1, TEXTURE_LAYER_SIZE >> level);
+        size_t level_bytes = TextureLevelBytes(g_TextureFormat, size);
+
+        if ( g_TextureFormat == TEXTURE_FORMAT_BC1 )
+            glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, size, size, 1,
+                                      GL_COMPRESSED_SRGB_S3TC_DXT1_EXT, (GLsizei)level_bytes, chain + level_offset);
+        else
+            glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, size, size, 1,
+                            GL_RGB, GL_UNSIGNED_BYTE, chain + level_offset);
+
+        level_offset += level_bytes;
+    }
+}
+
+// Executada por uma thread de trabalho: usa o cache da imagem se estiver
+// válido, ou lê, redimensiona e calcula os mipmaps (e grava o cache). O
+// resultado é enviado para a GPU pela thread principal.
+static void DecodeTextureLayer(const std::string& filename, GLint layer, TextureFormat format)
+{
+    // O cache continua mapeado até o envio, feito direto do mapeamento
+    std::shared_ptr<TextureCacheView> cache(new TextureCacheView());
+
+    TextureCacheKey key;
+    if ( ReadTextureCache(filename.c_str(), format, TEXTURE_LAYER_SIZE, &key, cache.get()) )
+    {
+        PostMainThreadTask([filename, layer, cache]() {
+            printf("Imagem \"%s\" carregada do cache.\n", filename.c_str());
+            UploadTextureLayer(layer, cache->mips);
+            ReleaseTextureCache(cache.get());
+        });
+        return;
+    }
 
-    // Primeiro fazemos a leitura da imagem do disco
-    stbi_set_flip_vertically_on_load(true);
     int width;
     int height;
     int channels;
-    unsigned char *data = stbi_load(filename, &width, &height, &channels, 3);
+    unsigned char *data = NULL;
+    AssetView file;
+    if ( OpenAsset(filename.c_str(), &file) )
+    {
+        data = stbi_load_from_memory(file.data, (int)file.size, &width, &height, &channels, 3);
+        ReleaseAsset(&file);
+    }
 
+    // A camada continua com a cor do placeholder
     if ( data == NULL )
     {
-        fprintf(stderr, "ERROR: Cannot open image file \"%s\".\n", filename);
-        std::exit(EXIT_FAILURE);
+        PostMainThreadTask([filename]() {
+            fprintf(stderr, "ERROR: Cannot open image file \"%s\".\n", filename.c_str());
+        });
+        return;
     }
 
-    printf("OK (%dx%d).\n", width, height);
+    const size_t layer_bytes = (size_t)TEXTURE_LAYER_SIZE * TEXTURE_LAYER_SIZE * 3;
+    std::vector<unsigned char> pixels(layer_bytes);
+
+    if ( width == TEXTURE_LAYER_SIZE && height == TEXTURE_LAYER_SIZE )
+        std::memcpy(pixels.data(), data, layer_bytes);
+    else
+        ResampleImageRGB(data, width, height, pixels.data(), TEXTURE_LAYER_SIZE, TEXTURE_LAYER_SIZE);
+
+    stbi_image_free(data);
+
+    std::shared_ptr<std::vector<unsigned char> > mips(new std::vector<unsigned char>());
+    BuildTextureMipChain(pixels, format, mips.get());
+    WriteTextureCache(filename.c_str(), key, format, TEXTURE_LAYER_SIZE, *mips);
+
+    PostMainThreadTask([filename, layer, mips, width, height]() {
+        printf("Imagem \"%s\" carregada (%dx%d).\n", filename.c_str(), width, height);
+        UploadTextureLayer(layer, mips->data());
+    });
+}
+
+// Função que registra uma imagem para ser utilizada como textura. A imagem
+// é redimensionada para TEXTURE_LAYER_SIZE x TEXTURE_LAYER_SIZE e vira uma
+// camada de g_TextureArrayID, criada por CreateTextureArray() depois que
+// todas as imagens forem registradas. A leitura só acontece quando a camada
+// é usada pela primeira vez (veja RequestTextureLayer()). Retorna o índice
+// da camada, na ordem das chamadas.
+GLint LoadTextureImage(const char* filename)
+{
+    ChooseTextureFormat();
+
+    // stb_image lê esta opção de uma variável global: definimos antes de
+    // qualquer leitura
+    stbi_set_flip_vertically_on_load(true);
+
+    GLint layer = (GLint)g_NumLoadedTextures;
+    g_TextureLayerFiles.push_back(filename);
+    g_TextureLayerRequested.push_back(false);
+    g_NumLoadedTextures += 1;
+    return layer;
+}
+
+// Cria a textura GL_TEXTURE_2D_ARRAY com uma camada para cada imagem
+// registrada por LoadTextureImage(), ligada à unidade DIFFUSE_TEXTURE_UNIT.
+// Todas as camadas começam com um cinza uniforme (o placeholder), até que a
+// imagem seja lida.
+void CreateTextureArray()
+{
+    if ( g_NumLoadedTextures == 0 )
+        return;
+
+    GLint max_layers = 0;
+    glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &max_layers);
+    if ( (GLint)g_NumLoadedTextures > max_layers )
+    {
+        fprintf(stderr, "ERROR: %u texturas excedem o limite de %d camadas.\n", g_NumLoadedTextures, max_layers);
+        std::exit(EXIT_FAILURE);
+    }
 
-    // Agora criamos objetos na GPU com OpenGL para armazenar a textura
-    GLuint texture_id;
     GLuint sampler_id;
-    glGenTextures(1, &texture_id);
+    glGenTextures(1, &g_TextureArrayID);
     glGenSamplers(1, &sampler_id);
 
     // Veja slides 95-96 do documento Aula_20_Mapeamento_de_Texturas.pdf
@@ -370,51 +1013,180 @@ void LoadTextureImage(const char* filename)
     glSamplerParameteri(sampler_id, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
     glSamplerParameteri(sampler_id, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-    // Agora enviamos a imagem lida do disco para a GPU
-    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
-    glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
-    glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
+    glActiveTexture(GL_TEXTURE0 + DIFFUSE_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, g_TextureArrayID);
 
-    GLuint textureunit = g_NumLoadedTextures;
-    glActiveTexture(GL_TEXTURE0 + textureunit);
-    glBindTexture(GL_TEXTURE_2D, texture_id);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_SRGB8, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-    glGenerateMipmap(GL_TEXTURE_2D);
-    glBindSampler(textureunit, sampler_id);
+    // Alocamos todos os níveis de todas as camadas, sem conteúdo
+    const TextureFormat format = g_TextureFormat;
+    const int num_levels = TextureMipLevels(TEXTURE_LAYER_SIZE);
+    size_t total_bytes = 0;
+    for (int level = 0; level < num_levels; ++level)
+    {
+        int size = std::max(1, TEXTURE_LAYER_SIZE >> level);
+        size_t level_bytes = TextureLevelBytes(format, size) * g_NumLoadedTextures;
 
-    stbi_image_free(data);
+        if ( format == TEXTURE_FORMAT_BC1 )
+            glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, level, GL_COMPRESSED_SRGB_S3TC_DXT1_EXT, size, size,
+                                   (GLsizei)g_NumLoadedTextures, 0, (GLsizei)level_bytes, NULL);
+        else
+            glTexImage3D(GL_TEXTURE_2D_ARRAY, level, GL_SRGB8, size, size,
+                         (GLsizei)g_NumLoadedTextures, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
 
-    g_NumLoadedTextures += 1;
+        total_bytes += level_bytes;
+    }
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, num_levels - 1);
+    glBindSampler(DIFFUSE_TEXTURE_UNIT, sampler_id);
+
+    // Placeholder: todos os pixels de todos os níveis são cinza. Em BC1
+    // todos os blocos 4x4 são iguais, então basta codificar um.
+    std::vector<unsigned char> placeholder(TextureMipChainBytes(format, TEXTURE_LAYER_SIZE), 128);
+    if ( format == TEXTURE_FORMAT_BC1 )
+    {
+        unsigned char gray_pixels[4 * 4 * 3];
+        unsigned char gray_block[8];
+        std::memset(gray_pixels, 128, sizeof(gray_pixels));
+        EncodeBC1(gray_pixels, 4, 4, gray_block);
+        for (size_t i = 0; i < placeholder.size(); i += sizeof(gray_block))
+            std::memcpy(&placeholder[i], gray_block, sizeof(gray_block));
+    }
+    for (GLuint layer = 0; layer < g_NumLoadedTextures; ++layer)
+        UploadTextureLayer((GLint)layer, placeholder.data());
+
+    printf("[TEXTURE] %u camadas de %dx%d (%d niveis, %s, %.1f MB) em uma GL_TEXTURE_2D_ARRAY\n",
+           g_NumLoadedTextures, TEXTURE_LAYER_SIZE, TEXTURE_LAYER_SIZE, num_levels,
+           format == TEXTURE_FORMAT_BC1 ? "BC1" : "RGB8", total_bytes / (1024.0f * 1024.0f));
+
+#ifdef DISABLE_ASSET_STREAMING
+    for (GLuint layer = 0; layer < g_NumLoadedTextures; ++layer)
+        RequestTextureLayer((GLint)layer);
+    WaitForWorkerJobs();
+#endif
+}
+
+// Pede a leitura de uma camada registrada por LoadTextureImage(), se ainda
+// não foi pedida. A imagem é decodificada por uma thread de trabalho (veja
+// "worker_pool.h"), usando o cache de texturas sempre que possível (veja
+// "texture_cache.h"), e enviada para a GPU por UploadStreamedAssets().
+void RequestTextureLayer(GLint layer)
+{
+    if ( layer < 0 || layer >= (GLint)g_TextureLayerRequested.size() || g_TextureLayerRequested[layer] )
+        return;
+    g_TextureLayerRequested[layer] = true;
+
+    std::string path = g_TextureLayerFiles[layer];
+    TextureFormat format = g_TextureFormat;
+    SubmitWorkerJob([path, layer, format]() { DecodeTextureLayer(path, layer, format); });
+}
+
+
+// Busca o handle de um objeto de g_VirtualScene pelo nome. Deve ser usada
+// somente no carregamento; os desenhos recebem o handle já resolvido.
+MeshHandle FindMeshHandle(const char* object_name)
+{
+    std::map<std::string, MeshHandle>::const_iterator it = g_MeshHandlesByName.find(object_name);
+    if (it == g_MeshHandlesByName.end())
+    {
+        fprintf(stderr, "WARNING: Objeto \"%s\" nao existe em g_VirtualScene.\n", object_name);
+        return INVALID_MESH_HANDLE;
+    }
+    return it->second;
+}
+
+// Resolve uma única vez os nomes de todos os objetos desenhados pelo jogo.
+void ResolveGameMeshHandles()
+{
+    g_Meshes.plane         = FindMeshHandle("the_plane");
+    g_Meshes.chicken_tower = FindMeshHandle("chicken_VRay");
+    g_Meshes.thompson_gun  = FindMeshHandle("gun_M1A1");
+    g_Meshes.beagle_tower  = FindMeshHandle("beagle");
+    g_Meshes.ak47          = FindMeshHandle("gun_AK47");
+    g_Meshes.chicken_coop  = FindMeshHandle("ChickenCoop");
+    g_Meshes.egg           = FindMeshHandle("Uncracked_Egg");
+
+    for (int type = 0; type < ENEMY_TYPE_COUNT; type++)
+        g_Meshes.enemies[type] = FindMeshHandle(GetEnemyRenderInfo((EnemyType)type).meshName);
 }
 
+// Define a câmera usada por SelectMeshLOD() no quadro atual
+void SetLODCamera(const glm::mat4& view, const glm::mat4& projection, float viewport_height)
+{
+    g_LODView = view;
+    g_LODProjection = projection;
+    g_LODViewportHeight = viewport_height;
+}
+
+// Escolhe o nível de detalhe de um objeto desenhado com a matriz "model".
+// O erro geométrico de cada LOD é projetado na tela à distância do ponto
+// mais próximo da esfera envolvente do objeto; escolhemos o LOD mais simples
+// cujo erro projetado não passa de kLODMaxPixelError pixels. Objetos que
+// ocupam pouco espaço na tela usam, portanto, as malhas mais simples.
+int SelectMeshLOD(MeshHandle mesh, const glm::mat4& model)
+{
+    if ( mesh < 0 || mesh >= (MeshHandle)g_VirtualScene.size() || g_LODViewportHeight <= 0.0f )
+        return 0;
+
+    const SceneObject& object = g_VirtualScene[mesh];
+    if ( object.num_lods <= 1 )
+        return 0;
+
+    // Maior fator de escala da matriz "model"
+    float scale = std::max(glm::length(glm::vec3(model[0])),
+                  std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+
+    glm::vec4 center = glm::vec4(0.5f * (object.bbox_min + object.bbox_max), 1.0f);
+    glm::vec4 center_view = g_LODView * model * center;
+    float radius = 0.5f * glm::length(object.bbox_max - object.bbox_min) * scale;
+
+    // A câmera olha para -z; objetos que contêm a câmera usam o LOD 0
+    float distance = -center_view.z - radius;
+    if ( distance <= 0.0f )
+        return 0;
+
+    // Pixels ocupados por uma unidade de comprimento a essa distância
+    float pixels_per_unit = std::fabs(g_LODProjection[1][1]) * 0.5f * g_LODViewportHeight / distance;
+
+    int lod = 0;
+    for (int i = 1; i < object.num_lods; ++i)
+        if ( object.lods[i].error * scale * pixels_per_unit <= kLODMaxPixelError )
+            lod = i;
+    return lod;
+}
 
 // Função que desenha um objeto armazenado em g_VirtualScene. Veja definição
-// dos objetos na função BuildTrianglesAndAddToVirtualScene().
-void DrawVirtualObject(const char* object_name)
+// dos objetos na função BuildTrianglesAndAddToVirtualScene(). O parâmetro
+// "lod" escolhe o nível de detalhe (veja SelectMeshLOD()).
+void DrawVirtualObject(MeshHandle mesh, int lod)
 {
+    // Objetos que não foram carregados são ignorados
+    if ( mesh < 0 || mesh >= (MeshHandle)g_VirtualScene.size() )
+        return;
+    RequestMesh(mesh);
+
+    const SceneObject& object = g_VirtualScene[mesh];
+    const MeshLOD& range = object.lods[std::max(0, std::min(lod, object.num_lods - 1))];
+
     // "Ligamos" o VAO. Informamos que queremos utilizar os atributos de
     // vértices apontados pelo VAO criado pela função BuildTrianglesAndAddToVirtualScene(). Veja
     // comentários detalhados dentro da definição de BuildTrianglesAndAddToVirtualScene().
-    glBindVertexArray(g_VirtualScene[object_name].vertex_array_object_id);
+    glBindVertexArray(object.vertex_array_object_id);
 
     // Setamos as variáveis "bbox_min" e "bbox_max" do fragment shader
     // com os parâmetros da axis-aligned bounding box (AABB) do modelo.
-    glm::vec3 bbox_min = g_VirtualScene[object_name].bbox_min;
-    glm::vec3 bbox_max = g_VirtualScene[object_name].bbox_max;
-    glUniform4f(g_bbox_min_uniform, bbox_min.x, bbox_min.y, bbox_min.z, 1.0f);
-    glUniform4f(g_bbox_max_uniform, bbox_max.x, bbox_max.y, bbox_max.z, 1.0f);
+    glUniform4f(g_bbox_min_uniform, object.bbox_min.x, object.bbox_min.y, object.bbox_min.z, 1.0f);
+    glUniform4f(g_bbox_max_uniform, object.bbox_max.x, object.bbox_max.y, object.bbox_max.z, 1.0f);
 
     // Pedimos para a GPU rasterizar os vértices dos eixos XYZ
     // apontados pelo VAO como linhas. Veja a definição de
     // g_VirtualScene[""] dentro da função BuildTrianglesAndAddToVirtualScene(), e veja
     // a documentação da função glDrawElements() em
     // http://docs.gl/gl3/glDrawElements.
-    glDrawElements(
-        g_VirtualScene[object_name].rendering_mode,
-        g_VirtualScene[object_name].num_indices,
-        GL_UNSIGNED_INT,
-        (void*)(g_VirtualScene[object_name].first_index * sizeof(GLuint))
+    glDrawElementsBaseVertex(
+        object.rendering_mode,
+        range.num_indices,
+        object.index_type,
+        (void*)(range.first_index * IndexSize(object.index_type)),
+        object.base_vertex
     );
 
     // "Desligamos" o VAO, evitando assim que operações posteriores venham a
@@ -422,61 +1194,81 @@ void DrawVirtualObject(const char* object_name)
     glBindVertexArray(0);
 }
 
+#ifndef NDEBUG
+// Versão de DrawVirtualObject() que busca o objeto pelo nome a cada chamada.
+// Útil para testes rápidos; o código do jogo deve usar handles.
+void DrawVirtualObject(const char* object_name)
+{
+    DrawVirtualObject(FindMeshHandle(object_name));
+}
+#endif
+
 // Carrega um Vertex Shader de um arquivo GLSL. Veja definição de LoadShader() abaixo.
-GLuint LoadShader_Vertex(const char* filename)
+GLuint LoadShader_Vertex(const char* filename, const char* defines)
 {
     // Criamos um identificador (ID) para este shader, informando que o mesmo
     // será aplicado nos vértices.
     GLuint vertex_shader_id = glCreateShader(GL_VERTEX_SHADER);
 
     // Carregamos e compilamos o shader
-    LoadShader(filename, vertex_shader_id);
+    LoadShader(filename, vertex_shader_id, defines);
 
     // Retorna o ID gerado acima
     return vertex_shader_id;
 }
 
 // Carrega um Fragment Shader de um arquivo GLSL . Veja definição de LoadShader() abaixo.
-GLuint LoadShader_Fragment(const char* filename)
+GLuint LoadShader_Fragment(const char* filename, const char* defines)
 {
     // Criamos um identificador (ID) para este shader, informando que o mesmo
     // será aplicado nos fragmentos.
     GLuint fragment_shader_id = glCreateShader(GL_FRAGMENT_SHADER);
 
     // Carregamos e compilamos o shader
-    LoadShader(filename, fragment_shader_id);
+    LoadShader(filename, fragment_shader_id, defines);
 
     // Retorna o ID gerado acima
     return fragment_shader_id;
 }
 
 // Função auxilar, utilizada pelas duas funções acima. Carrega código de GPU de
-// um arquivo GLSL e faz sua compilação.
-void LoadShader(const char* filename, GLuint shader_id)
+// um arquivo GLSL e faz sua compilação. Se "defines" não é nulo, o texto é
+// inserido logo após a primeira linha do arquivo (a diretiva "#version").
+void LoadShader(const char* filename, GLuint shader_id, const char* defines)
 {
-    // Lemos o arquivo de texto indicado pela variável "filename"
-    // e colocamos seu conteúdo em memória, apontado pela variável
-    // "shader_string".
-    std::ifstream file;
-    try {
-        file.exceptions(std::ifstream::failbit);
-        file.open(filename);
-    } catch ( std::exception& e ) {
+    CompileShaderSource(filename, ReadShaderSource(filename, defines), shader_id);
+}
+
+// Lê o código de um shader GLSL, inserindo "defines" como em LoadShader()
+std::string ReadShaderSource(const char* filename, const char* defines)
+{
+    // Lemos o recurso indicado pela variável "filename" (veja
+    // "asset_archive.h") e colocamos seu conteúdo em memória
+    AssetView file;
+    if ( !OpenAsset(filename, &file) )
+    {
         fprintf(stderr, "ERROR: Cannot open file \"%s\".\n", filename);
         std::exit(EXIT_FAILURE);
     }
-    std::stringstream shader;
-    shader << file.rdbuf();
-    std::string str = shader.str();
-    const GLchar* shader_string = str.c_str();
-    const GLint   shader_string_length = static_cast<GLint>( str.length() );
+    std::string str(reinterpret_cast<const char*>(file.data), file.size);
+    ReleaseAsset(&file);
 
-    // Define o código do shader GLSL, contido na string "shader_string"
-    glShaderSource(shader_id, 1, &shader_string, &shader_string_length);
+    if ( defines != NULL && defines[0] != '\0' )
+    {
+        // "#line 2" mantém os números de linha das mensagens de erro iguais
+        // aos do arquivo
+        size_t insert_at = str.find('\n');
+        insert_at = (insert_at == std::string::npos) ? str.length() : insert_at + 1;
+        str.insert(insert_at, std::string(defines) + "#line 2\n");
+    }
 
-    // Compila o código do shader GLSL (em tempo de execução)
-    glCompileShader(shader_id);
+    return str;
+}
 
+// Imprime no terminal erros e "warnings" da compilação do shader
+// "shader_id". Espera a compilação terminar.
+static void CheckShaderCompilation(const char* label, GLuint shader_id)
+{
     // Verificamos se ocorreu algum erro ou "warning" durante a compilação
     GLint compiled_ok;
     glGetShaderiv(shader_id, GL_COMPILE_STATUS, &compiled_ok);
@@ -497,7 +1289,7 @@ void LoadShader(const char* filename, GLuint shader_id)
         if ( !compiled_ok )
         {
             output += "ERROR: OpenGL compilation of \"";
-            output += filename;
+            output += label;
             output += "\" failed.\n";
             output += "== Start of compilation log\n";
             output += log;
@@ -506,7 +1298,7 @@ void LoadShader(const char* filename, GLuint shader_id)
         else
         {
             output += "WARNING: OpenGL compilation of \"";
-            output += filename;
+            output += label;
             output += "\".\n";
             output += "== Start of compilation log\n";
             output += log;
@@ -520,21 +1312,27 @@ void LoadShader(const char* filename, GLuint shader_id)
     delete [] log;
 }
 
-// Esta função cria um programa de GPU, o qual contém obrigatoriamente um
-// Vertex Shader e um Fragment Shader.
-GLuint CreateGpuProgram(GLuint vertex_shader_id, GLuint fragment_shader_id)
+// Compila o código "source" no shader "shader_id". "label" identifica o
+// shader nas mensagens de erro.
+void CompileShaderSource(const char* label, const std::string& source, GLuint shader_id)
 {
-    // Criamos um identificador (ID) para este programa de GPU
-    GLuint program_id = glCreateProgram();
+    const GLchar* shader_string = source.c_str();
+    const GLint   shader_string_length = static_cast<GLint>( source.length() );
 
-    // Definição dos dois shaders GLSL que devem ser executados pelo programa
-    glAttachShader(program_id, vertex_shader_id);
-    glAttachShader(program_id, fragment_shader_id);
+    // Define o código do shader GLSL, contido na string "shader_string"
+    glShaderSource(shader_id, 1, &shader_string, &shader_string_length);
 
-    // Linkagem dos shaders acima ao programa
-    glLinkProgram(program_id);
+    // Compila o código do shader GLSL (em tempo de execução)
+    glCompileShader(shader_id);
 
-    // Verificamos se ocorreu algum erro durante a linkagem
+    // Verificamos se ocorreu algum erro ou "warning" durante a compilação
+    CheckShaderCompilation(label, shader_id);
+}
+
+// Imprime no terminal qualquer erro da linkagem do programa "program_id".
+// Espera a linkagem terminar. Retorna false se a linkagem falhou.
+static bool CheckProgramLinking(GLuint program_id)
+{
     GLint linked_ok = GL_FALSE;
     glGetProgramiv(program_id, GL_LINK_STATUS, &linked_ok);
 
@@ -563,6 +1361,30 @@ GLuint CreateGpuProgram(GLuint vertex_shader_id, GLuint fragment_shader_id)
         fprintf(stderr, "%s", output.c_str());
     }
 
+    return linked_ok != GL_FALSE;
+}
+
+// Esta função cria um programa de GPU, o qual contém obrigatoriamente um
+// Vertex Shader e um Fragment Shader.
+GLuint CreateGpuProgram(GLuint vertex_shader_id, GLuint fragment_shader_id)
+{
+    // Criamos um identificador (ID) para este programa de GPU
+    GLuint program_id = glCreateProgram();
+
+    // Permite ler o binário do programa depois da linkagem (veja
+    // "program_cache.h")
+    PrepareProgramForCache(program_id);
+
+    // Definição dos dois shaders GLSL que devem ser executados pelo programa
+    glAttachShader(program_id, vertex_shader_id);
+    glAttachShader(program_id, fragment_shader_id);
+
+    // Linkagem dos shaders acima ao programa
+    glLinkProgram(program_id);
+
+    // Verificamos se ocorreu algum erro durante a linkagem
+    CheckProgramLinking(program_id);
+
     // Os "Shader Objects" podem ser marcados para deleção após serem linkados 
     glDeleteShader(vertex_shader_id);
     glDeleteShader(fragment_shader_id);
@@ -571,59 +1393,505 @@ GLuint CreateGpuProgram(GLuint vertex_shader_id, GLuint fragment_shader_id)
     return program_id;
 }
 
-void LoadSingleModel(const char* filepath, const char* name) {
-    printf("  -> %s", name);
-    fflush(stdout);
-    
+// Cria um programa de GPU a partir dos códigos dos dois shaders, usando o
+// cache de binários "name" (veja "program_cache.h") quando ele é válido
+GLuint CreateGpuProgramFromSource(const char* name, const std::string& vertex_source,
+                                  const std::string& fragment_source)
+{
+    ProgramCacheKey key;
+    GLuint program_id = LoadProgramCache(name, vertex_source, fragment_source, &key);
+    if ( program_id != 0 )
+        return program_id;
+
+    std::string vertex_label = std::string(name) + " (vertex)";
+    std::string fragment_label = std::string(name) + " (fragment)";
+
+    GLuint vertex_shader_id = glCreateShader(GL_VERTEX_SHADER);
+    CompileShaderSource(vertex_label.c_str(), vertex_source, vertex_shader_id);
+
+    GLuint fragment_shader_id = glCreateShader(GL_FRAGMENT_SHADER);
+    CompileShaderSource(fragment_label.c_str(), fragment_source, fragment_shader_id);
+
+    program_id = CreateGpuProgram(vertex_shader_id, fragment_shader_id);
+    WriteProgramCache(name, key, program_id);
+    return program_id;
+}
+
+// Constantes e função de GL_KHR_parallel_shader_compile (e da extensão ARB
+// equivalente), que não fazem parte do carregador GLAD gerado
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+typedef void (APIENTRYP MaxShaderCompilerThreadsProc)(GLuint count);
+
+// Programa de GPU cuja compilação e linkagem foram enviadas ao driver mas
+// ainda não foram verificadas (veja CreateGpuProgramAsync())
+struct PendingGpuProgram
+{
+    std::string     name;
+    ProgramCacheKey key;
+    GLuint          program_id;
+    GLuint          vertex_shader_id;
+    GLuint          fragment_shader_id;
+};
+
+static std::vector<PendingGpuProgram> g_PendingGpuPrograms;
+
+// Programas verificados cuja compilação ou linkagem falhou
+static std::vector<GLuint> g_FailedGpuPrograms;
+static bool g_ParallelShaderCompileChecked = false;
+static bool g_ParallelShaderCompile = false;
+
+// Habilita a compilação em paralelo pelo driver, se disponível. Com ela,
+// GL_COMPLETION_STATUS_KHR diz se um programa terminou sem bloquear.
+static bool ParallelShaderCompileSupported()
+{
+    if ( !g_ParallelShaderCompileChecked )
+    {
+        g_ParallelShaderCompileChecked = true;
+
+        MaxShaderCompilerThreadsProc max_threads = NULL;
+        if ( glfwExtensionSupported("GL_KHR_parallel_shader_compile") )
+            max_threads = (MaxShaderCompilerThreadsProc)glfwGetProcAddress("glMaxShaderCompilerThreadsKHR");
+        else if ( glfwExtensionSupported("GL_ARB_parallel_shader_compile") )
+            max_threads = (MaxShaderCompilerThreadsProc)glfwGetProcAddress("glMaxShaderCompilerThreadsARB");
+
+        // 0xFFFFFFFF deixa o número de threads a critério do driver
+        if ( max_threads != NULL )
+        {
+            max_threads(0xFFFFFFFF);
+            g_ParallelShaderCompile = true;
+        }
+
+        printf("[SHADER] Compilacao paralela %s\n", g_ParallelShaderCompile ? "disponivel" : "indisponivel");
+    }
+    return g_ParallelShaderCompile;
+}
+
+// Verifica a compilação e a linkagem de um programa que já terminou (ou que
+// vai terminar, se o driver não informa o andamento) e libera os shaders.
+// Programas linkados com sucesso vão para o cache de binários; os demais,
+// para g_FailedGpuPrograms.
+static void FinishPendingGpuProgram(PendingGpuProgram& pending)
+{
+    std::string vertex_label = pending.name + " (vertex)";
+    std::string fragment_label = pending.name + " (fragment)";
+    CheckShaderCompilation(vertex_label.c_str(), pending.vertex_shader_id);
+    CheckShaderCompilation(fragment_label.c_str(), pending.fragment_shader_id);
+    bool linked = CheckProgramLinking(pending.program_id);
+
+    glDeleteShader(pending.vertex_shader_id);
+    glDeleteShader(pending.fragment_shader_id);
+
+    if ( linked )
+        WriteProgramCache(pending.name.c_str(), pending.key, pending.program_id);
+    else
+        g_FailedGpuPrograms.push_back(pending.program_id);
+}
+
+GLuint CreateGpuProgramAsync(const char* name, const std::string& vertex_source,
+                             const std::string& fragment_source)
+{
+    ProgramCacheKey key;
+    GLuint program_id = LoadProgramCache(name, vertex_source, fragment_source, &key);
+    if ( program_id != 0 )
+        return program_id;
+
+    // Deve ser chamada antes da primeira compilação, para que o driver já
+    // use as suas threads
+    ParallelShaderCompileSupported();
+
+    PendingGpuProgram pending;
+    pending.name = name;
+    pending.key = key;
+
+    const GLchar* vertex_string = vertex_source.c_str();
+    const GLint   vertex_string_length = static_cast<GLint>( vertex_source.length() );
+    pending.vertex_shader_id = glCreateShader(GL_VERTEX_SHADER);
+    glShaderSource(pending.vertex_shader_id, 1, &vertex_string, &vertex_string_length);
+    glCompileShader(pending.vertex_shader_id);
+
+    const GLchar* fragment_string = fragment_source.c_str();
+    const GLint   fragment_string_length = static_cast<GLint>( fragment_source.length() );
+    pending.fragment_shader_id = glCreateShader(GL_FRAGMENT_SHADER);
+    glShaderSource(pending.fragment_shader_id, 1, &fragment_string, &fragment_string_length);
+    glCompileShader(pending.fragment_shader_id);
+
+    // A linkagem pode ser pedida antes de a compilação terminar: o driver
+    // espera os shaders por conta própria. Nenhum estado é consultado aqui.
+    pending.program_id = glCreateProgram();
+    PrepareProgramForCache(pending.program_id);
+    glAttachShader(pending.program_id, pending.vertex_shader_id);
+    glAttachShader(pending.program_id, pending.fragment_shader_id);
+    glLinkProgram(pending.program_id);
+
+    g_PendingGpuPrograms.push_back(pending);
+    return pending.program_id;
+}
+
+void UpdatePendingGpuPrograms()
+{
+    if ( g_PendingGpuPrograms.empty() )
+        return;
+
+    // Sem GL_COMPLETION_STATUS_KHR não há como saber se um programa terminou
+    // sem esperar por ele: verificamos somente o mais antigo a cada quadro,
+    // para distribuir as esperas
+    if ( !ParallelShaderCompileSupported() )
+    {
+        FinishPendingGpuProgram(g_PendingGpuPrograms.front());
+        g_PendingGpuPrograms.erase(g_PendingGpuPrograms.begin());
+        return;
+    }
+
+    size_t kept = 0;
+    for (size_t i = 0; i < g_PendingGpuPrograms.size(); ++i)
+    {
+        PendingGpuProgram& pending = g_PendingGpuPrograms[i];
+
+        GLint completed = GL_FALSE;
+        glGetProgramiv(pending.program_id, GL_COMPLETION_STATUS_KHR, &completed);
+        if ( completed == GL_FALSE )
+        {
+            g_PendingGpuPrograms[kept++] = pending;
+            continue;
+        }
+
+        FinishPendingGpuProgram(pending);
+    }
+    g_PendingGpuPrograms.resize(kept);
+}
+
+GpuProgramStatus GetGpuProgramStatus(GLuint program_id)
+{
+    for (size_t i = 0; i < g_PendingGpuPrograms.size(); ++i)
+    {
+        if ( g_PendingGpuPrograms[i].program_id == program_id )
+            return GPU_PROGRAM_PENDING;
+    }
+    if ( std::find(g_FailedGpuPrograms.begin(), g_FailedGpuPrograms.end(), program_id) != g_FailedGpuPrograms.end() )
+        return GPU_PROGRAM_FAILED;
+    return GPU_PROGRAM_READY;
+}
+
+void DeleteGpuProgram(GLuint program_id)
+{
+    for (size_t i = 0; i < g_PendingGpuPrograms.size(); ++i)
+    {
+        if ( g_PendingGpuPrograms[i].program_id == program_id )
+        {
+            glDeleteShader(g_PendingGpuPrograms[i].vertex_shader_id);
+            glDeleteShader(g_PendingGpuPrograms[i].fragment_shader_id);
+            g_PendingGpuPrograms.erase(g_PendingGpuPrograms.begin() + i);
+            break;
+        }
+    }
+    g_FailedGpuPrograms.erase(std::remove(g_FailedGpuPrograms.begin(), g_FailedGpuPrograms.end(), program_id),
+                              g_FailedGpuPrograms.end());
+    glDeleteProgram(program_id);
+}
+
+// Malhas mantidas na CPU depois do envio para a GPU, por nome do modelo
+// (somente modelos carregados com MODEL_KEEP_CPU_MESH)
+static std::map<std::string, MeshData> g_ResidentMeshes;
+
+// Modelo carregado na CPU por uma thread de trabalho, aguardando o envio
+// para a GPU pela thread principal
+struct ModelLoadJob {
+    std::string   filepath;
+    std::string   name;
+    int           flags;
+    bool          failed;
+    bool          from_cache;
+    MeshCacheView cache;  // Se from_cache
+    MeshData      mesh;   // Caso contrário
+};
+
+// Parte de CPU do carregamento: usa o cache binário se estiver válido, ou lê
+// e processa o OBJ (e grava o cache). Executada por uma thread de trabalho.
+static void LoadModelOnWorker(ModelLoadJob& job) {
+    job.failed = false;
+    job.from_cache = false;
+
     try {
-        ObjModel* model = new ObjModel(filepath);
-        ComputeNormals(model);
-        BuildTrianglesAndAddToVirtualScene(model);
-        printf(" OK\n");
-        g_ModelsLoaded++;
+        MeshCacheKey key;
+        if (ReadMeshCache(job.filepath.c_str(), &key, &job.cache)) {
+            job.from_cache = true;
+            return;
+        }
+
+        {
+            // Os dados da tinyobjloader são liberados assim que a malha
+            // compacta está pronta
+            ObjModel model(job.filepath.c_str());
+            ComputeNormals(&model);
+            BuildMeshData(&model, &job.mesh);
+        }
+        WriteMeshCache(job.filepath.c_str(), key, job.mesh);
     } catch (...) {
-        printf(" ERRO (arquivo nao encontrado)\n");
+        job.failed = true;
+    }
+}
+
+// Copia uma malha do cache mapeado para a CPU (para MODEL_KEEP_CPU_MESH)
+static void CopyMeshCacheToMeshData(const MeshCacheView& cache, MeshData* mesh) {
+    mesh->objects = cache.objects;
+    mesh->vertices.assign(cache.vertices, cache.vertices + cache.num_vertices);
+    if (cache.index_type == GL_UNSIGNED_SHORT) {
+        const GLushort* indices = static_cast<const GLushort*>(cache.indices);
+        mesh->indices.assign(indices, indices + cache.num_indices);
+    } else {
+        const GLuint* indices = static_cast<const GLuint*>(cache.indices);
+        mesh->indices.assign(indices, indices + cache.num_indices);
+    }
+}
+
+// Parte de GPU do carregamento, na thread principal. Depois do envio a
+// malha na CPU é liberada, a menos que o modelo peça MODEL_KEEP_CPU_MESH.
+static void UploadLoadedModel(ModelLoadJob& job) {
+    if (job.failed) {
+        printf("  -> %s ERRO (arquivo nao encontrado)\n", job.name.c_str());
         g_ModelsFailed++;
+        return;
+    }
+
+    if (job.from_cache) {
+        AddMeshToVirtualScene(job.cache.objects, job.cache.vertices, job.cache.num_vertices,
+                              job.cache.indices, job.cache.num_indices, job.cache.index_type);
+        if (job.flags & MODEL_KEEP_CPU_MESH)
+            CopyMeshCacheToMeshData(job.cache, &job.mesh);
+        ReleaseMeshCache(&job.cache);
+    } else {
+        AddMeshDataToVirtualScene(job.mesh);
+    }
+
+    // clear() manteria a capacidade dos vetores: movemos a malha para fora
+    // do job (liberando-a, ou guardando-a para FindResidentMesh())
+    if (job.flags & MODEL_KEEP_CPU_MESH)
+        g_ResidentMeshes[job.name] = std::move(job.mesh);
+    else
+        job.mesh = MeshData();
+
+    printf("  -> %s OK\n", job.name.c_str());
+    g_ModelsLoaded++;
+}
+
+// Enfileira o carregamento de um modelo. A leitura e o processamento são
+// feitos por uma thread de trabalho; o envio para a GPU acontece dentro de
+// WaitForWorkerJobs() ou UploadStreamedAssets(), na ordem em que os modelos
+// ficam prontos.
+void LoadSingleModel(const char* filepath, const char* name, int flags) {
+    std::shared_ptr<ModelLoadJob> job(new ModelLoadJob());
+    job->filepath = filepath;
+    job->name = name;
+    job->flags = flags;
+
+    SubmitWorkerJob([job]() {
+        LoadModelOnWorker(*job);
+        PostMainThreadTask([job]() { UploadLoadedModel(*job); });
+    });
+}
+
+// Malha na CPU de um modelo carregado com MODEL_KEEP_CPU_MESH, ou NULL
+const MeshData* FindResidentMesh(const char* name) {
+    std::map<std::string, MeshData>::const_iterator it = g_ResidentMeshes.find(name);
+    return it != g_ResidentMeshes.end() ? &it->second : NULL;
+}
+
+// Modelo do jogo carregado sob demanda (veja RegisterStreamedModel())
+struct StreamedModel {
+    std::string filepath;
+    std::string name;
+    int         flags;
+    bool        requested;
+};
+
+static std::vector<StreamedModel> g_StreamedModels;
+
+// Índice em g_StreamedModels do modelo de cada objeto de g_VirtualScene que
+// ainda pode ser um placeholder (-1 para os demais)
+static std::vector<int> g_StreamedModelOfMesh;
+
+// Modelos sob demanda já pedidos, e quantos deles já tinham terminado no
+// último relatório de memória (veja UploadStreamedAssets()). Os modelos
+// terminados são contados por g_ModelsLoaded e g_ModelsFailed, a partir de
+// g_ModelsDoneBeforeStreaming.
+static int g_StreamedModelsRequested = 0;
+static int g_StreamedModelsReported = 0;
+static int g_ModelsDoneBeforeStreaming = 0;
+
+// Esfera desenhada no lugar dos modelos que ainda não foram carregados
+// (mantida na CPU para gerar as cópias de cada objeto)
+static const MeshData* g_PlaceholderSphere = NULL;
+
+// Envia para a GPU uma cópia da esfera com o nome "name", esticada até a
+// caixa envolvente de "bounds" (ou sem escala, se "bounds" é NULL)
+static MeshHandle AddPlaceholderObject(const std::string& name, const SceneObject* bounds) {
+    MeshData placeholder = *g_PlaceholderSphere;
+    placeholder.objects.resize(1);
+
+    SceneObject& sphere = placeholder.objects[0];
+    if (bounds != NULL) {
+        glm::vec3 sphere_size = sphere.bbox_max - sphere.bbox_min;
+        glm::vec3 scale = (bounds->bbox_max - bounds->bbox_min) / sphere_size;
+        for (size_t i = 0; i < placeholder.vertices.size(); ++i) {
+            float* position = placeholder.vertices[i].position;
+            for (int axis = 0; axis < 3; ++axis)
+                position[axis] = bounds->bbox_min[axis] + (position[axis] - sphere.bbox_min[axis]) * scale[axis];
+        }
+
+        // O erro dos LODs cresce com a maior das escalas
+        float max_scale = std::max(scale.x, std::max(scale.y, scale.z));
+        for (int lod = 0; lod < sphere.num_lods; ++lod)
+            sphere.lods[lod].error *= max_scale;
+
+        sphere.bbox_min = bounds->bbox_min;
+        sphere.bbox_max = bounds->bbox_max;
+    }
+
+    sphere.name = name;
+    AddMeshDataToVirtualScene(placeholder);
+    return g_MeshHandlesByName[name];
+}
+
+// Registra um modelo que só é lido na primeira vez que um dos seus objetos
+// é desenhado. Cada objeto de "object_names" recebe desde já o seu handle,
+// apontando para uma cópia da esfera com a caixa envolvente do cache de
+// malha, se existe; quando o modelo fica pronto, AddMeshToVirtualScene()
+// substitui a cópia mantendo o handle. Sem a esfera, o modelo é carregado
+// imediatamente.
+void RegisterStreamedModel(const char* filepath, const char* name,
+                           const std::vector<std::string>& object_names, int flags) {
+    if (g_PlaceholderSphere == NULL) {
+        LoadSingleModel(filepath, name, flags);
+        return;
+    }
+
+    StreamedModel model;
+    model.filepath = filepath;
+    model.name = name;
+    model.flags = flags;
+    model.requested = false;
+    g_StreamedModels.push_back(model);
+
+    std::vector<SceneObject> cached_objects;
+    if (!ReadMeshCacheObjects(filepath, &cached_objects))
+        printf("[STREAM] Sem cache de malha para \"%s\": placeholder sem escala\n", name);
+
+    for (size_t i = 0; i < object_names.size(); ++i) {
+        const SceneObject* bounds = NULL;
+        for (size_t j = 0; j < cached_objects.size(); ++j) {
+            if (cached_objects[j].name == object_names[i]) {
+                bounds = &cached_objects[j];
+                break;
+            }
+        }
+
+        MeshHandle handle = AddPlaceholderObject(object_names[i], bounds);
+
+        g_StreamedModelOfMesh.resize(g_VirtualScene.size(), -1);
+        g_StreamedModelOfMesh[handle] = (int)g_StreamedModels.size() - 1;
+    }
+}
+
+// Pede a leitura do modelo de "mesh", se ele é um placeholder e a leitura
+// ainda não foi pedida
+void RequestMesh(MeshHandle mesh) {
+    if (mesh < 0 || mesh >= (MeshHandle)g_StreamedModelOfMesh.size())
+        return;
+
+    int index = g_StreamedModelOfMesh[mesh];
+    if (index < 0 || g_StreamedModels[index].requested)
+        return;
+
+    StreamedModel& model = g_StreamedModels[index];
+    model.requested = true;
+    g_StreamedModelsRequested++;
+    printf("[STREAM] Carregando \"%s\" sob demanda\n", model.name.c_str());
+    LoadSingleModel(model.filepath.c_str(), model.name.c_str(), model.flags);
+}
+
+void UploadStreamedAssets() {
+    RunMainThreadTasks();
+
+    // O RSS informado antes do primeiro quadro não inclui os modelos sob
+    // demanda: informamos de novo sempre que os pedidos feitos até agora
+    // terminam
+    int done = g_ModelsLoaded + g_ModelsFailed - g_ModelsDoneBeforeStreaming;
+    if (done == g_StreamedModelsRequested && done > g_StreamedModelsReported) {
+        g_StreamedModelsReported = done;
+
+        char label[96];
+        snprintf(label, sizeof(label), "Depois do carregamento sob demanda (%d/%d modelos)",
+                 done, (int)g_StreamedModels.size());
+        PrintProcessMemoryUsage(label);
     }
 }
 
-void LoadAllGameModels(std::map<std::string, SceneObject>& scene) {
+void LoadAllGameModels() {
     printf("\n=======================================================\n");
     printf("     CARREGANDO MODELOS DO TOWER DEFENSE\n");
     printf("=======================================================\n");
-    
+
+    // Somente a esfera é carregada agora: ela é desenhada no lugar dos
+    // demais modelos até que eles sejam lidos, na primeira vez que aparecem
+    LoadSingleModel("data/models/sphere.obj", "sphere", MODEL_KEEP_CPU_MESH);
+    WaitForWorkerJobs();
+    g_ModelsDoneBeforeStreaming = g_ModelsLoaded + g_ModelsFailed;
+    const MeshData* sphere = FindResidentMesh("sphere");
+    if (sphere != NULL && !sphere->objects.empty())
+        g_PlaceholderSphere = sphere;
+
     // ===== TORRES =====
-    printf("\n[TORRES]\n");
-    LoadSingleModel("../../data/models/towers/chicken-thompson.obj", "chicken_tower");
-    LoadSingleModel("../../data/models/towers/beagle-ak47.obj", "beagle_tower");
+    RegisterStreamedModel("data/models/towers/chicken-thompson.obj", "chicken_tower", {"chicken_VRay", "gun_M1A1"});
+    RegisterStreamedModel("data/models/towers/beagle-ak47.obj", "beagle_tower", {"beagle", "gun_AK47"});
     
     // ===== INIMIGOS =====
-    printf("\n[INIMIGOS]\n");
-    LoadSingleModel("../../data/models/enemies/hawk/hawk.obj", "hawk");
-    LoadSingleModel("../../data/models/enemies/fox/fox.obj", "fox");
-    LoadSingleModel("../../data/models/enemies/wolf/wolf.obj", "wolf");
-    LoadSingleModel("../../data/models/enemies/rat/rat.obj", "rat");
+    RegisterStreamedModel("data/models/enemies/hawk/hawk.obj", "hawk", {GetEnemyRenderInfo(ENEMY_HAWK).meshName});
+    RegisterStreamedModel("data/models/enemies/fox/fox.obj", "fox", {GetEnemyRenderInfo(ENEMY_FOX).meshName});
+    RegisterStreamedModel("data/models/enemies/wolf/wolf.obj", "wolf", {GetEnemyRenderInfo(ENEMY_WOLF).meshName});
+    RegisterStreamedModel("data/models/enemies/rat/rat.obj", "rat", {GetEnemyRenderInfo(ENEMY_RAT).meshName});
     
     // ===== PROJETEIS ===
-    printf("\n[PROJETIL]\n");
-    LoadSingleModel("../../data/models/projectile/Egg.obj", "egg");
+    RegisterStreamedModel("data/models/projectile/Egg.obj", "egg", {"Uncracked_Egg"});
     
     
     // ===== AMBIENTE =====
-    printf("\n[AMBIENTE]\n");
-    LoadSingleModel("../../data/models/environment/ChickenCoop.obj", "ChickenCoop");
-    
-    
+    RegisterStreamedModel("data/models/environment/ChickenCoop.obj", "ChickenCoop", {"ChickenCoop"});
+    RegisterStreamedModel("data/models/plane.obj", "plane", {"the_plane"});
+
+#ifdef DISABLE_ASSET_STREAMING
+    const bool streaming = false;
+    for (MeshHandle mesh = 0; mesh < (MeshHandle)g_StreamedModelOfMesh.size(); ++mesh)
+        RequestMesh(mesh);
+#else
+    const bool streaming = g_PlaceholderSphere != NULL;
+#endif
+
+    // Sem a esfera os modelos foram enfileirados por RegisterStreamedModel(),
+    // e são enviados para a GPU à medida que ficam prontos
+    WaitForWorkerJobs();
+
+    // O que já terminou entra no relatório de memória do carregamento
+    // inicial (veja "main.cpp")
+    g_StreamedModelsReported = g_ModelsLoaded + g_ModelsFailed - g_ModelsDoneBeforeStreaming;
+
     // ===== RESUMO =====
     printf("\n=======================================================\n");
-    if (g_ModelsFailed == 0) {
+    if (streaming) {
+        printf("  OK: %d modelos serao carregados sob demanda\n", (int)g_StreamedModels.size());
+        printf("  (ate la, e se o arquivo faltar, o placeholder\n");
+        printf("   sphere e desenhado no lugar)\n");
+    } else if (g_ModelsFailed == 0) {
         printf("  OK: Todos os modelos carregados! (%d/%d)\n", 
                g_ModelsLoaded, g_ModelsLoaded + g_ModelsFailed);
     } else {
         printf("  AVISO: Carregados: %d | Falharam: %d\n", 
                g_ModelsLoaded, g_ModelsFailed);
-        printf("  (Arquivos faltando serao substituidos por\n");
-        printf("   placeholders: sphere/bunny)\n");
     }
     printf("=======================================================\n\n");
+
+    // A partir daqui os objetos são desenhados somente por handle
+    ResolveGameMeshHandles();
 }
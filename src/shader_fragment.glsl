@@ -15,57 +15,43 @@ in vec2 texcoords;
 
 in vec3 gouraud_illumination;
 
+// Camada da textura difusa (constante em cada triângulo)
+flat in float diffuse_layer;
+
 // Matrizes computadas no código C++ e enviadas para a GPU
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
-
-// Identificador que define qual objeto está sendo desenhado no momento
-#define CELL_EMPTY_PLANE    10
-#define CELL_PATH_PLANE     11
-#define CELL_BLOCKED_PLANE  12
-#define CELL_BASE_PLANE     13
-#define CELL_START_PLANE    14
-
-
-// Tower Defense Models
-#define MODEL_CHICKEN_TOWER 20
-#define MODEL_BEAGLE_TOWER  21
-#define MODEL_THOMPSON_GUN  25
-#define MODEL_AK47          26
-#define MODEL_CHICKEN_COOP  40
-
-// Enemies
-#define MODEL_HAWK          30
-#define MODEL_FOX           31
-#define MODEL_WOLF          32
-#define MODEL_RAT           33
 
-// Tower Range Circle
-#define TOWER_RANGE_CIRCLE  99
-
-// Projetil
-#define MODEL_EGG          50
-
-uniform int object_id;
+// Dados da câmera, atualizados uma vez por quadro em UpdateCameras() (veja
+// "camera.h"). O layout std140 deve coincidir com a estrutura CameraUniforms.
+layout (std140) uniform CameraBlock
+{
+    mat4 view;
+    mat4 projection;
+    mat4 inverse_view;
+    mat4 inverse_projection;
+    vec4 camera_position;
+};
+
+// Classe de material: este arquivo é compilado uma vez para cada
+// permutação, com os #defines abaixo inseridos pelo código C++ (veja
+// "materials.cpp"):
+//   USE_DIFFUSE_TEXTURE: Kd é lido de "diffuse_textures" (senão, de material_kd)
+//   USE_SPECULAR:        soma o termo especular de Blinn-Phong
+//   USE_GOURAUD:         usa a iluminação calculada no Vertex Shader
 
 // Parâmetros da axis-aligned bounding box (AABB) do modelo
 uniform vec4 bbox_min;
 uniform vec4 bbox_max;
 
-// Variáveis para acesso das imagens de textura
-uniform sampler2D texture_grass;
-uniform sampler2D texture_path;
-uniform sampler2D texture_chicken;
-uniform sampler2D texture_thompson;
-uniform sampler2D texture_beagle;
-uniform sampler2D texture_ak47;
-uniform sampler2D texture_chicken_coop;
-uniform sampler2D texture_hawk;
-uniform sampler2D texture_fox;
-uniform sampler2D texture_wolf;
-uniform sampler2D texture_rat;
-uniform sampler2D texture_egg;
+// Parâmetros do material (veja a tabela de materiais em "materials.cpp")
+uniform vec3 material_kd;         // Refletância difusa, sem textura
+uniform vec3 material_ks;         // Refletância especular
+uniform float material_ks_from_kd; // Fração de Kd somada a Ks
+uniform float material_q;         // Expoente especular
+
+// Texturas difusas de todos os materiais, uma por camada (veja
+// CreateTextureArray() em "resource_loader.cpp")
+uniform sampler2DArray diffuse_textures;
 
 // O valor de saída ("out") de um Fragment Shader é a cor final do fragmento.
 out vec4 color;
@@ -76,10 +62,8 @@ out vec4 color;
 
 void main()
 {
-    // Obtemos a posição da câmera utilizando a inversa da matriz que define o
-    // sistema de coordenadas da câmera.
-    vec4 origin = vec4(0.0, 0.0, 0.0, 1.0);
-    vec4 camera_position = inverse(view) * origin;
+    // A posição da câmera vem do bloco CameraBlock, calculada uma única vez
+    // por quadro na CPU.
 
     // O fragmento atual é coberto por um ponto que percente à superfície de um
     // dos objetos virtuais da cena. Este ponto, p, possui uma posição no
@@ -101,131 +85,32 @@ void main()
 
     // Half-vector do blinn-phong
     vec4 h = normalize(l + v);
-    
-    // Coordenadas de textura U e V
-    float U = 0.0;
-    float V = 0.0;
-
-    // Se nada for definido, o padrão da luz é nulo no objeto
-    vec3 Kd0 = vec3(0.0, 0.0, 0.0); 
-    vec3 Ks0 = vec3(0.0, 0.0, 0.0); 
-    float q = 1000.0; // Para ser ignorável deve ser muito alto
+
     vec3 I = vec3(1.0, 1.0, 1.0); // Intensidade da luz branca
-   
-    if ( object_id == MODEL_CHICKEN_TOWER )
-    {
-        U = texcoords.x;
-        V = texcoords.y;
-        Kd0 = texture(texture_chicken, vec2(U, V)).rgb;
-    }
-    else if ( object_id == MODEL_THOMPSON_GUN )
-    {
-        U = texcoords.x;
-        V = texcoords.y;
-        Kd0 = texture(texture_thompson, vec2(U, V)).rgb;
-        Ks0 = vec3(0.9, 0.9, 0.9); 
-        q = 10.0;
-    }
-    else if ( object_id == MODEL_BEAGLE_TOWER )
-    {
-        U = texcoords.x;
-        V = texcoords.y;
-        Kd0 = texture(texture_beagle, vec2(U, V)).rgb;
-    }
-    else if ( object_id == MODEL_AK47 )
-    {
-        U = texcoords.x;
-        V = texcoords.y;
-        Kd0 = texture(texture_ak47, vec2(U, V)).rgb;
-        Ks0 = vec3(0.9, 0.9, 0.9);
-        q = 10.0;
-
- }
-    else if ( object_id == MODEL_CHICKEN_COOP )
-    {
-        U = texcoords.x;
-        V = texcoords.y;
-        Kd0 = texture(texture_chicken_coop, vec2(U,V)).rgb; 
-    }
-    else if ( object_id == MODEL_HAWK )
-    {
-        U = texcoords.x;
-        V = texcoords.y;
-        Kd0 = texture(texture_hawk, vec2(U, V)).rgb;
-    }
-    else if ( object_id == MODEL_FOX )
-    {
-        U = texcoords.x;
-        V = texcoords.y;
-        Kd0 = texture(texture_fox, vec2(U, V)).rgb;
-    }
-    else if ( object_id == MODEL_WOLF )
-    {
-        U = texcoords.x;
-        V = texcoords.y;
-        Kd0 = texture(texture_wolf, vec2(U, V)).rgb;
-    }
-    else if ( object_id == MODEL_RAT )
-    {
-        U = texcoords.x;
-        V = texcoords.y;
-        Kd0 = texture(texture_rat, vec2(U, V)).rgb;
-    }
-    else if ( object_id == CELL_EMPTY_PLANE )
-    {
-        U = texcoords.x;
-        V = texcoords.y;
-        Kd0 = texture(texture_grass, texcoords).rgb;
-    }
-    else if ( object_id == CELL_PATH_PLANE )
-    {
-        U = texcoords.x;
-        V = texcoords.y;
-        Kd0 = texture(texture_path, texcoords).rgb;
-    }
-    else if ( object_id == CELL_BLOCKED_PLANE )
-    {
-        U = texcoords.x;
-        V = texcoords.y;
-        Kd0 = vec3(0.3, 0.3, 0.3); // Cinza escuro
-    }
-    else if ( object_id == CELL_BASE_PLANE )
-    {
-        U = texcoords.x;
-        V = texcoords.y;
-        Kd0 = vec3(0.2, 0.4, 0.9); // Azul
-    }
-    else if ( object_id == CELL_START_PLANE )
-    {
-        U = texcoords.x;
-        V = texcoords.y;
-        Kd0 = vec3(1.0, 0.0, 0.0); // Vermelho
-    }
-    else if ( object_id == TOWER_RANGE_CIRCLE )
-    {
-        Kd0 = vec3(1.0, 1.0, 0.0); // Amarelo
-    }
-    else if ( object_id == MODEL_EGG )
-    {
-        U = texcoords.x;
-        V = texcoords.y;
-        Kd0 = texture(texture_egg, vec2(U, V)).rgb;
-        Ks0 = Kd0 * 0.3;
-        q = 10.0;
-    }
 
+    // Refletância difusa
+#ifdef USE_DIFFUSE_TEXTURE
+    vec3 Kd0 = texture(diffuse_textures, vec3(texcoords, diffuse_layer)).rgb;
+#else
+    vec3 Kd0 = material_kd;
+#endif
+
+#ifdef USE_GOURAUD
+    // Iluminação interpolada a partir dos vértices (deixa a aparência mais
+    // "pixelada")
+    color.rgb = Kd0 * gouraud_illumination;
+#else
     // Equação de Iluminação
     float lambert = max(0,dot(n,l));
-    
-    vec3 phong_specular_term  = Ks0 * I * pow(max(dot(n, h), 0.0),q); 
 
+    color.rgb = Kd0 * I * (lambert + 0.01);
 
-    if(object_id == MODEL_CHICKEN_COOP){ // Tentando deixar mais "pixelado"
-        color.rgb = Kd0 * gouraud_illumination;
-    }
-    else{
-        color.rgb = Kd0 * I * (lambert + 0.01) + phong_specular_term;
-    }
+#ifdef USE_SPECULAR
+    vec3 Ks0 = material_ks + material_ks_from_kd * Kd0;
+    vec3 phong_specular_term  = Ks0 * I * pow(max(dot(n, h), 0.0), material_q);
+    color.rgb += phong_specular_term;
+#endif
+#endif
 
 
     // NOTE: Se você quiser fazer o rendering de objetos transparentes, é
@@ -5,15 +5,37 @@
 // Atributos de vértice recebidos como entrada ("in") pelo Vertex Shader.
 // Veja a função BuildTrianglesAndAddToVirtualScene() em "main.cpp".
 layout (location = 0) in vec4 model_coefficients;
-layout (location = 1) in vec4 normal_coefficients;
+layout (location = 1) in vec2 normal_octahedral; // Normal compactada, veja EncodeOctahedralNormal()
 layout (location = 2) in vec2 texture_coefficients;
 
+// Matriz "model" por instância, usada nos desenhos instanciados (veja
+// QueueVirtualObjectInstanced() em "render_queue.cpp"). Ocupa as
+// locations 3, 4, 5 e 6, uma para cada coluna.
+layout (location = 3) in mat4 instance_model;
+
+// Camada da textura difusa por instância (location 7)
+layout (location = 7) in float instance_texture_layer;
+
 // Matrizes computadas no código C++ e enviadas para a GPU
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
 
-#define MODEL_CHICKEN_COOP  40
+// Dados da câmera, atualizados uma vez por quadro em UpdateCameras() (veja
+// "camera.h"). O layout std140 deve coincidir com a estrutura CameraUniforms.
+layout (std140) uniform CameraBlock
+{
+    mat4 view;
+    mat4 projection;
+    mat4 inverse_view;
+    mat4 inverse_projection;
+    vec4 camera_position;
+};
+
+// true quando a matriz "model" vem do atributo instance_model (e a camada
+// da textura de instance_texture_layer)
+uniform bool instanced;
+
+// Camada da textura difusa nos desenhos não instanciados (veja BindMaterial())
+uniform float texture_layer;
 
 
 // Atributos de vértice que serão gerados como saída ("out") pelo Vertex Shader.
@@ -25,9 +47,20 @@ out vec4 position_model;
 out vec4 normal;
 out vec2 texcoords;
 out vec3 gouraud_illumination;
-uniform int object_id;
+flat out float diffuse_layer;
+
 
 
+// Decodifica uma normal armazenada em codificação octaédrica (veja
+// EncodeOctahedralNormal() em "resource_loader.cpp").
+vec4 DecodeOctahedralNormal(vec2 e)
+{
+    vec3 n = vec3(e.x, e.y, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += (n.x >= 0.0) ? -t : t;
+    n.y += (n.y >= 0.0) ? -t : t;
+    return vec4(normalize(n), 0.0);
+}
 
 void main()
 {
@@ -43,7 +76,9 @@ void main()
     // deste Vertex Shader, a placa de vídeo (GPU) fará a divisão por W. Veja
     // slides 41-67 e 69-86 do documento Aula_09_Projecoes.pdf.
 
-    gl_Position = projection * view * model * model_coefficients;
+    mat4 model_matrix = instanced ? instance_model : model;
+
+    gl_Position = projection * view * model_matrix * model_coefficients;
 
     // Como as variáveis acima  (tipo vec4) são vetores com 4 coeficientes,
     // também é possível acessar e modificar cada coeficiente de maneira
@@ -60,66 +95,45 @@ void main()
     // rasterizador para gerar atributos únicos para cada fragmento gerado.
 
     // Posição do vértice atual no sistema de coordenadas global (World).
-    position_world = model * model_coefficients;
+    position_world = model_matrix * model_coefficients;
 
     // Posição do vértice atual no sistema de coordenadas local do modelo.
     position_model = model_coefficients;
 
     // Normal do vértice atual no sistema de coordenadas global (World).
     // Veja slides 123-151 do documento Aula_07_Transformacoes_Geometricas_3D.pdf.
-    normal = inverse(transpose(model)) * normal_coefficients;
+    vec4 normal_coefficients = DecodeOctahedralNormal(normal_octahedral);
+    normal = inverse(transpose(model_matrix)) * normal_coefficients;
     normal.w = 0.0;
 
     // Coordenadas de textura obtidas do arquivo OBJ (se existirem!)
     texcoords = texture_coefficients;
+    diffuse_layer = instanced ? instance_texture_layer : texture_layer;
 
     // ***** Gourad Shading *******
-    if(object_id == MODEL_CHICKEN_COOP){
-        // Obtemos a posição da câmera utilizando a inversa da matriz que define o
-        // sistema de coordenadas da câmera.
-        vec4 origin = vec4(0.0, 0.0, 0.0, 1.0);
-        vec4 camera_position = inverse(view) * origin;
-
-        // O fragmento atual é coberto por um ponto que percente à superfície de um
-        // dos objetos virtuais da cena. Este ponto, p, possui uma posição no
-        // sistema de coordenadas global (World coordinates). Esta posição é obtida
-        // através da interpolação, feita pelo rasterizador, da posição de cada
-        // vértice.
-        vec4 p = position_world;
-
-        // Normal do fragmento atual, interpolada pelo rasterizador a partir das
-        // normais de cada vértice.
-        vec4 n = normalize(normal);
-
-        // Vetor que define o sentido da fonte de luz em relação ao ponto atual.
-        vec4 light_source_point = vec4(0.0,15.0,0.0,1.0);
-        vec4 l = normalize(light_source_point - p);
-
-        // Vetor que define o sentido da câmera em relação ao ponto atual.
-        vec4 v = normalize(camera_position - p);
-
-        // Half-vector do blinn-phong
-        vec4 h = normalize(l + v);
-        
-        // Coordenadas de textura U e V
-        float U = 0.0;
-        float V = 0.0;
-
-        // Se nada for definido, o padrão da luz é nulo no objeto
-        vec3 Kd0 = vec3(0.0, 0.0, 0.0); 
-        vec3 Ks0 = vec3(0.0, 0.0, 0.0); 
-        float q = 1000.0; // Para ser ignorável deve ser muito alto
-        vec3 I = vec3(1.0, 1.0, 1.0); // Intensidade da luz branca
-
-
-        // Equação de Iluminação
-        float lambert = max(0,dot(n,l));
-        vec3 phong_specular_term  = Ks0 * I * pow(max(dot(n, h), 0.0),q); 
-
-
-        gouraud_illumination = I * (lambert + 0.01) + (phong_specular_term);
-    }
-  
-  
+    // Somente na permutação USE_GOURAUD (veja "materials.cpp")
+#ifdef USE_GOURAUD
+    // A posição da câmera vem do bloco CameraBlock.
+
+    // Este ponto, p, possui uma posição no sistema de coordenadas global
+    // (World coordinates).
+    vec4 p = position_world;
+
+    // Normal do vértice atual
+    vec4 n = normalize(normal);
+
+    // Vetor que define o sentido da fonte de luz em relação ao ponto atual.
+    vec4 light_source_point = vec4(0.0,15.0,0.0,1.0);
+    vec4 l = normalize(light_source_point - p);
+
+    vec3 I = vec3(1.0, 1.0, 1.0); // Intensidade da luz branca
+
+    // Equação de Iluminação (o galinheiro não tem termo especular)
+    float lambert = max(0,dot(n,l));
+
+    gouraud_illumination = I * (lambert + 0.01);
+#else
+    gouraud_illumination = vec3(0.0);
+#endif
 }
 
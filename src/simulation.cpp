@@ -0,0 +1,183 @@
+#include "simulation.h"
+#include "tower_system.h"
+#include "enemy_system.h"
+#include "projectile_system.h"
+#include "hud.h"
+#include <GLFW/glfw3.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <cstdio>
+
+// ============================================================================
+// ARMAZENAMENTO LOCAL
+// ============================================================================
+
+static std::thread g_SimulationThread;
+static std::atomic<bool> g_StopSimulation(false);
+static unsigned int g_SimulationStep = 0;
+
+// Comandos enviados pela thread de renderização, ainda não executados
+static std::mutex g_CommandMutex;
+static std::vector<GameCommand> g_PendingCommands;
+
+// Buffer triplo de cópias do estado. Cada índice pertence a exatamente um
+// dos três papéis: em escrita pela simulação, em leitura pela renderização,
+// ou "pronto" (a última cópia publicada). A troca de papéis é uma única
+// operação atômica; SNAPSHOT_NEW_BIT indica que a cópia pronta ainda não foi
+// lida.
+static RenderSnapshot g_Snapshots[3];
+static int g_WriteSnapshot = 0;                   // Somente a simulação
+static int g_ReadSnapshot = 1;                    // Somente a renderização
+static std::atomic<int> g_ReadySnapshot(2);
+
+static const int SNAPSHOT_INDEX_MASK = 3;
+static const int SNAPSHOT_NEW_BIT = 4;
+
+// ============================================================================
+// IMPLEMENTAÇÃO
+// ============================================================================
+
+void PushGameCommand(const GameCommand& command) {
+    std::lock_guard<std::mutex> lock(g_CommandMutex);
+    g_PendingCommands.push_back(command);
+}
+
+static void ExecuteGameCommand(const GameCommand& command) {
+    switch (command.type) {
+        case GAME_COMMAND_SELECT_CELL: {
+            int towerIndex = SelectTowerAtPosition(command.gridX, command.gridZ);
+            if (towerIndex >= 0) {
+                g_SelectedTowerIndex = towerIndex;
+                ShowTowerInfo(towerIndex);
+                printf("[SELECAO] Torre #%d selecionada\n", towerIndex + 1);
+            } else {
+                g_SelectedTowerIndex = -1;
+                printf("[SELECAO] Nenhuma torre nessa posicao\n");
+            }
+            break;
+        }
+        case GAME_COMMAND_OPEN_TOWER_MENU:
+            OpenTowerMenu(command.gridX, command.gridZ);
+            break;
+        case GAME_COMMAND_CANCEL:
+            if (g_ShowTowerMenu) {
+                CloseTowerMenu();
+            } else {
+                g_SelectedTowerIndex = -1;
+                printf("[SELECAO] Torre desselecionada\n");
+            }
+            break;
+        case GAME_COMMAND_BUY_TOWER:
+            if (g_ShowTowerMenu)
+                BuyTower(command.tower_type);
+            break;
+        case GAME_COMMAND_SPAWN_ENEMY:
+            SpawnEnemy(command.enemy_type);
+            break;
+        case GAME_COMMAND_START_NEXT_WAVE:
+            if (!IsWaveActive()) {
+                StartWave(GetCurrentWaveNumber() + 1);
+            } else {
+                printf("[WAVE] Wave ja esta ativa!\n");
+            }
+            break;
+    }
+}
+
+static void ExecutePendingCommands() {
+    // Trocamos os vetores para não segurar a trava durante a execução
+    static std::vector<GameCommand> commands;
+    {
+        std::lock_guard<std::mutex> lock(g_CommandMutex);
+        commands.swap(g_PendingCommands);
+    }
+
+    for (size_t i = 0; i < commands.size(); i++)
+        ExecuteGameCommand(commands[i]);
+    commands.clear();
+}
+
+static void RunSimulationStep(float deltaTime) {
+    ExecutePendingCommands();
+
+    UpdateAllTowersPhysics(deltaTime);
+    UpdateAllEnemies(deltaTime);
+    UpdateWaveSystem(deltaTime);
+    UpdateProjectiles(deltaTime);
+
+    g_SimulationStep++;
+}
+
+// Copia o estado atual para a cópia em escrita e a torna a cópia pronta
+static void PublishRenderSnapshot() {
+    RenderSnapshot& snapshot = g_Snapshots[g_WriteSnapshot];
+    CaptureTowers(snapshot);
+    CaptureEnemies(snapshot);
+    CaptureProjectiles(snapshot);
+    CaptureHUDState(snapshot.hud);
+    snapshot.simulation_step = g_SimulationStep;
+
+    // A cópia pronta anterior (lida ou não) passa a ser a próxima em escrita
+    int previous = g_ReadySnapshot.exchange(g_WriteSnapshot | SNAPSHOT_NEW_BIT, std::memory_order_acq_rel);
+    g_WriteSnapshot = previous & SNAPSHOT_INDEX_MASK;
+}
+
+const RenderSnapshot& AcquireRenderSnapshot() {
+    // Sem cópia nova, continuamos desenhando a mesma
+    if (g_ReadySnapshot.load(std::memory_order_acquire) & SNAPSHOT_NEW_BIT) {
+        int ready = g_ReadySnapshot.exchange(g_ReadSnapshot, std::memory_order_acq_rel);
+        g_ReadSnapshot = ready & SNAPSHOT_INDEX_MASK;
+    }
+    return g_Snapshots[g_ReadSnapshot];
+}
+
+static void SimulationThreadMain() {
+    const double stepSeconds = 1.0 / SIMULATION_STEPS_PER_SECOND;
+    double nextStepTime = glfwGetTime() + stepSeconds;
+
+    while (!g_StopSimulation.load(std::memory_order_relaxed)) {
+        double now = glfwGetTime();
+        if (now < nextStepTime) {
+            // Dormimos até o próximo passo (no máximo 1 ms, para responder
+            // rápido a StopSimulationThread())
+            double wait = std::min(nextStepTime - now, 0.001);
+            std::this_thread::sleep_for(std::chrono::duration<double>(wait));
+            continue;
+        }
+
+        int steps = 0;
+        while (now >= nextStepTime && steps < SIMULATION_MAX_CATCHUP_STEPS) {
+            RunSimulationStep((float)stepSeconds);
+            nextStepTime += stepSeconds;
+            steps++;
+        }
+
+        // Atraso grande demais: descartamos o tempo que falta alcançar
+        if (now >= nextStepTime)
+            nextStepTime = now + stepSeconds;
+
+        PublishRenderSnapshot();
+    }
+}
+
+void StartSimulationThread() {
+    // O primeiro quadro já tem o que desenhar
+    PublishRenderSnapshot();
+
+    g_StopSimulation.store(false);
+    g_SimulationThread = std::thread(SimulationThreadMain);
+    printf("[SIM] Thread de simulacao iniciada (%.0f passos/s)\n", SIMULATION_STEPS_PER_SECOND);
+}
+
+void StopSimulationThread() {
+    if (!g_SimulationThread.joinable())
+        return;
+
+    g_StopSimulation.store(true);
+    g_SimulationThread.join();
+    printf("[SIM] Thread de simulacao encerrada apos %u passos\n", g_SimulationStep);
+}
@@ -1,6 +1,9 @@
 // Based on http://hamelot.io/visualization/opengl-text-without-any-external-libraries/
 //   and on https://github.com/rougier/freetype-gl
 #include <string>
+#include <cstring>
+#include <vector>
+#include <algorithm>
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
@@ -11,7 +14,8 @@
 #include "utils.h"
 #include "dejavufont.h"
 
-GLuint CreateGpuProgram(GLuint vertex_shader_id, GLuint fragment_shader_id); // Função definida em main.cpp
+GLuint CreateGpuProgramFromSource(const char* name, const std::string& vertex_source,
+                                  const std::string& fragment_source); // Função definida em resource_loader.cpp
 
 const GLchar* const textvertexshader_source = ""
 "#version 330\n"
@@ -35,60 +39,113 @@ const GLchar* const textfragmentshader_source = ""
 "}\n"
 "\0";
 
-void TextRendering_LoadShader(const GLchar* const shader_string, GLuint shader_id)
-{
-    // Define o código do shader, contido na string "shader_string"
-    glShaderSource(shader_id, 1, &shader_string, NULL);
+GLuint textVAO;
+GLuint textVBO;
+GLuint textprogram_id;
+GLuint texttexture_id;
 
-    // Compila o código do shader (em tempo de execução)
-    glCompileShader(shader_id);
+// Vértice de texto: posição em NDC (x, y) e coordenada de textura (s, t)
+struct TextVertex { float x, y, s, t; };
 
-    // Verificamos se ocorreu algum erro ou "warning" durante a compilação
-    GLint compiled_ok;
-    glGetShaderiv(shader_id, GL_COMPILE_STATUS, &compiled_ok);
+// Todo o texto de um quadro é acumulado aqui por TextRendering_PrintString()
+// e desenhado de uma só vez por TextRendering_Flush()
+static std::vector<TextVertex> g_TextVertices;
+static size_t g_TextVBOCapacity = 0; // Em número de vértices
 
-    GLint log_length = 0;
-    glGetShaderiv(shader_id, GL_INFO_LOG_LENGTH, &log_length);
+// Texto retido (veja TextRendering_CreateBlock()): a geometria fica em um
+// VBO próprio e só é reenviada quando o bloco é modificado
+struct TextBlock
+{
+    GLuint vertex_array_object_id;
+    GLuint vertex_buffer_id;
+    size_t capacity;   // Em número de vértices, no VBO
+    std::vector<TextVertex> vertices;
+    bool modified;     // "vertices" difere do conteúdo do VBO
+};
+
+// Glifo de cada codepoint de 0 a 255 (NULL se a fonte não o possui),
+// construída em TextRendering_Init()
+static const size_t kGlyphTableSize = 256;
+static const texture_glyph_t* g_GlyphTable[kGlyphTableSize];
+
+// A fonte embutida só tem os caracteres ASCII imprimíveis. Letras acentuadas
+// do Latin-1 (U+00C0 a U+00FF) são desenhadas com a letra sem acento.
+static const char kLatin1Fold[64 + 1] =
+    "AAAAAAACEEEEIIII"  // U+00C0 a U+00CF
+    "DNOOOOO*OUUUUYPs"  // U+00D0 a U+00DF
+    "aaaaaaaceeeeiiii"  // U+00E0 a U+00EF
+    "dnooooo/ouuuuypy"; // U+00F0 a U+00FF
+
+static void BuildGlyphTable()
+{
+    for (size_t i = 0; i < kGlyphTableSize; ++i)
+        g_GlyphTable[i] = NULL;
 
-    // Alocamos memória para guardar o log de compilação.
-    // A chamada "new" em C++ é equivalente ao "malloc()" do C.
-    GLchar* log = new GLchar[log_length];
-    glGetShaderInfoLog(shader_id, log_length, &log_length, log);
+    for (size_t j = 0; j < dejavufont.glyphs_count; ++j)
+    {
+        uint32_t codepoint = dejavufont.glyphs[j].codepoint;
+        if ( codepoint < kGlyphTableSize )
+            g_GlyphTable[codepoint] = &dejavufont.glyphs[j];
+    }
 
-    // Imprime no terminal qualquer erro ou "warning" de compilação
-    if ( log_length != 0 )
+    for (uint32_t codepoint = 0xC0; codepoint <= 0xFF; ++codepoint)
     {
-        std::string  output;
+        if ( g_GlyphTable[codepoint] == NULL )
+            g_GlyphTable[codepoint] = g_GlyphTable[(unsigned char)kLatin1Fold[codepoint - 0xC0]];
+    }
+}
 
-        if ( !compiled_ok )
-        {
-            output += "ERROR: OpenGL compilation failed.\n";
-            output += "== Start of compilation log\n";
-            output += log;
-            output += "== End of compilation log\n";
-        }
-        else
+// Decodifica o próximo codepoint UTF-8 de "str" a partir de "i", avançando
+// "i". Sequências inválidas resultam em U+FFFD e avançam um único byte.
+static uint32_t DecodeUTF8(const char* str, size_t size, size_t& i)
+{
+    unsigned char c = (unsigned char)str[i];
+    size_t length;
+    uint32_t codepoint;
+
+    if ( c < 0x80 )      { i += 1; return c; }
+    else if ( c < 0xC2 ) { i += 1; return 0xFFFD; } // Continuação solta ou sequência longa demais
+    else if ( c < 0xE0 ) { length = 2; codepoint = c & 0x1F; }
+    else if ( c < 0xF0 ) { length = 3; codepoint = c & 0x0F; }
+    else if ( c < 0xF5 ) { length = 4; codepoint = c & 0x07; }
+    else                 { i += 1; return 0xFFFD; }
+
+    if ( i + length > size )
+    {
+        i += 1;
+        return 0xFFFD;
+    }
+
+    for (size_t k = 1; k < length; ++k)
+    {
+        unsigned char next = (unsigned char)str[i + k];
+        if ( (next & 0xC0) != 0x80 )
         {
-            output += "ERROR: OpenGL compilation failed.\n";
-            output += "== Start of compilation log\n";
-            output += log;
-            output += "== End of compilation log\n";
+            i += 1;
+            return 0xFFFD;
         }
-
-        fprintf(stderr, "%s", output.c_str());
+        codepoint = (codepoint << 6) | (next & 0x3F);
     }
 
-    // A chamada "delete" em C++ é equivalente ao "free()" do C
-    delete [] log;
+    i += length;
+    return codepoint;
 }
 
-GLuint textVAO;
-GLuint textVBO;
-GLuint textprogram_id;
-GLuint texttexture_id;
+// Liga "vertex_buffer_id" ao atributo 0 (vec4: x, y, s, t) de um VAO
+static void SetupTextVertexArray(GLuint vertex_array_object_id, GLuint vertex_buffer_id)
+{
+    glBindVertexArray(vertex_array_object_id);
+    glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer_id);
+    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 0, 0);
+    glEnableVertexAttribArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+}
 
 void TextRendering_Init()
 {
+    BuildGlyphTable();
+
     GLuint sampler;
 
     glGenBuffers(1, &textVBO);
@@ -101,16 +158,9 @@ void TextRendering_Init()
     glSamplerParameteri(sampler, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     glCheckError();
 
-    GLuint textvertexshader_id = glCreateShader(GL_VERTEX_SHADER);
-    TextRendering_LoadShader(textvertexshader_source, textvertexshader_id);
-    glCheckError();
-
-    GLuint textfragmentshader_id = glCreateShader(GL_FRAGMENT_SHADER);
-    TextRendering_LoadShader(textfragmentshader_source, textfragmentshader_id);
-    glCheckError();
-
-    textprogram_id = CreateGpuProgram(textvertexshader_id, textfragmentshader_id);
-    glLinkProgram(textprogram_id);
+    // O programa pode vir do cache de binários, e por isso não é linkado de
+    // novo aqui (veja "program_cache.h")
+    textprogram_id = CreateGpuProgramFromSource("text", textvertexshader_source, textfragmentshader_source);
     glCheckError();
 
     GLuint texttex_uniform;
@@ -124,12 +174,7 @@ void TextRendering_Init()
     glBindSampler(textureunit, sampler);
     glCheckError();
 
-    glBindVertexArray(textVAO);
-
-    glBindBuffer(GL_ARRAY_BUFFER, textVBO);
-    glBufferData(GL_ARRAY_BUFFER, 24 * sizeof(float), NULL, GL_DYNAMIC_DRAW);
-    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 0, 0);
-    glEnableVertexAttribArray(0);
+    SetupTextVertexArray(textVAO, textVBO);
     glCheckError();
 
     glUseProgram(textprogram_id);
@@ -137,14 +182,14 @@ void TextRendering_Init()
     glUseProgram(0);
     glCheckError();
 
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
-    glCheckError();
 }
 
 float textscale = 1.5f;
 
-void TextRendering_PrintString(GLFWwindow* window, const std::string &str, float x, float y, float scale = 1.0f)
+// Gera os triângulos de um texto (UTF-8) com "size" bytes, acrescentando-os
+// a "vertices"
+static void AppendString(std::vector<TextVertex>& vertices, GLFWwindow* window, const char* str, size_t size,
+                         float x, float y, float scale)
 {
     scale *= textscale;
     int width, height;
@@ -152,18 +197,12 @@ void TextRendering_PrintString(GLFWwindow* window, const std::string &str, float
     float sx = scale / width;
     float sy = scale / height;
 
-    for (size_t i = 0; i < str.size(); i++)
+    size_t i = 0;
+    while (i < size)
     {
-        // Find the glyph for the character we are looking for
-        texture_glyph_t *glyph = 0;
-        for (size_t j = 0; j < dejavufont.glyphs_count; ++j)
-        {
-            if (dejavufont.glyphs[j].codepoint == (uint32_t)str[i])
-            {
-                glyph = &dejavufont.glyphs[j];
-                break;
-            }
-        }
+        uint32_t codepoint = DecodeUTF8(str, size, i);
+        // Busca direta do glifo; caracteres que a fonte não tem são ignorados
+        const texture_glyph_t *glyph = codepoint < kGlyphTableSize ? g_GlyphTable[codepoint] : NULL;
         if (!glyph) {
             continue;
         }
@@ -178,7 +217,7 @@ void TextRendering_PrintString(GLFWwindow* window, const std::string &str, float
         float s1 = glyph->s1 - 0.5f/dejavufont.tex_width;
         float t1 = glyph->t1 - 0.5f/dejavufont.tex_height;
 
-        struct {float x, y, s, t;} data[6] = {
+        TextVertex quad[6] = {
             { x0, y0, s0, t0 },
             { x0, y1, s0, t1 },
             { x1, y1, s1, t1 },
@@ -186,29 +225,109 @@ void TextRendering_PrintString(GLFWwindow* window, const std::string &str, float
             { x1, y1, s1, t1 },
             { x1, y0, s1, t0 }
         };
+        vertices.insert(vertices.end(), quad, quad + 6);
 
-        glEnable(GL_BLEND);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        x += (glyph->advance_x * sx);
+    }
+}
 
-        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-        glDepthFunc(GL_ALWAYS);
-        glBindBuffer(GL_ARRAY_BUFFER, textVBO);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, 24 * sizeof(float), data);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
+// Desenha "count" vértices de texto de um VAO com o layout de
+// SetupTextVertexArray()
+static void DrawTextVertices(GLuint vertex_array_object_id, size_t count)
+{
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    glDepthFunc(GL_ALWAYS);
 
-        glUseProgram(textprogram_id);
-        glBindVertexArray(textVAO);
+    glUseProgram(textprogram_id);
+    glBindVertexArray(vertex_array_object_id);
 
-        glDrawArrays(GL_TRIANGLES, 0, 6);
+    glDrawArrays(GL_TRIANGLES, 0, (GLsizei)count);
 
-        glBindVertexArray(0);
-        glUseProgram(0);
-        glDepthFunc(GL_LESS);
+    glBindVertexArray(0);
+    glUseProgram(0);
+    glDepthFunc(GL_LESS);
+    glDisable(GL_BLEND);
+}
 
-        glDisable(GL_BLEND);
+// Acrescenta um texto (UTF-8) ao lote do quadro atual. Nada é desenhado até
+// TextRendering_Flush().
+void TextRendering_PrintString(GLFWwindow* window, const std::string &str, float x, float y, float scale = 1.0f)
+{
+    AppendString(g_TextVertices, window, str.data(), str.size(), x, y, scale);
+}
 
-        x += (glyph->advance_x * sx);
+// Desenha todo o texto acumulado no quadro com uma única chamada, e esvazia
+// o lote. Deve ser chamada depois de todos os TextRendering_Print*().
+void TextRendering_Flush()
+{
+    if ( g_TextVertices.empty() )
+        return;
+
+    glBindBuffer(GL_ARRAY_BUFFER, textVBO);
+
+    // "Orphaning": um novo armazenamento a cada quadro evita esperar a GPU
+    // terminar de ler o texto do quadro anterior
+    if ( g_TextVertices.size() > g_TextVBOCapacity )
+        g_TextVBOCapacity = std::max(g_TextVertices.size(), 2 * g_TextVBOCapacity);
+    glBufferData(GL_ARRAY_BUFFER, g_TextVBOCapacity * sizeof(TextVertex), NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, g_TextVertices.size() * sizeof(TextVertex), g_TextVertices.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    DrawTextVertices(textVAO, g_TextVertices.size());
+
+    g_TextVertices.clear();
+}
+
+// Blocos de texto retido: o texto é gerado uma vez (TextRendering_ClearBlock()
+// seguido de TextRendering_PrintStringToBlock()) e redesenhado a cada quadro
+// por TextRendering_DrawBlock(), que só envia a geometria à GPU se o bloco
+// foi modificado desde o último desenho.
+TextBlock* TextRendering_CreateBlock()
+{
+    TextBlock* block = new TextBlock();
+    block->capacity = 0;
+    block->modified = false;
+
+    glGenVertexArrays(1, &block->vertex_array_object_id);
+    glGenBuffers(1, &block->vertex_buffer_id);
+    SetupTextVertexArray(block->vertex_array_object_id, block->vertex_buffer_id);
+
+    return block;
+}
+
+void TextRendering_ClearBlock(TextBlock* block)
+{
+    block->vertices.clear();
+    block->modified = true;
+}
+
+void TextRendering_PrintStringToBlock(TextBlock* block, GLFWwindow* window, const char* str,
+                                      float x, float y, float scale)
+{
+    AppendString(block->vertices, window, str, strlen(str), x, y, scale);
+    block->modified = true;
+}
+
+void TextRendering_DrawBlock(TextBlock* block)
+{
+    if ( block->modified )
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, block->vertex_buffer_id);
+        if ( block->vertices.size() > block->capacity )
+        {
+            block->capacity = std::max(block->vertices.size(), 2 * block->capacity);
+            glBufferData(GL_ARRAY_BUFFER, block->capacity * sizeof(TextVertex), NULL, GL_DYNAMIC_DRAW);
+        }
+        if ( !block->vertices.empty() )
+            glBufferSubData(GL_ARRAY_BUFFER, 0, block->vertices.size() * sizeof(TextVertex), block->vertices.data());
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        block->modified = false;
     }
+
+    if ( !block->vertices.empty() )
+        DrawTextVertices(block->vertex_array_object_id, block->vertices.size());
 }
 
 float TextRendering_LineHeight(GLFWwindow* window)
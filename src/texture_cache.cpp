@@ -0,0 +1,376 @@
+#include "texture_cache.h"
+#include "asset_archive.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+// ============================================================================
+// FORMATO DO ARQUIVO
+// ============================================================================
+//
+//   TextureCacheHeader
+//   níveis 0..num_levels-1 em sequência (TextureMipChainBytes() bytes)
+//
+// Todos os valores estão na ordem de bytes da máquina que gravou o cache.
+
+static const char kTextureCacheMagic[8] = { 'O', 'V', 'O', 'T', 'E', 'X', '\0', '\0' };
+
+struct TextureCacheHeader
+{
+    char     magic[8];
+    uint32_t version;
+    uint32_t format;      // TextureFormat
+    uint32_t size;        // Largura e altura do nível 0
+    uint32_t num_levels;
+    uint64_t source_hash;
+    uint64_t source_size;
+    uint64_t data_size;
+    uint64_t file_size;
+};
+
+// ============================================================================
+// NÍVEIS DE MIPMAP
+// ============================================================================
+
+int TextureMipLevels(int size)
+{
+    int levels = 1;
+    while (size > 1)
+    {
+        size /= 2;
+        ++levels;
+    }
+    return levels;
+}
+
+size_t TextureLevelBytes(TextureFormat format, int size)
+{
+    if (format == TEXTURE_FORMAT_BC1)
+    {
+        size_t blocks = (size_t)((size + 3) / 4);
+        return blocks * blocks * 8;
+    }
+    return (size_t)size * size * 3;
+}
+
+size_t TextureMipChainBytes(TextureFormat format, int size)
+{
+    size_t bytes = 0;
+    for (int level = 0; level < TextureMipLevels(size); ++level)
+        bytes += TextureLevelBytes(format, std::max(1, size >> level));
+    return bytes;
+}
+
+// ============================================================================
+// CODIFICADOR BC1
+// ============================================================================
+//
+// Cada bloco guarda duas cores RGB565 e um índice de 2 bits por pixel. Com
+// color0 > color1 a paleta é {color0, color1, 2/3 color0 + 1/3 color1,
+// 1/3 color0 + 2/3 color1}. As cores iniciais são os extremos dos pixels
+// projetados no eixo principal (maior variância) do bloco, refinados uma
+// vez por mínimos quadrados a partir dos índices escolhidos.
+
+static uint16_t PackRGB565(const float color[3])
+{
+    int r = std::max(0, std::min(31, (int)(color[0] * (31.0f / 255.0f) + 0.5f)));
+    int g = std::max(0, std::min(63, (int)(color[1] * (63.0f / 255.0f) + 0.5f)));
+    int b = std::max(0, std::min(31, (int)(color[2] * (31.0f / 255.0f) + 0.5f)));
+    return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+static void UnpackRGB565(uint16_t packed, float color[3])
+{
+    int r = (packed >> 11) & 31;
+    int g = (packed >> 5) & 63;
+    int b = packed & 31;
+    color[0] = (float)((r << 3) | (r >> 2));
+    color[1] = (float)((g << 2) | (g >> 4));
+    color[2] = (float)((b << 3) | (b >> 2));
+}
+
+static float ColorDistance(const unsigned char pixel[3], const float color[3])
+{
+    float dr = pixel[0] - color[0];
+    float dg = pixel[1] - color[1];
+    float db = pixel[2] - color[2];
+    return dr*dr + dg*dg + db*db;
+}
+
+// Ordena as cores do bloco (color0 > color1), escolhe o índice de cada pixel
+// e retorna o erro quadrático total
+static float SelectBC1Indices(const unsigned char pixels[16][3], uint16_t* color0, uint16_t* color1,
+                              uint32_t* indices)
+{
+    if (*color0 < *color1)
+        std::swap(*color0, *color1);
+
+    float palette[4][3];
+    UnpackRGB565(*color0, palette[0]);
+    UnpackRGB565(*color1, palette[1]);
+    for (int c = 0; c < 3; ++c)
+    {
+        palette[2][c] = (2.0f * palette[0][c] + palette[1][c]) / 3.0f;
+        palette[3][c] = (palette[0][c] + 2.0f * palette[1][c]) / 3.0f;
+    }
+
+    // Cores iguais: o bloco usa o modo de 3 cores, e o índice 0 é color0
+    int num_colors = (*color0 == *color1) ? 1 : 4;
+
+    float error = 0.0f;
+    *indices = 0;
+    for (int i = 0; i < 16; ++i)
+    {
+        int best = 0;
+        float best_distance = ColorDistance(pixels[i], palette[0]);
+        for (int p = 1; p < num_colors; ++p)
+        {
+            float distance = ColorDistance(pixels[i], palette[p]);
+            if (distance < best_distance)
+            {
+                best = p;
+                best_distance = distance;
+            }
+        }
+        *indices |= (uint32_t)best << (2 * i);
+        error += best_distance;
+    }
+    return error;
+}
+
+// Recalcula as duas cores que minimizam o erro para os índices dados.
+// Retorna false se o sistema é degenerado (todos os pixels no mesmo índice).
+static bool RefineBC1Endpoints(const unsigned char pixels[16][3], uint32_t indices, float color0[3], float color1[3])
+{
+    // Peso de color0 para cada índice
+    static const float kWeights[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+
+    float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+    float ax[3] = { 0.0f, 0.0f, 0.0f };
+    float bx[3] = { 0.0f, 0.0f, 0.0f };
+    for (int i = 0; i < 16; ++i)
+    {
+        float a = kWeights[(indices >> (2 * i)) & 3];
+        float b = 1.0f - a;
+        aa += a * a;
+        ab += a * b;
+        bb += b * b;
+        for (int c = 0; c < 3; ++c)
+        {
+            ax[c] += a * pixels[i][c];
+            bx[c] += b * pixels[i][c];
+        }
+    }
+
+    float determinant = aa * bb - ab * ab;
+    if (std::fabs(determinant) < 1e-6f)
+        return false;
+
+    for (int c = 0; c < 3; ++c)
+    {
+        color0[c] = (bb * ax[c] - ab * bx[c]) / determinant;
+        color1[c] = (aa * bx[c] - ab * ax[c]) / determinant;
+    }
+    return true;
+}
+
+static void EncodeBC1Block(const unsigned char pixels[16][3], unsigned char* block)
+{
+    float mean[3] = { 0.0f, 0.0f, 0.0f };
+    for (int i = 0; i < 16; ++i)
+        for (int c = 0; c < 3; ++c)
+            mean[c] += pixels[i][c] / 16.0f;
+
+    // Matriz de covariância (simétrica)
+    float cov[3][3] = { { 0.0f } };
+    for (int i = 0; i < 16; ++i)
+    {
+        float d[3] = { pixels[i][0] - mean[0], pixels[i][1] - mean[1], pixels[i][2] - mean[2] };
+        for (int r = 0; r < 3; ++r)
+            for (int c = 0; c < 3; ++c)
+                cov[r][c] += d[r] * d[c];
+    }
+
+    // Eixo principal por iteração de potência
+    float axis[3] = { 1.0f, 1.0f, 1.0f };
+    for (int iteration = 0; iteration < 8; ++iteration)
+    {
+        float next[3];
+        for (int r = 0; r < 3; ++r)
+            next[r] = cov[r][0] * axis[0] + cov[r][1] * axis[1] + cov[r][2] * axis[2];
+        float length = std::sqrt(next[0]*next[0] + next[1]*next[1] + next[2]*next[2]);
+        if (length < 1e-6f)
+            break;
+        for (int r = 0; r < 3; ++r)
+            axis[r] = next[r] / length;
+    }
+
+    float t_min = 0.0f, t_max = 0.0f;
+    for (int i = 0; i < 16; ++i)
+    {
+        float t = (pixels[i][0] - mean[0]) * axis[0] + (pixels[i][1] - mean[1]) * axis[1]
+                + (pixels[i][2] - mean[2]) * axis[2];
+        t_min = std::min(t_min, t);
+        t_max = std::max(t_max, t);
+    }
+
+    float end0[3], end1[3];
+    for (int c = 0; c < 3; ++c)
+    {
+        end0[c] = mean[c] + axis[c] * t_max;
+        end1[c] = mean[c] + axis[c] * t_min;
+    }
+
+    uint16_t color0 = PackRGB565(end0);
+    uint16_t color1 = PackRGB565(end1);
+    uint32_t indices;
+    float error = SelectBC1Indices(pixels, &color0, &color1, &indices);
+
+    if (color0 != color1 && RefineBC1Endpoints(pixels, indices, end0, end1))
+    {
+        uint16_t refined0 = PackRGB565(end0);
+        uint16_t refined1 = PackRGB565(end1);
+        uint32_t refined_indices;
+        float refined_error = SelectBC1Indices(pixels, &refined0, &refined1, &refined_indices);
+        if (refined_error < error)
+        {
+            color0 = refined0;
+            color1 = refined1;
+            indices = refined_indices;
+        }
+    }
+
+    block[0] = (unsigned char)(color0 & 0xFF);
+    block[1] = (unsigned char)(color0 >> 8);
+    block[2] = (unsigned char)(color1 & 0xFF);
+    block[3] = (unsigned char)(color1 >> 8);
+    for (int i = 0; i < 4; ++i)
+        block[4 + i] = (unsigned char)((indices >> (8 * i)) & 0xFF);
+}
+
+void EncodeBC1(const unsigned char* rgb, int width, int height, unsigned char* blocks)
+{
+    int blocks_x = (width + 3) / 4;
+    int blocks_y = (height + 3) / 4;
+
+    for (int by = 0; by < blocks_y; ++by)
+    {
+        for (int bx = 0; bx < blocks_x; ++bx)
+        {
+            unsigned char pixels[16][3];
+            for (int y = 0; y < 4; ++y)
+            {
+                int src_y = std::min(by * 4 + y, height - 1);
+                for (int x = 0; x < 4; ++x)
+                {
+                    int src_x = std::min(bx * 4 + x, width - 1);
+                    memcpy(pixels[4*y + x], rgb + ((size_t)src_y * width + src_x) * 3, 3);
+                }
+            }
+            EncodeBC1Block(pixels, blocks + ((size_t)by * blocks_x + bx) * 8);
+        }
+    }
+}
+
+// ============================================================================
+// ARQUIVO DE CACHE
+// ============================================================================
+
+// Nome do recurso do cache (veja "asset_archive.h")
+static std::string TextureCacheName(const char* image_filename)
+{
+    return std::string(image_filename) + ".texcache";
+}
+
+static bool ValidateTextureCache(const AssetView& cache, TextureFormat format, int size,
+                                 const TextureCacheKey& key)
+{
+    size_t data_size = TextureMipChainBytes(format, size);
+    const TextureCacheHeader* header = reinterpret_cast<const TextureCacheHeader*>(cache.data);
+    return cache.size == sizeof(TextureCacheHeader) + data_size
+        && memcmp(header->magic, kTextureCacheMagic, sizeof(kTextureCacheMagic)) == 0
+        && header->version == TEXTURE_CACHE_VERSION
+        && header->format == (uint32_t)format
+        && header->size == (uint32_t)size
+        && header->num_levels == (uint32_t)TextureMipLevels(size)
+        && header->source_hash == key.source_hash
+        && header->source_size == key.source_size
+        && header->data_size == data_size
+        && header->file_size == cache.size;
+}
+
+bool ReadTextureCache(const char* image_filename, TextureFormat format, int size,
+                      TextureCacheKey* key, TextureCacheView* view)
+{
+    key->valid = false;
+    view->file.data = NULL; // Permite ReleaseTextureCache() mesmo em caso de falha
+    view->file.size = 0;
+    view->file.loose.data = NULL;
+    view->file.loose.size = 0;
+    view->mips = NULL;
+    view->mips_size = 0;
+
+    if (!GetAssetHash(image_filename, &key->source_hash, &key->source_size))
+        return false;
+    key->valid = true;
+
+    // Um cache do pacote pode ter sido gerado para outro formato
+    std::string cache_name = TextureCacheName(image_filename);
+    AssetView& cache = view->file;
+    const TextureCacheKey& cache_key = *key;
+    bool stale = false;
+    if (!OpenCacheAsset(cache_name.c_str(),
+                        [&](const AssetView& file) { return ValidateTextureCache(file, format, size, cache_key); },
+                        &cache, &stale))
+    {
+        if (stale)
+            printf("[TEXCACHE] Cache desatualizado: %s\n", cache_name.c_str());
+        return false;
+    }
+
+    // Os níveis serão enviados diretamente do mapeamento para a GPU
+    view->mips      = cache.data + sizeof(TextureCacheHeader);
+    view->mips_size = TextureMipChainBytes(format, size);
+    return true;
+}
+
+void ReleaseTextureCache(TextureCacheView* view)
+{
+    ReleaseAsset(&view->file);
+    view->mips = NULL;
+    view->mips_size = 0;
+}
+
+void WriteTextureCache(const char* image_filename, const TextureCacheKey& key, TextureFormat format,
+                       int size, const std::vector<unsigned char>& mips)
+{
+    if (!key.valid)
+        return;
+
+    TextureCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, kTextureCacheMagic, sizeof(kTextureCacheMagic));
+    header.version     = TEXTURE_CACHE_VERSION;
+    header.format      = (uint32_t)format;
+    header.size        = (uint32_t)size;
+    header.num_levels  = (uint32_t)TextureMipLevels(size);
+    header.source_hash = key.source_hash;
+    header.source_size = key.source_size;
+    header.data_size   = mips.size();
+    header.file_size   = sizeof(header) + mips.size();
+
+    std::vector<FileChunk> chunks;
+    chunks.push_back({ &header, sizeof(header) });
+    chunks.push_back({ mips.data(), mips.size() });
+
+    std::string cache_path;
+    if (!WriteLooseAssetAtomically(TextureCacheName(image_filename).c_str(), chunks, &cache_path))
+    {
+        fprintf(stderr, "WARNING: Nao foi possivel gravar o cache \"%s\".\n", cache_path.c_str());
+        return;
+    }
+
+    printf("[TEXCACHE] Cache gravado: %s (%.1f KB)\n", cache_path.c_str(), header.file_size / 1024.0f);
+}
@@ -11,6 +11,9 @@
 #include "projectile_system.h"
 #include "enemy_system.h"
 #include "collisions.h"
+#include "frustum.h"
+#include "render_queue.h"
+#include <vector>
 // ============================================================================
 // DECLARAÇÕES EXTERNAS (funções e variáveis definidas em main.cpp)
 // ============================================================================
@@ -160,53 +163,126 @@ void UpdateAllTowersPhysics(float deltaTime) {
     }
 }
 
-void DrawChickenTower(glm::vec3 position, glm::vec3 direction) {
+// Matriz de transformação da galinha
+static glm::mat4 ChickenTowerModel(glm::vec3 position, glm::vec3 direction) {
     // Aplica offset Y para ajustar a base do modelo
     position.y += CHICKEN_Y_OFFSET;
     
     float angle = atan2f(direction.x, direction.z);
 
-    // Matriz de transformação da galinha
-    glm::mat4 chickenModel = Matrix_Translate(position.x, position.y, position.z)
-                           * Matrix_Scale(0.025f, 0.025f, 0.025f)
-                           * Matrix_Rotate_Y(angle);
-    
-    glUniformMatrix4fv(g_model_uniform, 1, GL_FALSE, glm::value_ptr(chickenModel));
-
-    glUniform1i(g_object_id_uniform, MODEL_CHICKEN_TOWER);
-    DrawVirtualObject("chicken_VRay");
-
-    glUniform1i(g_object_id_uniform, MODEL_THOMPSON_GUN);
-    DrawVirtualObject("gun_M1A1");
+    return Matrix_Translate(position.x, position.y, position.z)
+         * Matrix_Scale(0.025f, 0.025f, 0.025f)
+         * Matrix_Rotate_Y(angle);
 }
 
-void DrawBeagleTower(glm::vec3 position, glm::vec3 direction) {
+// Matriz de transformação do beagle
+static glm::mat4 BeagleTowerModel(glm::vec3 position, glm::vec3 direction) {
     position.y += BEAGLE_Y_OFFSET;
 
     float angle = atan2f(direction.x, direction.z);
-    // Matriz de transformação do beagle
-    glm::mat4 beagleModel = Matrix_Translate(position.x, position.y, position.z)
-                          * Matrix_Scale(0.0055f, 0.0055f, 0.0055f)
-                          * Matrix_Rotate_Y(angle);
-    
-    glUniformMatrix4fv(g_model_uniform, 1, GL_FALSE, glm::value_ptr(beagleModel));
 
-    glUniform1i(g_object_id_uniform, MODEL_BEAGLE_TOWER);
-    DrawVirtualObject("beagle");
+    return Matrix_Translate(position.x, position.y, position.z)
+         * Matrix_Scale(0.0055f, 0.0055f, 0.0055f)
+         * Matrix_Rotate_Y(angle);
+}
 
-    glUniform1i(g_object_id_uniform, MODEL_AK47);
-    DrawVirtualObject("gun_AK47");
+// Enfileira uma parte (corpo ou arma) de uma torre
+static void QueueTowerPart(MeshHandle mesh, int objectId, const glm::mat4& model) {
+    QueueVirtualObject(mesh, SelectMeshLOD(mesh, model), objectId, model);
 }
 
-void DrawAllTowers() {
+void DrawChickenTower(glm::vec3 position, glm::vec3 direction) {
+    glm::mat4 chickenModel = ChickenTowerModel(position, direction);
+
+    QueueTowerPart(g_Meshes.chicken_tower, MODEL_CHICKEN_TOWER, chickenModel);
+    QueueTowerPart(g_Meshes.thompson_gun, MODEL_THOMPSON_GUN, chickenModel);
+}
+
+void DrawBeagleTower(glm::vec3 position, glm::vec3 direction) {
+    glm::mat4 beagleModel = BeagleTowerModel(position, direction);
+
+    QueueTowerPart(g_Meshes.beagle_tower, MODEL_BEAGLE_TOWER, beagleModel);
+    QueueTowerPart(g_Meshes.ak47, MODEL_AK47, beagleModel);
+}
+
+// Adiciona a um lote de culling a caixa envolvente de um objeto, se ele foi
+// carregado
+static void AddMeshToBatch(AABBBatch& batch, MeshHandle mesh, const glm::mat4& model) {
+    if (mesh < 0 || mesh >= (MeshHandle)g_VirtualScene.size()) {
+        AddToAABBBatch(batch, glm::vec3(0.0f), glm::vec3(0.0f), model);
+        return;
+    }
+    AddToAABBBatch(batch, g_VirtualScene[mesh].bbox_min, g_VirtualScene[mesh].bbox_max, model);
+}
+
+void CaptureTowers(RenderSnapshot& snapshot) {
+    snapshot.towers.clear();
     for (int i = 0; i < g_TowerCount; i++) {
         if (!g_Towers[i].active)
             continue;
 
-        if (g_Towers[i].type == TOWER_CHICKEN) {
-            DrawChickenTower(g_Towers[i].physics.position, g_Towers[i].physics.direction);
-        } else if (g_Towers[i].type == TOWER_BEAGLE) {
-            DrawBeagleTower(g_Towers[i].physics.position, g_Towers[i].physics.direction);
+        TowerRenderState tower;
+        tower.position = g_Towers[i].physics.position;
+        tower.direction = g_Towers[i].physics.direction;
+        tower.type = g_Towers[i].type;
+        snapshot.towers.push_back(tower);
+    }
+
+    snapshot.has_selected_tower = g_SelectedTowerIndex >= 0 && g_SelectedTowerIndex < g_TowerCount
+                               && g_Towers[g_SelectedTowerIndex].active;
+    if (snapshot.has_selected_tower) {
+        snapshot.selected_tower_position = g_Towers[g_SelectedTowerIndex].physics.position;
+        snapshot.selected_tower_range = g_Towers[g_SelectedTowerIndex].attackRange;
+    }
+}
+
+void DrawAllTowers(const RenderSnapshot& snapshot) {
+    // Cada torre contribui com duas caixas (corpo e arma), testadas em lote
+    // contra o frustum antes de qualquer desenho
+    static AABBBatch batch;
+    static std::vector<unsigned char> visible;
+    ClearAABBBatch(batch);
+
+    for (size_t i = 0; i < snapshot.towers.size(); i++) {
+        const TowerRenderState& tower = snapshot.towers[i];
+
+        if (tower.type == TOWER_CHICKEN) {
+            glm::mat4 model = ChickenTowerModel(tower.position, tower.direction);
+            AddMeshToBatch(batch, g_Meshes.chicken_tower, model);
+            AddMeshToBatch(batch, g_Meshes.thompson_gun, model);
+        } else if (tower.type == TOWER_BEAGLE) {
+            glm::mat4 model = BeagleTowerModel(tower.position, tower.direction);
+            AddMeshToBatch(batch, g_Meshes.beagle_tower, model);
+            AddMeshToBatch(batch, g_Meshes.ak47, model);
+        }
+    }
+
+    CullAABBBatch(g_ViewFrustum, batch, visible);
+
+    // Corpos e armas vão para a fila de renderização, que os agrupa por
+    // programa de GPU e modelo
+    size_t box = 0;
+    for (size_t i = 0; i < snapshot.towers.size(); i++) {
+        const TowerRenderState& tower = snapshot.towers[i];
+        if (tower.type != TOWER_CHICKEN && tower.type != TOWER_BEAGLE)
+            continue;
+
+        bool bodyVisible = visible[box];
+        bool gunVisible = visible[box + 1];
+        box += 2;
+
+        if (tower.type == TOWER_CHICKEN) {
+            glm::mat4 model = ChickenTowerModel(tower.position, tower.direction);
+            if (bodyVisible)
+                QueueTowerPart(g_Meshes.chicken_tower, MODEL_CHICKEN_TOWER, model);
+            if (gunVisible)
+                QueueTowerPart(g_Meshes.thompson_gun, MODEL_THOMPSON_GUN, model);
+        } else {
+            glm::mat4 model = BeagleTowerModel(tower.position, tower.direction);
+            if (bodyVisible)
+                QueueTowerPart(g_Meshes.beagle_tower, MODEL_BEAGLE_TOWER, model);
+            if (gunVisible)
+                QueueTowerPart(g_Meshes.ak47, MODEL_AK47, model);
         }
     }
 }
@@ -227,22 +303,14 @@ int SelectTowerAtPosition(int gridX, int gridZ) {
     return -1;
 }
 
-void DrawTowerRangeCircle() {
-    if (g_SelectedTowerIndex < 0 || g_SelectedTowerIndex >= g_TowerCount)
-        return;
-    
-    if (!g_Towers[g_SelectedTowerIndex].active)
+void DrawTowerRangeCircle(const RenderSnapshot& snapshot) {
+    if (!snapshot.has_selected_tower)
         return;
     
-    Tower& tower = g_Towers[g_SelectedTowerIndex];
-    glm::vec3 center = tower.physics.position;
-    float range = tower.attackRange;
+    glm::vec3 center = snapshot.selected_tower_position;
+    float range = snapshot.selected_tower_range;
     int segments = 32;
     
-    // Acessa variáveis globais do shader
-    extern GLint g_model_uniform;
-    extern GLint g_object_id_uniform;
-    
     // Desenha várias linhas radiais formando um círculo
     for (int i = 0; i < segments; i++) {
         float angle1 = 2.0f * M_PI * i / segments;
@@ -253,9 +321,7 @@ void DrawTowerRangeCircle() {
         glm::mat4 model = Matrix_Translate(p1.x, center.y, p1.z)
                         * Matrix_Scale(0.05f, 0.05f, 0.05f);
         
-        glUniformMatrix4fv(g_model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-        glUniform1i(g_object_id_uniform, TOWER_RANGE_CIRCLE);
-        DrawVirtualObject("the_plane");
+        QueueVirtualObject(g_Meshes.plane, 0, TOWER_RANGE_CIRCLE, model);
     }
 }
 
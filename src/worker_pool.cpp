@@ -0,0 +1,204 @@
+#include "worker_pool.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <cstdio>
+
+// ============================================================================
+// ARMAZENAMENTO LOCAL
+// ============================================================================
+
+static std::vector<std::thread> g_Workers;
+static bool g_StopWorkers = false;
+
+// Protege todas as filas e contadores abaixo
+static std::mutex g_WorkerMutex;
+static std::condition_variable g_JobAvailable;      // Acorda as threads de trabalho
+static std::condition_variable g_MainThreadWakeup;  // Acorda WaitForWorkerJobs()
+
+static std::deque<std::function<void()> > g_Jobs;
+static std::deque<std::function<void()> > g_MainThreadTasks;
+
+// Tarefas enviadas e ainda não terminadas (na fila ou em execução)
+static int g_PendingJobs = 0;
+
+// Índices de uma chamada de ParallelFor(). Compartilhado com as tarefas,
+// que podem começar depois que a chamada já retornou.
+struct ParallelForState
+{
+    std::function<void(int)> function;
+    int                      count;
+    std::atomic<int>         next;  // Próximo índice a executar
+    std::mutex               mutex;
+    std::condition_variable  finished;
+    int                      done;  // Índices já executados (protegido por "mutex")
+};
+
+// ============================================================================
+// IMPLEMENTAÇÃO
+// ============================================================================
+
+static void WorkerLoop()
+{
+    for (;;)
+    {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(g_WorkerMutex);
+            g_JobAvailable.wait(lock, [] { return g_StopWorkers || !g_Jobs.empty(); });
+            if (g_Jobs.empty())
+                return;
+            job.swap(g_Jobs.front());
+            g_Jobs.pop_front();
+        }
+
+        job();
+
+        // As continuações da tarefa já estão na fila: quando g_PendingJobs
+        // chega a zero, WaitForWorkerJobs() não perde nenhuma
+        std::lock_guard<std::mutex> lock(g_WorkerMutex);
+        --g_PendingJobs;
+        g_MainThreadWakeup.notify_one();
+    }
+}
+
+void StartWorkerPool()
+{
+    if (!g_Workers.empty())
+        return;
+
+    int hardware_threads = (int)std::thread::hardware_concurrency();
+    int num_workers = std::max(1, hardware_threads - 1);
+
+    g_StopWorkers = false;
+    for (int i = 0; i < num_workers; ++i)
+        g_Workers.push_back(std::thread(WorkerLoop));
+
+    printf("[WORKERS] %d threads de trabalho\n", num_workers);
+}
+
+void StopWorkerPool()
+{
+    if (g_Workers.empty())
+        return;
+
+    WaitForWorkerJobs();
+
+    {
+        std::lock_guard<std::mutex> lock(g_WorkerMutex);
+        g_StopWorkers = true;
+    }
+    g_JobAvailable.notify_all();
+
+    for (size_t i = 0; i < g_Workers.size(); ++i)
+        g_Workers[i].join();
+    g_Workers.clear();
+}
+
+int GetWorkerCount()
+{
+    return (int)g_Workers.size();
+}
+
+void SubmitWorkerJob(const std::function<void()>& job)
+{
+    if (g_Workers.empty())
+    {
+        job();
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(g_WorkerMutex);
+        g_Jobs.push_back(job);
+        ++g_PendingJobs;
+    }
+    g_JobAvailable.notify_one();
+}
+
+// Executa os índices de "state" que ainda não foram pegos por outra thread
+static void RunParallelForIndices(ParallelForState& state)
+{
+    for (;;)
+    {
+        int index = state.next++;
+        if (index >= state.count)
+            return;
+
+        state.function(index);
+
+        std::lock_guard<std::mutex> lock(state.mutex);
+        if (++state.done == state.count)
+            state.finished.notify_all();
+    }
+}
+
+void ParallelFor(int count, const std::function<void(int)>& function)
+{
+    if (count <= 1 || g_Workers.empty())
+    {
+        for (int i = 0; i < count; ++i)
+            function(i);
+        return;
+    }
+
+    std::shared_ptr<ParallelForState> state = std::make_shared<ParallelForState>();
+    state->function = function;
+    state->count = count;
+    state->next = 0;
+    state->done = 0;
+
+    int num_helpers = std::min(count - 1, (int)g_Workers.size());
+    for (int i = 0; i < num_helpers; ++i)
+        SubmitWorkerJob([state] { RunParallelForIndices(*state); });
+
+    RunParallelForIndices(*state);
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->finished.wait(lock, [&state] { return state->done == state->count; });
+}
+
+void PostMainThreadTask(const std::function<void()>& task)
+{
+    std::lock_guard<std::mutex> lock(g_WorkerMutex);
+    g_MainThreadTasks.push_back(task);
+    g_MainThreadWakeup.notify_one();
+}
+
+void WaitForWorkerJobs()
+{
+    for (;;)
+    {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(g_WorkerMutex);
+            g_MainThreadWakeup.wait(lock, [] { return !g_MainThreadTasks.empty() || g_PendingJobs == 0; });
+            if (g_MainThreadTasks.empty())
+                return;
+            task.swap(g_MainThreadTasks.front());
+            g_MainThreadTasks.pop_front();
+        }
+
+        // Executada sem o mutex: a continuação pode enviar novas tarefas
+        task();
+    }
+}
+
+void RunMainThreadTasks()
+{
+    // Somente as continuações que já estavam na fila: as enviadas por elas
+    // ficam para a próxima chamada
+    std::deque<std::function<void()> > tasks;
+    {
+        std::lock_guard<std::mutex> lock(g_WorkerMutex);
+        tasks.swap(g_MainThreadTasks);
+    }
+
+    for (size_t i = 0; i < tasks.size(); ++i)
+        tasks[i]();
+}
@@ -0,0 +1,193 @@
+// Ferramenta que gera o pacote de recursos lido pelo jogo (veja
+// "asset_archive.h").
+//
+// Uso: pack_assets <pacote> <raiz> <caminho> [<caminho> ...]
+//
+// Cada <caminho> é um arquivo ou diretório relativo a <raiz>; diretórios são
+// percorridos recursivamente. O nome de cada recurso no pacote é o seu
+// caminho relativo a <raiz>, com '/' como separador. Exemplo, a partir da
+// raiz do projeto:
+//
+//   pack_assets data.pak . data src/shader_vertex.glsl src/shader_fragment.glsl
+//
+// Os caches de malhas e texturas presentes em "data" também são incluídos,
+// então o pacote deve ser gerado depois de executar o jogo uma vez.
+
+#include "asset_archive.h"
+#include "mapped_file.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <dirent.h>
+#endif
+
+// ============================================================================
+// LISTAGEM DOS ARQUIVOS
+// ============================================================================
+
+static bool EndsWith(const std::string& text, const char* suffix)
+{
+    size_t length = strlen(suffix);
+    return text.size() >= length && text.compare(text.size() - length, length, suffix) == 0;
+}
+
+// Arquivos temporários dos caches (gravação interrompida) não entram no
+// pacote, nem os binários de programas, que só valem para o driver da
+// máquina que os gerou (veja "program_cache.h")
+static bool IsPackable(const std::string& name)
+{
+    return !EndsWith(name, ".tmp") && !EndsWith(name, ".programcache");
+}
+
+// Acrescenta a "names" o arquivo "name" (relativo a "root") ou, se for um
+// diretório, todos os arquivos dentro dele
+static void ListFiles(const std::string& root, const std::string& name, std::vector<std::string>& names)
+{
+    std::string path = root + "/" + name;
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0)
+    {
+        fprintf(stderr, "[PACK] Caminho inexistente: %s\n", path.c_str());
+        return;
+    }
+
+    if (!(info.st_mode & S_IFDIR))
+    {
+        if (IsPackable(name))
+            names.push_back(name);
+        return;
+    }
+
+    std::vector<std::string> children;
+#ifdef _WIN32
+    WIN32_FIND_DATAA entry;
+    HANDLE handle = FindFirstFileA((path + "/*").c_str(), &entry);
+    if (handle != INVALID_HANDLE_VALUE)
+    {
+        do
+            children.push_back(entry.cFileName);
+        while (FindNextFileA(handle, &entry));
+        FindClose(handle);
+    }
+#else
+    DIR* directory = opendir(path.c_str());
+    if (directory != NULL)
+    {
+        while (struct dirent* entry = readdir(directory))
+            children.push_back(entry->d_name);
+        closedir(directory);
+    }
+#endif
+
+    for (size_t i = 0; i < children.size(); ++i)
+    {
+        if (children[i] == "." || children[i] == "..")
+            continue;
+        ListFiles(root, name + "/" + children[i], names);
+    }
+}
+
+// ============================================================================
+// GRAVAÇÃO DO PACOTE
+// ============================================================================
+
+static uint64_t AlignOffset(uint64_t offset)
+{
+    return (offset + ASSET_ARCHIVE_ALIGNMENT - 1) & ~(ASSET_ARCHIVE_ALIGNMENT - 1);
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 4)
+    {
+        fprintf(stderr, "Uso: %s <pacote> <raiz> <caminho> [<caminho> ...]\n", argv[0]);
+        return 1;
+    }
+
+    const char* archive_path = argv[1];
+    std::string root = argv[2];
+
+    std::vector<std::string> names;
+    for (int i = 3; i < argc; ++i)
+        ListFiles(root, argv[i], names);
+
+    // O índice é ordenado pelo nome, para a busca binária de OpenAsset()
+    std::sort(names.begin(), names.end());
+    names.erase(std::unique(names.begin(), names.end()), names.end());
+
+    std::vector<MappedFile> files;
+    std::vector<AssetArchiveEntry> entries;
+    std::string name_table;
+    for (size_t i = 0; i < names.size(); ++i)
+    {
+        MappedFile file;
+        if (!MapFile((root + "/" + names[i]).c_str(), &file))
+        {
+            fprintf(stderr, "[PACK] Ignorado (vazio ou ilegivel): %s\n", names[i].c_str());
+            continue;
+        }
+
+        AssetArchiveEntry entry;
+        memset(&entry, 0, sizeof(entry));
+        entry.name_offset = name_table.size();
+        entry.name_length = names[i].size();
+        entry.data_size   = file.size;
+        entry.hash        = HashBytes(file.data, file.size);
+        name_table += names[i];
+
+        files.push_back(file);
+        entries.push_back(entry);
+    }
+
+    AssetArchiveHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, ASSET_ARCHIVE_MAGIC, sizeof(ASSET_ARCHIVE_MAGIC));
+    header.version      = ASSET_ARCHIVE_VERSION;
+    header.num_entries  = (uint32_t)entries.size();
+    header.names_offset = sizeof(AssetArchiveHeader) + entries.size() * sizeof(AssetArchiveEntry);
+
+    uint64_t offset = header.names_offset + name_table.size();
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        entries[i].data_offset = AlignOffset(offset);
+        offset = entries[i].data_offset + entries[i].data_size;
+    }
+    header.file_size = offset;
+
+    // O pacote é gravado em um arquivo temporário e renomeado no final, para
+    // que o jogo nunca leia um pacote incompleto
+    static const unsigned char zeros[ASSET_ARCHIVE_ALIGNMENT] = { 0 };
+    std::vector<FileChunk> chunks;
+    chunks.push_back({ &header, sizeof(header) });
+    chunks.push_back({ entries.data(), entries.size() * sizeof(AssetArchiveEntry) });
+    chunks.push_back({ name_table.data(), name_table.size() });
+
+    offset = header.names_offset + name_table.size();
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        chunks.push_back({ zeros, (size_t)(entries[i].data_offset - offset) });
+        chunks.push_back({ files[i].data, files[i].size });
+        offset = entries[i].data_offset + entries[i].data_size;
+    }
+
+    bool ok = WriteFileAtomically(archive_path, chunks);
+    for (size_t i = 0; i < files.size(); ++i)
+        UnmapFile(&files[i]);
+    if (!ok)
+    {
+        fprintf(stderr, "[PACK] Nao foi possivel gravar \"%s\"\n", archive_path);
+        return 1;
+    }
+
+    printf("[PACK] %s: %zu recursos, %.1f MB\n", archive_path, entries.size(), header.file_size / (1024.0 * 1024.0));
+    return 0;
+}